@@ -0,0 +1,54 @@
+//  Arena.cpp
+
+#include "Arena.hpp"
+
+std::string_view Arena::copy(const std::string &string)
+{
+    if (string.empty()) {
+        return std::string_view();
+    }
+
+    char *data = static_cast<char*>(allocate(string.size(), 1));
+    std::memcpy(data, string.data(), string.size());
+    return std::string_view(data, string.size());
+}
+
+size_t Arena::size() const
+{
+    return mSize;
+}
+
+void Arena::clear()
+{
+    mLargeBlocks.clear();
+    mSize = 0;
+    if (mBlocks.empty()) {
+        return;
+    }
+
+    mBlocks.resize(1);
+    mCursor = mBlocks.front().get();
+    mEnd = mCursor + kBlockSize;
+}
+
+void* Arena::allocate(size_t size, size_t alignment)
+{
+    mSize += size;
+
+    // large arrays get a block of their own, so the rest of the current one is not wasted
+    if (size > kBlockSize / 4) {
+        mLargeBlocks.push_back(std::unique_ptr<char[]>(new char[size]));
+        return mLargeBlocks.back().get();
+    }
+
+    uintptr_t aligned = ((uintptr_t)mCursor + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    if (mCursor == nullptr || aligned + size > (uintptr_t)mEnd) {
+        mBlocks.push_back(std::unique_ptr<char[]>(new char[kBlockSize]));
+        mCursor = mBlocks.back().get();
+        mEnd = mCursor + kBlockSize;
+        aligned = ((uintptr_t)mCursor + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    }
+
+    mCursor = (char*)(aligned + size);
+    return (void*)aligned;
+}
@@ -0,0 +1,116 @@
+//  Arena.hpp
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ Read only view of items stored in an Arena
+ */
+template <class T>
+class Span {
+public:
+    Span() = default;
+
+    Span(const T *data, size_t size)
+    : mData(data), mSize((uint32_t)size)
+    {
+    }
+
+    const T* begin() const
+    {
+        return mData;
+    }
+
+    const T* end() const
+    {
+        return mData + mSize;
+    }
+
+    size_t size() const
+    {
+        return mSize;
+    }
+
+    bool empty() const
+    {
+        return mSize == 0;
+    }
+
+    const T& operator[](size_t index) const
+    {
+        return mData[index];
+    }
+
+private:
+    const T *mData=nullptr;
+    uint32_t mSize=0;
+};
+
+/**
+ Bump allocator, everything allocated from it is freed at once when it is cleared or destroyed.
+ No destructors are run, so only trivially destructible types can be made in it.
+ */
+class Arena {
+public:
+    Arena() = default;
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    template <class T, class... Args>
+    T* make(Args&&... args)
+    {
+        static_assert(std::is_trivially_destructible<T>::value, "arena objects are never destroyed");
+        return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    template <class T>
+    Span<T> copy(const T *items, size_t count)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "arena arrays are copied with memcpy");
+        if (count == 0) {
+            return Span<T>();
+        }
+
+        void *data = allocate(sizeof(T) * count, alignof(T));
+        std::memcpy(data, items, sizeof(T) * count);
+        return Span<T>(static_cast<const T*>(data), count);
+    }
+
+    template <class T>
+    Span<T> copy(const std::vector<T> &items)
+    {
+        return copy(items.data(), items.size());
+    }
+
+    std::string_view copy(const std::string &string);
+
+    /**
+     Bytes allocated so far
+     */
+    size_t size() const;
+
+    /**
+     Frees everything, the first block is kept for reuse
+     */
+    void clear();
+
+private:
+    void* allocate(size_t size, size_t alignment);
+
+    static const size_t kBlockSize = 64 * 1024;
+
+    std::vector<std::unique_ptr<char[]>> mBlocks;
+    std::vector<std::unique_ptr<char[]>> mLargeBlocks;
+    char *mCursor=nullptr;
+    char *mEnd=nullptr;
+    size_t mSize=0;
+};
@@ -0,0 +1,442 @@
+//  PersistentVector.cpp
+
+#include "PersistentVector.hpp"
+#include "jcVariable.hpp"
+
+#include <algorithm>
+
+struct PersistentVector::Node {
+    // leaves hold items, or ints when every item is one, internal nodes hold children and the running total of their items
+    std::vector<jcVariablePtr> items;
+    std::vector<int> ints;
+    bool packed=false;
+    std::vector<NodePtr> children;
+    std::vector<size_t> sizes;
+};
+
+struct PersistentVector::LeafRange {
+    const Node *leaf;
+    size_t startIdx;
+    size_t endIdx;
+};
+
+PersistentVector::PersistentVector(const jcVariablePtr *items, size_t count)
+{
+    if (count == 0) {
+        return;
+    }
+
+    std::vector<NodePtr> level;
+    for (size_t i = 0; i < count; i += kBranching) {
+        level.push_back(makeLeaf(items + i, std::min(count, i + kBranching) - i));
+    }
+    build(std::move(level), count);
+}
+
+PersistentVector::PersistentVector(const int *ints, size_t count)
+{
+    if (count == 0) {
+        return;
+    }
+
+    std::vector<NodePtr> level;
+    for (size_t i = 0; i < count; i += kBranching) {
+        NodePtr leaf = std::make_shared<Node>();
+        leaf->ints.assign(ints + i, ints + std::min(count, i + kBranching));
+        leaf->packed = true;
+        level.push_back(leaf);
+    }
+    build(std::move(level), count);
+}
+
+void PersistentVector::build(std::vector<NodePtr> level, size_t count)
+{
+    int height = 0;
+    while (level.size() > 1) {
+        height++;
+        std::vector<NodePtr> parents;
+        for (size_t i = 0; i < level.size(); i += kBranching) {
+            std::vector<NodePtr> children(level.begin() + i, level.begin() + std::min(level.size(), i + kBranching));
+            parents.push_back(makeInternal(std::move(children), height));
+        }
+        level = std::move(parents);
+    }
+
+    mRoot = level[0];
+    mHeight = height;
+    mSize = count;
+}
+
+PersistentVector::PersistentVector(const NodePtr &root, int height, size_t size)
+: mRoot(root), mHeight(height), mSize(size)
+{
+}
+
+size_t PersistentVector::size() const
+{
+    return mSize;
+}
+
+int PersistentVector::height() const
+{
+    return mHeight;
+}
+
+size_t PersistentVector::count(const Node *node, int height)
+{
+    return height == 0 ? leafSize(node) : node->sizes.back();
+}
+
+size_t PersistentVector::slotCount(const Node *node, int height)
+{
+    return height == 0 ? leafSize(node) : node->children.size();
+}
+
+size_t PersistentVector::leafSize(const Node *leaf)
+{
+    return leaf->packed ? leaf->ints.size() : leaf->items.size();
+}
+
+PersistentVector::NodePtr PersistentVector::makeLeaf(const jcVariablePtr *items, size_t count)
+{
+    NodePtr leaf = std::make_shared<Node>();
+    leaf->packed = std::all_of(items, items + count, [](const jcVariablePtr &item) {
+        return item->getType() == jcVariable::TypeInt;
+    });
+
+    if (leaf->packed) {
+        leaf->ints.reserve(count);
+        for (size_t i = 0; i < count; i++) {
+            leaf->ints.push_back(items[i]->asInt());
+        }
+    } else {
+        leaf->items.assign(items, items + count);
+    }
+    return leaf;
+}
+
+PersistentVector::NodePtr PersistentVector::makeLeaf(const std::vector<LeafRange> &ranges)
+{
+    NodePtr leaf = std::make_shared<Node>();
+    leaf->packed = std::all_of(ranges.begin(), ranges.end(), [](const LeafRange &range) {
+        return range.leaf->packed;
+    });
+
+    for (const LeafRange &range : ranges) {
+        const Node *source = range.leaf;
+        if (leaf->packed) {
+            leaf->ints.insert(leaf->ints.end(), source->ints.begin() + range.startIdx, source->ints.begin() + range.endIdx);
+        } else if (source->packed) {
+            // an item that is not an int boxes the whole leaf
+            for (size_t idx = range.startIdx; idx < range.endIdx; idx++) {
+                leaf->items.push_back(jcVariable::Create(source->ints[idx]));
+            }
+        } else {
+            leaf->items.insert(leaf->items.end(), source->items.begin() + range.startIdx, source->items.begin() + range.endIdx);
+        }
+    }
+    return leaf;
+}
+
+jcVariablePtr PersistentVector::leafItem(const Node *leaf, size_t index)
+{
+    return leaf->packed ? jcVariable::Create(leaf->ints[index]) : leaf->items[index];
+}
+
+PersistentVector::NodePtr PersistentVector::makeInternal(std::vector<NodePtr> children, int height)
+{
+    JC_ASSERT(height > 0 && children.size() > 0 && children.size() <= kBranching);
+
+    NodePtr node = std::make_shared<Node>();
+    node->sizes.reserve(children.size());
+
+    size_t total = 0;
+    for (const NodePtr &child : children) {
+        total += count(child.get(), height - 1);
+        node->sizes.push_back(total);
+    }
+    node->children = std::move(children);
+    return node;
+}
+
+jcVariablePtr PersistentVector::at(size_t index) const
+{
+    JC_ASSERT(index < mSize);
+
+    const Node *node = mRoot.get();
+    for (int height = mHeight; height > 0; height--) {
+        // a child holds at most kBranching^height items, so the radix is where the search starts
+        size_t child = index >> (kBits * height);
+        while (node->sizes[child] <= index) {
+            child++;
+        }
+        if (child > 0) {
+            index -= node->sizes[child - 1];
+        }
+        node = node->children[child].get();
+    }
+    return leafItem(node, index);
+}
+
+PersistentVector PersistentVector::slice(size_t startIdx, size_t endIdx) const
+{
+    JC_ASSERT(startIdx <= endIdx && endIdx <= mSize);
+
+    if (startIdx == endIdx) {
+        return PersistentVector();
+    } else if (startIdx == 0 && endIdx == mSize) {
+        return *this;
+    }
+
+    NodePtr root = mRoot;
+    if (endIdx < mSize) {
+        root = takeFront(root, mHeight, endIdx);
+    }
+    if (startIdx > 0) {
+        root = dropFront(root, mHeight, startIdx);
+    }
+    return collapse(root, mHeight, endIdx - startIdx);
+}
+
+PersistentVector::NodePtr PersistentVector::takeFront(const NodePtr &node, int height, size_t n)
+{
+    if (n == count(node.get(), height)) {
+        return node;
+    }
+
+    if (height == 0) {
+        return makeLeaf({ { node.get(), 0, n } });
+    }
+
+    size_t child = 0;
+    while (node->sizes[child] < n) {
+        child++;
+    }
+    size_t before = child > 0 ? node->sizes[child - 1] : 0;
+
+    std::vector<NodePtr> children(node->children.begin(), node->children.begin() + child);
+    children.push_back(takeFront(node->children[child], height - 1, n - before));
+    return makeInternal(std::move(children), height);
+}
+
+PersistentVector::NodePtr PersistentVector::dropFront(const NodePtr &node, int height, size_t n)
+{
+    if (n == 0) {
+        return node;
+    }
+
+    if (height == 0) {
+        return makeLeaf({ { node.get(), n, leafSize(node.get()) } });
+    }
+
+    size_t child = 0;
+    while (node->sizes[child] <= n) {
+        child++;
+    }
+    size_t before = child > 0 ? node->sizes[child - 1] : 0;
+
+    std::vector<NodePtr> children = { dropFront(node->children[child], height - 1, n - before) };
+    children.insert(children.end(), node->children.begin() + child + 1, node->children.end());
+    return makeInternal(std::move(children), height);
+}
+
+PersistentVector PersistentVector::concat(const PersistentVector &other) const
+{
+    if (other.mSize == 0) {
+        return *this;
+    } else if (mSize == 0) {
+        return other;
+    }
+
+    NodePtr root = concatSubTree(mRoot, mHeight, other.mRoot, other.mHeight);
+    return collapse(root, std::max(mHeight, other.mHeight) + 1, mSize + other.mSize);
+}
+
+PersistentVector::NodePtr PersistentVector::concatSubTree(const NodePtr &left, int leftHeight, const NodePtr &right, int rightHeight)
+{
+    // only the right edge of left and the left edge of right are rebuilt
+    if (leftHeight > rightHeight) {
+        NodePtr center = concatSubTree(left->children.back(), leftHeight - 1, right, rightHeight);
+        return rebalance(left.get(), center, nullptr, leftHeight);
+    } else if (leftHeight < rightHeight) {
+        NodePtr center = concatSubTree(left, leftHeight, right->children.front(), rightHeight - 1);
+        return rebalance(nullptr, center, right.get(), rightHeight);
+    }
+
+    if (leftHeight == 0) {
+        if (leafSize(left.get()) + leafSize(right.get()) <= kBranching) {
+            NodePtr leaf = makeLeaf({ { left.get(), 0, leafSize(left.get()) }, { right.get(), 0, leafSize(right.get()) } });
+            return makeInternal({ leaf }, 1);
+        }
+        return makeInternal({ left, right }, 1);
+    }
+
+    NodePtr center = concatSubTree(left->children.back(), leftHeight - 1, right->children.front(), rightHeight - 1);
+    return rebalance(left.get(), center, right.get(), leftHeight);
+}
+
+PersistentVector::NodePtr PersistentVector::rebalance(const Node *left, const NodePtr &center, const Node *right, int height)
+{
+    std::vector<NodePtr> nodes;
+    if (left) {
+        nodes.insert(nodes.end(), left->children.begin(), left->children.end() - 1);
+    }
+    nodes.insert(nodes.end(), center->children.begin(), center->children.end());
+    if (right) {
+        nodes.insert(nodes.end(), right->children.begin() + 1, right->children.end());
+    }
+
+    std::vector<NodePtr> balanced = redistribute(nodes, height - 1);
+    if (balanced.size() <= kBranching) {
+        return makeInternal({ makeInternal(std::move(balanced), height) }, height + 1);
+    }
+
+    std::vector<NodePtr> first(balanced.begin(), balanced.begin() + kBranching);
+    std::vector<NodePtr> second(balanced.begin() + kBranching, balanced.end());
+    return makeInternal({ makeInternal(std::move(first), height), makeInternal(std::move(second), height) }, height + 1);
+}
+
+std::vector<PersistentVector::NodePtr> PersistentVector::redistribute(const std::vector<NodePtr> &nodes, int height)
+{
+    std::vector<size_t> plan;
+    size_t total = 0;
+    for (const NodePtr &node : nodes) {
+        plan.push_back(slotCount(node.get(), height));
+        total += plan.back();
+    }
+
+    size_t optimal = (total + kBranching - 1) / kBranching;
+    size_t i = 0;
+    while (plan.size() > optimal + kExtraNodes) {
+        // nodes missing at most one slot are left alone
+        while (plan[i] >= kBranching - 1) {
+            i++;
+        }
+
+        // spread the slots of node i over the ones after it, which removes a node
+        size_t remaining = plan[i];
+        do {
+            JC_ASSERT(i + 1 < plan.size());
+            size_t filled = std::min(remaining + plan[i + 1], kBranching);
+            remaining = remaining + plan[i + 1] - filled;
+            plan[i] = filled;
+            i++;
+        } while (remaining > 0);
+
+        plan.erase(plan.begin() + i);
+        i--;
+    }
+
+    std::vector<NodePtr> result;
+    size_t source = 0;
+    size_t offset = 0;
+    for (size_t slots : plan) {
+        const Node *node = nodes[source].get();
+        if (offset == 0 && slotCount(node, height) == slots) {
+            // unchanged, keep sharing it
+            result.push_back(nodes[source++]);
+            continue;
+        }
+
+        std::vector<LeafRange> ranges;
+        std::vector<NodePtr> children;
+        size_t filled = 0;
+        while (filled < slots) {
+            node = nodes[source].get();
+            size_t take = std::min(slots - filled, slotCount(node, height) - offset);
+            if (height == 0) {
+                ranges.push_back({ node, offset, offset + take });
+            } else {
+                children.insert(children.end(), node->children.begin() + offset, node->children.begin() + offset + take);
+            }
+
+            filled += take;
+            offset += take;
+            if (offset == slotCount(node, height)) {
+                source++;
+                offset = 0;
+            }
+        }
+
+        result.push_back(height == 0 ? makeLeaf(ranges) : makeInternal(std::move(children), height));
+    }
+    return result;
+}
+
+PersistentVector PersistentVector::collapse(NodePtr root, int height, size_t size)
+{
+    while (height > 0 && root->children.size() == 1) {
+        root = root->children[0];
+        height--;
+    }
+    return PersistentVector(root, height, size);
+}
+
+void PersistentVector::forEach(const std::function<void(jcVariablePtr&)> &callback) const
+{
+    forEach(0, mSize, callback);
+}
+
+void PersistentVector::forEach(size_t startIdx, size_t endIdx, const std::function<void(jcVariablePtr&)> &callback) const
+{
+    JC_ASSERT(startIdx <= endIdx && endIdx <= mSize);
+    if (startIdx < endIdx) {
+        forEachIn(mRoot.get(), mHeight, startIdx, endIdx, callback);
+    }
+}
+
+void PersistentVector::forEachIn(Node *node, int height, size_t startIdx, size_t endIdx, const std::function<void(jcVariablePtr&)> &callback)
+{
+    if (height == 0 && node->packed) {
+        for (size_t idx = startIdx; idx < endIdx; idx++) {
+            jcVariablePtr item = jcVariable::Create(node->ints[idx]);
+            callback(item);
+        }
+        return;
+    } else if (height == 0) {
+        for (size_t idx = startIdx; idx < endIdx; idx++) {
+            callback(node->items[idx]);
+        }
+        return;
+    }
+
+    // only the children overlapping the range are visited
+    size_t before = 0;
+    for (size_t child = 0; child < node->children.size() && before < endIdx; child++) {
+        size_t after = node->sizes[child];
+        if (after > startIdx) {
+            forEachIn(node->children[child].get(), height - 1, std::max(startIdx, before) - before, std::min(endIdx, after) - before, callback);
+        }
+        before = after;
+    }
+}
+
+bool PersistentVector::forEachRun(size_t startIdx, size_t endIdx, const std::function<bool(const int*, size_t)> &ints, const std::function<bool(jcVariablePtr&)> &items) const
+{
+    JC_ASSERT(startIdx <= endIdx && endIdx <= mSize);
+    return startIdx == endIdx || forEachRunIn(mRoot.get(), mHeight, startIdx, endIdx, ints, items);
+}
+
+bool PersistentVector::forEachRunIn(Node *node, int height, size_t startIdx, size_t endIdx, const std::function<bool(const int*, size_t)> &ints, const std::function<bool(jcVariablePtr&)> &items)
+{
+    if (height == 0 && node->packed) {
+        return ints(node->ints.data() + startIdx, endIdx - startIdx);
+    } else if (height == 0) {
+        for (size_t idx = startIdx; idx < endIdx; idx++) {
+            if (!items(node->items[idx])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    size_t before = 0;
+    for (size_t child = 0; child < node->children.size() && before < endIdx; child++) {
+        size_t after = node->sizes[child];
+        if (after > startIdx && !forEachRunIn(node->children[child].get(), height - 1, std::max(startIdx, before) - before, std::min(endIdx, after) - before, ints, items)) {
+            return false;
+        }
+        before = after;
+    }
+    return true;
+}
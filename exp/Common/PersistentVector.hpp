@@ -0,0 +1,132 @@
+//  PersistentVector.hpp
+
+#pragma once
+
+#include "jc.h"
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+/**
+ Immutable sequence of variables stored in a relaxed radix balanced tree.
+ Copies share the tree. at, slice and concat are O(log n) and share every node they do not cut through.
+ A leaf whose items are all ints stores the ints, which are boxed again when they are read.
+ */
+class PersistentVector {
+public:
+    PersistentVector() = default;
+
+    /**
+     Builds the tree bottom up from count items
+     */
+    PersistentVector(const jcVariablePtr *items, size_t count);
+
+    /**
+     Builds the tree from count ints, every leaf is packed
+     */
+    PersistentVector(const int *ints, size_t count);
+
+    size_t size() const;
+
+    jcVariablePtr at(size_t index) const;
+
+    /**
+     Returns the items from startIdx up to but not including endIdx
+     */
+    PersistentVector slice(size_t startIdx, size_t endIdx) const;
+
+    PersistentVector concat(const PersistentVector &other) const;
+
+    void forEach(const std::function<void(jcVariablePtr&)> &callback) const;
+
+    /**
+     Calls the callback for the items from startIdx up to but not including endIdx
+     */
+    void forEach(size_t startIdx, size_t endIdx, const std::function<void(jcVariablePtr&)> &callback) const;
+
+    /**
+     Calls ints with the packed ints of each leaf and items with every other item, from startIdx up to
+     but not including endIdx. Returns false as soon as a callback does.
+     */
+    bool forEachRun(size_t startIdx, size_t endIdx, const std::function<bool(const int*, size_t)> &ints, const std::function<bool(jcVariablePtr&)> &items) const;
+
+    /**
+     Levels of internal nodes above the leaves
+     */
+    int height() const;
+
+    // a node holds up to kBranching items or children
+    static constexpr int kBits = 5;
+    static constexpr size_t kBranching = 1 << kBits;
+
+private:
+    struct Node;
+    using NodePtr = std::shared_ptr<Node>;
+
+    // items startIdx up to endIdx of a leaf
+    struct LeafRange;
+
+    PersistentVector(const NodePtr &root, int height, size_t size);
+
+    // puts the tree together from its leaves
+    void build(std::vector<NodePtr> level, size_t count);
+
+    static size_t count(const Node *node, int height);
+    static size_t slotCount(const Node *node, int height);
+    static size_t leafSize(const Node *leaf);
+
+    /**
+     A leaf holding the items, packed if they are all ints
+     */
+    static NodePtr makeLeaf(const jcVariablePtr *items, size_t count);
+
+    /**
+     A leaf holding the items of the ranges, packed if all of them are
+     */
+    static NodePtr makeLeaf(const std::vector<LeafRange> &ranges);
+
+    static jcVariablePtr leafItem(const Node *leaf, size_t index);
+
+    static NodePtr makeInternal(std::vector<NodePtr> children, int height);
+
+    /**
+     Keeps the first n items of the subtree, 0 < n
+     */
+    static NodePtr takeFront(const NodePtr &node, int height, size_t n);
+
+    /**
+     Drops the first n items of the subtree, n < count
+     */
+    static NodePtr dropFront(const NodePtr &node, int height, size_t n);
+
+    /**
+     Returns a node one level above the higher of the two holding the items of both
+     */
+    static NodePtr concatSubTree(const NodePtr &left, int leftHeight, const NodePtr &right, int rightHeight);
+
+    /**
+     Merges the children of left but its last, center and the children of right but its first,
+     all at height - 1, into a node at height + 1
+     */
+    static NodePtr rebalance(const Node *left, const NodePtr &center, const Node *right, int height);
+
+    /**
+     Moves the slots of underfull nodes into their neighbours until there are at most
+     kExtraNodes more nodes than needed, which keeps the radix search short
+     */
+    static std::vector<NodePtr> redistribute(const std::vector<NodePtr> &nodes, int height);
+
+    static void forEachIn(Node *node, int height, size_t startIdx, size_t endIdx, const std::function<void(jcVariablePtr&)> &callback);
+
+    static bool forEachRunIn(Node *node, int height, size_t startIdx, size_t endIdx, const std::function<bool(const int*, size_t)> &ints, const std::function<bool(jcVariablePtr&)> &items);
+
+    // single child roots are dropped
+    static PersistentVector collapse(NodePtr root, int height, size_t size);
+
+    static constexpr size_t kExtraNodes = 2;
+
+    NodePtr mRoot;
+    int mHeight=0;
+    size_t mSize=0;
+};
@@ -5,6 +5,7 @@
 #include <cassert>
 #include <cstdint>
 #include <exception>
+#include <memory>
 #include <string>
 
 ///////////////////////////////////
@@ -67,6 +68,7 @@ JC_CLASS(jcClosure);
 JC_CLASS(jcString);
 JC_CLASS(jcList);
 JC_CLASS(jcCollection);
+JC_CLASS(jcThunk);
 
 class jcException : public std::exception {
 public:
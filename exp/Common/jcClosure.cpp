@@ -1,13 +1,11 @@
 //  jcClosure.cpp
 
 #include "jcClosure.hpp"
+#include "jcVariable.hpp"
 
-#include <set>
-#include <functional>
-
-jcClosure::jcClosure(const std::string &name, std::map<std::string, jcVariablePtr> &scope)
+jcClosure::jcClosure(const std::string &name, std::vector<jcVariablePtr> &&captures)
 : mName(name),
-  mScope(scope)
+  mCaptures(std::move(captures))
 {
 }
 
@@ -16,19 +14,27 @@ std::string jcClosure::name() const
     return mName;
 }
 
-std::map<std::string, jcVariablePtr> jcClosure::scope() const
+const std::vector<jcVariablePtr>& jcClosure::captures() const
 {
-    return mScope;
+    return mCaptures;
+}
+
+const jcVariablePtr& jcClosure::capture(int slot) const
+{
+    JC_ASSERT(slot >= 0 && slot < mCaptures.size());
+    return mCaptures[slot];
 }
 
 bool jcClosure::equal(const jcClosure &other) const
 {
-    auto getKeys = [](std::map<std::string, jcVariablePtr> scope) -> std::set<std::string> {
-        std::set<std::string> keys;
-        for (auto pair : scope) {
-            keys.insert(pair.first);
+    if (name() != other.name() || mCaptures.size() != other.mCaptures.size()) {
+        return false;
+    }
+
+    for (int i = 0; i < mCaptures.size(); i++) {
+        if (mCaptures[i]->equal(*other.mCaptures[i]) == false) {
+            return false;
         }
-        return keys;
-    };
-    return getKeys(scope()) == getKeys(other.scope()) && name() == other.name();
+    }
+    return true;
 }
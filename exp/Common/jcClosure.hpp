@@ -2,26 +2,29 @@
 
 #pragma once
 
-#include <map>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "jc.h"
 
 /**
  Model to represent a closure. Holds the temporary function name and
- the scope of the closure.
+ the values the closure captured, indexed by capture slot.
  */
 class jcClosure {
 public:
-    jcClosure(const std::string &funcName, std::map<std::string, jcVariablePtr> &scope);
+    jcClosure(const std::string &funcName, std::vector<jcVariablePtr> &&captures);
 
     std::string name() const;
 
-    std::map<std::string, jcVariablePtr> scope() const;
+    const std::vector<jcVariablePtr>& captures() const;
+
+    const jcVariablePtr& capture(int slot) const;
 
     bool equal(const jcClosure &other) const;
 
 private:
     std::string mName;
-    std::map<std::string, jcVariablePtr> mScope;
+    std::vector<jcVariablePtr> mCaptures;
 };
@@ -5,6 +5,7 @@
 #include "jcVariable.hpp"
 
 #include <algorithm>
+#include <functional>
 
 /**
  Interface to describe methods that all collections should have.
@@ -52,6 +53,18 @@ public:
      */
     virtual void forEach(std::function<void(jcVariablePtr&)> callback) const = 0;
 
+    /**
+     Iterates over the collection in order, calling ints for each run of elements stored as packed ints
+     and items for every other element. Stops as soon as either callback returns false.
+     */
+    virtual void forEachRun(const std::function<bool(const int*, size_t)> &ints, const std::function<bool(jcVariablePtr&)> &items) const
+    {
+        bool going = true;
+        forEach([&items, &going](jcVariablePtr &item) {
+            going = going && items(item);
+        });
+    }
+
     /**
      Returns a slice of the collection
      */
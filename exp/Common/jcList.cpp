@@ -2,24 +2,16 @@
 
 #include "jcList.hpp"
 
-jcList::jcList(const jcList& other)
-{
-    if (other.isEmpty()) {
-        mList = std::make_shared<list>(nullptr, nullptr);
-        return;
-    }
-    std::shared_ptr<list> tmp = nullptr;
-    other.forEach([this, &other, &tmp](jcVariablePtr item) {
-        if (mList == nullptr) {
-            mList = std::make_shared<list>(item, nullptr);
-            tmp = mList;
-        } else {
-            tmp->tail = std::make_shared<list>(item, nullptr);
-            tmp = tmp->tail;
-        }
-    });
-    mList->endNode = tmp;
-    mSize = (int)other.size();
+#include <algorithm>
+
+jcList::jcList(const std::shared_ptr<chunk> &front, int headSize, int frontSize, const PersistentVector &items, size_t itemsStart, size_t itemsEnd)
+    : mFront(front), mHeadSize(headSize), mFrontSize(frontSize), mItems(items), mItemsStart(itemsStart), mItemsEnd(itemsEnd)
+{
+}
+
+jcList::jcList(const PersistentVector &items)
+    : mItems(items), mItemsEnd(items.size())
+{
 }
 
 //jcListPtr jcList::buildList(const std::vector<jcVariablePtr> &items)
@@ -36,13 +28,62 @@ jcList::jcList(const jcList& other)
 
 jcList* jcList::cons(const jcVariablePtr &value) const
 {
-    jcList *newList = new jcList;
-    newList->mList = std::make_shared<list>(value, mList);
-    newList->mSize = (int)(size() + 1);
-    if (mList == nullptr) {
-        newList->mList->endNode = newList->mList;
+    if (mHeadSize < kChunkSize) {
+        return new jcList(pushFront(&value, 1), mHeadSize + 1, mFrontSize + 1, mItems, mItemsStart, mItemsEnd);
+    }
+
+    std::shared_ptr<chunk> front;
+    if (mFrontSize < kMaxFrontSize) {
+        // the full chunk moves down the chain
+        front = std::make_shared<chunk>(kChunkSize, mFront);
+    } else {
+        // paid once every kMaxFrontSize conses
+        jcList rest(nullptr, 0, 0, toVector(), 0, size());
+        return rest.cons(value);
+    }
+    front->items[0] = value;
+    front->used = 1;
+    return new jcList(front, 1, mFrontSize + 1, mItems, mItemsStart, mItemsEnd);
+}
+
+std::shared_ptr<jcList::chunk> jcList::pushFront(const jcVariablePtr *items, int count) const
+{
+    int size = mHeadSize + count;
+    JC_ASSERT(size <= kChunkSize);
+
+    int expected = mHeadSize;
+    if (mFront && size <= (int)mFront->items.size() && mFront->used.compare_exchange_strong(expected, size)) {
+        // the slots are ours, lists already sharing the chunk never look past their own items
+        std::copy(items, items + count, mFront->items.begin() + mHeadSize);
+        return mFront;
     }
-    return newList;
+
+    // a list with more than one chunk is long already, so its chunk is allocated at full size
+    int capacity = mFrontSize > mHeadSize || mItemsStart < mItemsEnd ? kChunkSize : std::min(kChunkSize, std::max(kMinChunkSize, size * 2));
+    std::shared_ptr<chunk> front = std::make_shared<chunk>(capacity, mFront ? mFront->next : nullptr);
+    if (mHeadSize > 0) {
+        std::copy(mFront->items.begin(), mFront->items.begin() + mHeadSize, front->items.begin());
+    }
+    std::copy(items, items + count, front->items.begin() + mHeadSize);
+    front->used = size;
+    return front;
+}
+
+PersistentVector jcList::toVector() const
+{
+    PersistentVector items = mItems.slice(mItemsStart, mItemsEnd);
+    if (mFrontSize == 0) {
+        return items;
+    }
+
+    std::vector<jcVariablePtr> front;
+    front.reserve(mFrontSize);
+    int count = mHeadSize;
+    for (chunk *current = mFront.get(); current != nullptr; current = current->next.get()) {
+        front.insert(front.end(), current->items.rend() - count, current->items.rend());
+        count = kChunkSize;
+    }
+    return PersistentVector(front.data(), front.size()).concat(items);
 }
 
 bool jcList::equal(const jcList &other) const
@@ -50,28 +91,49 @@ bool jcList::equal(const jcList &other) const
     // this could be removed but for now it makes things simpler.
     if (size() != other.size()) return false;
 
-    std::shared_ptr<list> tmp = mList;
-    std::shared_ptr<list> end = mList->endNode;
-    std::shared_ptr<list> otherTmp = other.mList;
+    // packed ints are boxed for the callback only, so the items are kept rather than pointers to them
+    std::vector<jcVariablePtr> items;
+    items.reserve(size());
+    forEach([&items](jcVariablePtr &item) {
+        items.push_back(item);
+    });
 
-    while (tmp != end->tail) {
-        if (tmp->item->equal(*otherTmp->item) == false) {
-            return false;
-        }
-        tmp = tmp->tail;
-        otherTmp = otherTmp->tail;
-    }
-    return true;
+    bool equal = true;
+    size_t idx = 0;
+    other.forEach([&items, &equal, &idx](jcVariablePtr &item) {
+        equal = equal && items[idx++]->equal(*item);
+    });
+    return equal;
 }
 
 bool jcList::isEmpty() const
 {
-    return mList == nullptr;
+    return size() == 0;
 }
 
 size_t jcList::size() const
 {
-    return mSize;
+    return mFrontSize + (mItemsEnd - mItemsStart);
+}
+
+jcVariablePtr jcList::head() const
+{
+    JC_ASSERT(isEmpty() == false);
+    return mFrontSize > 0 ? mFront->items[mHeadSize - 1] : mItems.at(mItemsStart);
+}
+
+jcCollection* jcList::tail() const
+{
+    JC_ASSERT(isEmpty() == false);
+
+    // shrinks the first chunk or moves the start of the range, nothing is copied
+    if (mHeadSize > 1) {
+        return new jcList(mFront, mHeadSize - 1, mFrontSize - 1, mItems, mItemsStart, mItemsEnd);
+    } else if (mHeadSize == 1) {
+        std::shared_ptr<chunk> next = mFront->next;
+        return new jcList(next, next ? kChunkSize : 0, mFrontSize - 1, mItems, mItemsStart, mItemsEnd);
+    }
+    return new jcList(nullptr, 0, 0, mItems, mItemsStart + 1, mItemsEnd);
 }
 
 jcCollection* jcList::concat(const jcCollection &other) const
@@ -79,82 +141,102 @@ jcCollection* jcList::concat(const jcCollection &other) const
     JC_ASSERT(getType() == other.getType());
     const jcList& otherList = dynamic_cast<const jcList&>(other);
 
-    jcList myCopy = jcList(*this);
-    jcList otherCopy = jcList(otherList);
-
-    if (other.isEmpty()) {
-        return new jcList(myCopy.mList, (int)myCopy.size());
+    if (otherList.isEmpty()) {
+        return new jcList(*this);
     } else if (isEmpty()) {
-        return new jcList(otherCopy.mList, (int)otherCopy.size());
+        return new jcList(otherList);
     }
 
-    myCopy.mList->endNode->tail = otherCopy.mList;
-    myCopy.mList->endNode = otherCopy.mList->endNode;
+    if (size() == (size_t)mHeadSize && mHeadSize + otherList.mHeadSize <= kChunkSize) {
+        // a short list is pushed onto the front of the other one, e.g. [pivot] ++ xs, which leaves its vector alone
+        std::shared_ptr<chunk> front = otherList.pushFront(mFront->items.data(), mHeadSize);
+        return new jcList(front, mHeadSize + otherList.mHeadSize, mFrontSize + otherList.mFrontSize, otherList.mItems, otherList.mItemsStart, otherList.mItemsEnd);
+    }
 
-    return new jcList(myCopy.mList, (int)(myCopy.size() + otherCopy.size()));
+    // both sides are shared, only the nodes along the seam are new
+    PersistentVector items = mItems.slice(mItemsStart, mItemsEnd).concat(otherList.toVector());
+    return new jcList(mFront, mHeadSize, mFrontSize, items, 0, items.size());
 }
 
 void jcList::forEach(std::function<void(jcVariablePtr&)> callback) const
 {
-    if (mList == nullptr) return;
-    JC_ASSERT(mList->endNode != nullptr);
+    int count = mHeadSize;
+    for (chunk *current = mFront.get(); current != nullptr; current = current->next.get()) {
+        for (int idx = count - 1; idx >= 0; idx--) {
+            callback(current->items[idx]);
+        }
+        count = kChunkSize;
+    }
+    mItems.forEach(mItemsStart, mItemsEnd, callback);
+}
 
-    std::shared_ptr<list> tmp = mList;
-    std::shared_ptr<list> end = mList->endNode;
-    while (tmp != end->tail) {
-        callback(tmp->item);
-        tmp = tmp->tail;
+void jcList::forEachRun(const std::function<bool(const int*, size_t)> &ints, const std::function<bool(jcVariablePtr&)> &items) const
+{
+    // the front is never packed
+    int count = mHeadSize;
+    for (chunk *current = mFront.get(); current != nullptr; current = current->next.get()) {
+        for (int idx = count - 1; idx >= 0; idx--) {
+            if (!items(current->items[idx])) {
+                return;
+            }
+        }
+        count = kChunkSize;
     }
+    mItems.forEachRun(mItemsStart, mItemsEnd, ints, items);
 }
 
 jcVariablePtr jcList::at(int index) const
 {
     JC_ASSERT(index >= 0 && index < size());
 
-    std::shared_ptr<list> tmp = mList;
-    while (index > 0) {
-        tmp = tmp->tail;
-        index--;
+    if (index >= mFrontSize) {
+        return mItems.at(mItemsStart + index - mFrontSize);
+    } else if (index < mHeadSize) {
+        return mFront->items[mHeadSize - 1 - index];
     }
-    return tmp->item;
+
+    index -= mHeadSize;
+    chunk *current = mFront->next.get();
+    while (index >= kChunkSize) {
+        current = current->next.get();
+        index -= kChunkSize;
+    }
+    return current->items[kChunkSize - 1 - index];
 }
 
 jcCollection* jcList::slice(int startIdx, int endIdx) const
 {
-    if (mList == nullptr) return nullptr;
-    JC_ASSERT(mList->endNode != nullptr);
     JC_ASSERT(startIdx >= 0 && endIdx >= startIdx && endIdx <= size());
 
-    if (startIdx == endIdx) return new jcList;
-
-    std::shared_ptr<list> startNode = nullptr;
-    std::shared_ptr<list> endNode = nullptr;
+    if (startIdx >= mFrontSize) {
+        return new jcList(nullptr, 0, 0, mItems, mItemsStart + startIdx - mFrontSize, mItemsStart + endIdx - mFrontSize);
+    }
 
-    if (endIdx == size()) endNode = mList->endNode;
+    if (endIdx >= mFrontSize) {
+        // the items left in a chunk are a prefix of it, so the front from the chunk holding startIdx on is shared
+        std::shared_ptr<chunk> front = mFront;
+        int headSize = mHeadSize - startIdx;
+        while (headSize <= 0) {
+            front = front->next;
+            headSize += kChunkSize;
+        }
+        return new jcList(front, headSize, mFrontSize - startIdx, mItems, mItemsStart, mItemsStart + endIdx - mFrontSize);
+    }
 
+    // the cut goes through the front, copy the items it keeps
+    std::vector<jcVariablePtr> items;
+    items.reserve(endIdx - startIdx);
     int idx = 0;
-
-    std::shared_ptr<list> tmp = mList;
-    while (tmp != mList->endNode->tail) {
-        if (idx == startIdx) {
-            startNode = tmp;
+    int count = mHeadSize;
+    for (chunk *current = mFront.get(); idx < endIdx; current = current->next.get()) {
+        for (int slot = count - 1; slot >= 0 && idx < endIdx; slot--, idx++) {
+            if (idx >= startIdx) {
+                items.push_back(current->items[slot]);
+            }
         }
-        if (idx == endIdx - 1) {
-            endNode = tmp;
-        }
-
-        if (startNode && endNode) break;
-
-        tmp = tmp->tail;
-        idx++;
+        count = kChunkSize;
     }
-
-    JC_ASSERT(startNode && endNode);
-
-    std::shared_ptr<list> newList = std::make_shared<list>(startNode->item, startNode->tail);
-    newList->endNode = endNode;
-
-    return new jcList(newList, endIdx - startIdx);
+    return new jcList(nullptr, 0, 0, PersistentVector(items.data(), items.size()), 0, items.size());
 }
 
 jcVariable::Type jcList::getType() const
@@ -4,32 +4,35 @@
 
 #include "jc.h"
 #include "jcCollection.h"
+#include "PersistentVector.hpp"
 
+#include <atomic>
 #include <string>
 #include <memory>
 #include <vector>
 
-
+/**
+ Immutable list. The items consed most recently are packed into a short chain of chunks in front of
+ a range of a PersistentVector holding the rest, so cons and slice are O(1) and at and concat are O(log n).
+ */
 class jcList : public jcCollection
 {
 private:
-    struct list;
+    struct chunk;
 
-    jcList(const std::shared_ptr<list>& list, int size)
-        : mList(list), mSize(size)
-    {
-    }
+    jcList(const std::shared_ptr<chunk> &front, int headSize, int frontSize, const PersistentVector &items, size_t itemsStart, size_t itemsEnd);
 public:
-    jcList()
-    {
-        mList = nullptr;
-        mSize = 0;
-    }
+    jcList() = default;
 
     // for unit tests only
 //    static jcListPtr buildList(const std::vector<jcVariablePtr> &items);
 
-    jcList(const jcList& other);
+    jcList(const jcList& other) = default;
+
+    /**
+     A list of the items of the vector
+     */
+    explicit jcList(const PersistentVector &items);
 
     jcList* cons(const jcVariablePtr &value) const;
 
@@ -40,25 +43,58 @@ public:
      */
     size_t size() const override;
     bool isEmpty() const override;
+    jcVariablePtr head() const override;
+    jcCollection* tail() const override;
     jcCollection* concat(const jcCollection &other) const override;
     void forEach(std::function<void(jcVariablePtr&)> callback) const override;
+    void forEachRun(const std::function<bool(const int*, size_t)> &ints, const std::function<bool(jcVariablePtr&)> &items) const override;
     jcCollection* slice(int startIdx, int endIdx) const override;
     jcVariablePtr at(int index) const override;
     jcVariable::Type getType() const override;
 private:
 
-    struct list {
-        list(const jcVariablePtr &item, const std::shared_ptr<list> &tail)
-            : item(item), tail(tail)
+    struct chunk {
+        chunk(int capacity, const std::shared_ptr<chunk> &next)
+            : items(capacity), next(next)
         {
-            endNode = tail ? tail->endNode : nullptr;
         }
 
-        jcVariablePtr item;
-        std::shared_ptr<list> tail;
-        std::shared_ptr<list> endNode;
+        // items[0] is the last item of the chunk, each cons fills the next slot
+        std::vector<jcVariablePtr> items;
+
+        // slots in use, lists sharing the chunk see a prefix of them
+        std::atomic<int> used{0};
+
+        // the rest of the front, every chunk after the first one is full
+        std::shared_ptr<chunk> next;
     };
 
-    std::shared_ptr<list> mList;
-    int mSize=0;
+    /**
+     The first chunk holding its visible items followed by count more in chunk order, so items[count - 1] becomes the head.
+     The chunk is extended in place when no other list has claimed the slots after the visible ones.
+     */
+    std::shared_ptr<chunk> pushFront(const jcVariablePtr *items, int count) const;
+
+    /**
+     All the items, with the front moved into the vector
+     */
+    PersistentVector toVector() const;
+
+    static constexpr int kChunkSize = 32;
+
+    // consing onto a front this long moves it into the vector, which bounds the walk in at()
+    static constexpr int kMaxFrontSize = 32 * kChunkSize;
+
+    // the first chunk starts small and doubles, so short lists stay small
+    static constexpr int kMinChunkSize = 4;
+
+    // the first mHeadSize slots of the first chunk in reverse, then the chunks after it
+    std::shared_ptr<chunk> mFront;
+    int mHeadSize=0;
+    int mFrontSize=0;
+
+    // the items after the front, slices share the vector like jcArray shares its items
+    PersistentVector mItems;
+    size_t mItemsStart=0;
+    size_t mItemsEnd=0;
 };
@@ -0,0 +1,165 @@
+//  jcReclaimer.cpp
+
+#include "jcReclaimer.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Batch = std::vector<std::shared_ptr<void>>;
+
+// values handed to the background thread at a time
+const size_t kBatchSize = 1024;
+
+std::atomic<bool> gBackground(false);
+
+class BackgroundThread {
+public:
+    ~BackgroundThread()
+    {
+        if (mThread.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                mStopping = true;
+            }
+            mWake.notify_all();
+            mThread.join();
+        }
+    }
+
+    void push(Batch &&batch)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (mThread.joinable() == false) {
+                mThread = std::thread(&BackgroundThread::run, this);
+            }
+            mBatches.push_back(std::move(batch));
+        }
+        mWake.notify_all();
+    }
+
+    void waitUntilIdle()
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mIdle.wait(lock, [this]() { return mBatches.empty() && mBusy == false; });
+    }
+
+private:
+    void run();
+
+    std::thread mThread;
+    std::mutex mMutex;
+    std::condition_variable mWake;
+    std::condition_variable mIdle;
+    std::deque<Batch> mBatches;
+    bool mBusy=false;
+    bool mStopping=false;
+};
+
+BackgroundThread& backgroundThread()
+{
+    static BackgroundThread thread;
+    return thread;
+}
+
+struct ThreadState {
+    ~ThreadState()
+    {
+        // a thread's last batch is freed when it exits
+        freeInline = true;
+        Batch rest = std::move(batch);
+        for (std::shared_ptr<void> &value : rest) {
+            jcReclaimer::release(std::move(value));
+        }
+    }
+
+    // values waiting to be dropped by the release running on this thread
+    std::vector<std::shared_ptr<void>> pending;
+    bool releasing=false;
+
+    Batch batch;
+
+    // the background thread and exiting threads do not hand values over
+    bool freeInline=false;
+};
+
+thread_local ThreadState tState;
+
+void BackgroundThread::run()
+{
+    tState.freeInline = true;
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (true) {
+        mWake.wait(lock, [this]() { return mBatches.size() > 0 || mStopping; });
+        if (mBatches.empty()) {
+            return;
+        }
+
+        Batch batch = std::move(mBatches.front());
+        mBatches.pop_front();
+        mBusy = true;
+
+        lock.unlock();
+        for (std::shared_ptr<void> &value : batch) {
+            jcReclaimer::release(std::move(value));
+        }
+        lock.lock();
+
+        mBusy = false;
+        if (mBatches.empty()) {
+            mIdle.notify_all();
+        }
+    }
+}
+
+}
+
+void jcReclaimer::release(std::shared_ptr<void> &&value)
+{
+    ThreadState &state = tState;
+    if (state.releasing) {
+        // called from the destructor of a value being released, it is dropped by the loop below
+        state.pending.push_back(std::move(value));
+        return;
+    }
+
+    if (gBackground && state.freeInline == false) {
+        state.batch.push_back(std::move(value));
+        if (state.batch.size() >= kBatchSize) {
+            backgroundThread().push(std::move(state.batch));
+            state.batch = Batch();
+        }
+        return;
+    }
+
+    state.releasing = true;
+    value.reset();
+    while (state.pending.size() > 0) {
+        std::shared_ptr<void> next = std::move(state.pending.back());
+        state.pending.pop_back();
+        next.reset();
+    }
+    state.releasing = false;
+}
+
+void jcReclaimer::setBackground(bool enabled)
+{
+    gBackground = enabled;
+}
+
+void jcReclaimer::flush()
+{
+    Batch batch = std::move(tState.batch);
+    tState.batch = Batch();
+    if (batch.size() > 0) {
+        backgroundThread().push(std::move(batch));
+    }
+    backgroundThread().waitUntilIdle();
+}
@@ -0,0 +1,29 @@
+//  jcReclaimer.hpp
+
+#pragma once
+
+#include <memory>
+
+/**
+ Frees the values nested in collections, closures and thunks from a work list instead of a recursion
+ as deep as the nesting, so dropping a deeply nested value cannot overflow the native stack.
+ jcVariable hands over its payload when it holds the last reference.
+ */
+class jcReclaimer {
+public:
+    /**
+     Drops the value, the values it holds are released after it rather than inside its destructor
+     */
+    static void release(std::shared_ptr<void> &&value);
+
+    /**
+     Hands released values to a background thread in batches, so the thread dropping a large
+     structure does not stall on freeing it. Off by default, applies to the whole process.
+     */
+    static void setBackground(bool enabled);
+
+    /**
+     Frees everything handed over so far, including the batch of the calling thread
+     */
+    static void flush();
+};
@@ -2,8 +2,106 @@
 
 #include "jcString.hpp"
 
+#include <algorithm>
+#include <vector>
+
+struct jcString::Rope {
+    explicit Rope(std::string chars)
+        : buffer(std::make_shared<const std::string>(std::move(chars))), size(buffer->size())
+    {
+    }
+
+    Rope(const std::shared_ptr<const std::string> &buffer, size_t offset, size_t size)
+        : buffer(buffer), offset(offset), size(size)
+    {
+    }
+
+    Rope(const std::shared_ptr<Rope> &left, const std::shared_ptr<Rope> &right)
+        : left(left), right(right), size(left->size + right->size), depth(std::max(left->depth, right->depth) + 1)
+    {
+    }
+
+    ~Rope()
+    {
+        if (left == nullptr && right == nullptr) {
+            return;
+        }
+
+        // a rope built by appending is as deep as it is long, take it apart without recursing.
+        // Only concatenations go on the list, leaves and shared nodes are released where they are found.
+        std::vector<std::shared_ptr<Rope>> nodes;
+        auto release = [&nodes](std::shared_ptr<Rope> &node) {
+            if (node && node.use_count() == 1 && (node->left || node->right)) {
+                nodes.push_back(std::move(node));
+            }
+            node.reset();
+        };
+
+        release(left);
+        release(right);
+        while (nodes.size() > 0) {
+            std::shared_ptr<Rope> node = std::move(nodes.back());
+            nodes.pop_back();
+            release(node->left);
+            release(node->right);
+        }
+    }
+
+    bool isLeaf() const
+    {
+        return left == nullptr;
+    }
+
+    void flatten()
+    {
+        if (isLeaf()) {
+            return;
+        }
+
+        std::string chars;
+        chars.reserve(size);
+
+        std::vector<const Rope*> nodes = { this };
+        while (nodes.size() > 0) {
+            const Rope *node = nodes.back();
+            nodes.pop_back();
+            if (node->isLeaf()) {
+                chars += node->chars();
+            } else {
+                nodes.push_back(node->right.get());
+                nodes.push_back(node->left.get());
+            }
+        }
+
+        buffer = std::make_shared<const std::string>(std::move(chars));
+        offset = 0;
+        left = nullptr;
+        right = nullptr;
+        depth = 0;
+    }
+
+    std::string_view chars() const
+    {
+        JC_ASSERT(isLeaf());
+        return std::string_view(buffer->data() + offset, size);
+    }
+
+    // a leaf is size characters of the buffer from offset on, a concatenation is its two halves until it is flattened
+    std::shared_ptr<const std::string> buffer;
+    size_t offset=0;
+    std::shared_ptr<Rope> left;
+    std::shared_ptr<Rope> right;
+    size_t size=0;
+    int depth=0;
+};
+
 jcString::jcString(const std::string &value, Context ctx)
-: mData(value), mCtx(ctx)
+: mRope(std::make_shared<Rope>(value)), mCtx(ctx)
+{
+}
+
+jcString::jcString(const std::shared_ptr<Rope> &rope, Context ctx)
+: mRope(rope), mCtx(ctx)
 {
 }
 
@@ -14,12 +112,28 @@ jcStringPtr jcString::Create(const std::string &value, Context ctx)
 
 const std::string& jcString::asStdString() const
 {
-    return mData;
+    flatten();
+    if (mRope->offset > 0 || mRope->size < mRope->buffer->size()) {
+        mRope->buffer = std::make_shared<const std::string>(mRope->chars());
+        mRope->offset = 0;
+    }
+    return *mRope->buffer;
+}
+
+std::string_view jcString::view() const
+{
+    flatten();
+    return mRope->chars();
+}
+
+void jcString::flatten() const
+{
+    mRope->flatten();
 }
 
 bool jcString::equal(const jcString &other) const
 {
-    return asStdString() == other.asStdString();
+    return size() == other.size() && view() == other.view();
 }
 
 /**
@@ -28,7 +142,7 @@ bool jcString::equal(const jcString &other) const
 
 size_t jcString::size() const
 {
-    return mData.size();
+    return mRope->size;
 }
 
 jcCollection* jcString::concat(const jcCollection &other) const
@@ -36,34 +150,85 @@ jcCollection* jcString::concat(const jcCollection &other) const
     JC_ASSERT(getType() == other.getType());
 
     const jcString& otherString = dynamic_cast<const jcString&>(other);
+    const std::shared_ptr<Rope> &left = mRope;
+    const std::shared_ptr<Rope> &right = otherString.mRope;
 
-    std::string str = std::string(asStdString()) + std::string(otherString.asStdString());
+    if (right->size == 0) {
+        return new jcString(left, getContext());
+    } else if (left->size == 0) {
+        return new jcString(right, getContext());
+    }
 
-    return new jcString(str, getContext());
+    if (left->size + right->size <= kMaxLeafSize && left->isLeaf() && right->isLeaf()) {
+        return new jcString(std::string(left->chars()).append(right->chars()), getContext());
+    }
+
+    if (left->isLeaf() == false && left->right->isLeaf() && right->isLeaf() && left->right->size + right->size <= kMaxLeafSize) {
+        // appending a short string copies the short last leaf rather than adding a node per append
+        std::shared_ptr<Rope> last = std::make_shared<Rope>(std::string(left->right->chars()).append(right->chars()));
+        return new jcString(std::make_shared<Rope>(left->left, last), getContext());
+    }
+
+    return new jcString(std::make_shared<Rope>(left, right), getContext());
 }
 
 void jcString::forEach(std::function<void(jcVariablePtr&)> callback) const
 {
-    for (auto it = mData.begin(); it != mData.end(); ++it) {
-        auto val = jcVariable::Create(*it);
+    for (char c : view()) {
+        auto val = jcVariable::Create(c);
         callback(val);
     }
 }
 
 jcCollection* jcString::slice(int startIdx, int endIdx) const
 {
-    JC_ASSERT(startIdx >= 0 && endIdx <= mData.size() && startIdx <= endIdx);
-    return new jcString(std::string(mData.begin() + startIdx, mData.begin() + endIdx), getContext());
+    JC_ASSERT(startIdx >= 0 && endIdx <= size() && startIdx <= endIdx);
+
+    size_t start = startIdx;
+    size_t end = endIdx;
+    if (start == 0 && end == size()) {
+        return new jcString(mRope, getContext());
+    }
+
+    // narrow down to the node holding the whole slice
+    std::shared_ptr<Rope> node = mRope;
+    while (node->isLeaf() == false && (end <= node->left->size || start >= node->left->size)) {
+        if (end <= node->left->size) {
+            node = node->left;
+        } else {
+            start -= node->left->size;
+            end -= node->left->size;
+            node = node->right;
+        }
+    }
+
+    node->flatten();
+
+    // shares the characters instead of copying them
+    return new jcString(std::make_shared<Rope>(node->buffer, node->offset + start, end - start), getContext());
 }
 
 jcVariablePtr jcString::at(int index) const
 {
     JC_ASSERT(index >= 0 && index < size());
-    return jcVariable::Create(mData[index]);
+
+    if (mRope->depth > kMaxDepth) {
+        flatten();
+    }
+
+    const Rope *node = mRope.get();
+    while (node->isLeaf() == false) {
+        if ((size_t)index < node->left->size) {
+            node = node->left.get();
+        } else {
+            index -= node->left->size;
+            node = node->right.get();
+        }
+    }
+    return jcVariable::Create(node->chars()[index]);
 }
 
 jcVariable::Type jcString::getType() const
 {
     return jcVariable::TypeString;
 }
-
@@ -6,8 +6,14 @@
 #include "jcCollection.h"
 
 #include <string>
+#include <string_view>
 #include <memory>
 
+/**
+ Immutable string. ++ joins the two strings in a rope node instead of copying them, the characters
+ are copied into one buffer when they are needed as a whole, or to index a rope that has grown deep.
+ Slices are views into the buffer of the string they were cut from.
+ */
 class jcString : public jcCollection {
 public:
 
@@ -21,6 +27,9 @@ public:
 
     static jcStringPtr Create(const std::string &value, Context ctx);
 
+    /**
+     Flattens the string, a slice gets a buffer of its own
+     */
     const std::string& asStdString() const;
 
     bool equal(const jcString &other) const;
@@ -42,6 +51,26 @@ public:
     jcVariablePtr at(int index) const override;
 
 private:
-    std::string mData;
+    struct Rope;
+
+    jcString(const std::shared_ptr<Rope> &rope, Context ctx);
+
+    /**
+     Copies the leaves into the root, every string sharing the node sees the flat copy
+     */
+    void flatten() const;
+
+    /**
+     The characters, flattening the string first
+     */
+    std::string_view view() const;
+
+    // joins pieces up to this size into one leaf, so appending short strings does not create a node for each
+    static constexpr size_t kMaxLeafSize = 256;
+
+    // indexing a rope deeper than this flattens it first
+    static constexpr int kMaxDepth = 32;
+
+    std::shared_ptr<Rope> mRope;
     Context mCtx;
 };
@@ -0,0 +1,35 @@
+//  jcThunk.cpp
+
+#include "jcThunk.hpp"
+#include "jcClosure.hpp"
+#include "jcVariable.hpp"
+
+jcThunk::jcThunk(const jcClosurePtr &closure)
+: mClosure(closure)
+{
+}
+
+bool jcThunk::isEvaluated() const
+{
+    return mValue != nullptr;
+}
+
+const jcClosurePtr& jcThunk::closure() const
+{
+    return mClosure;
+}
+
+const jcVariablePtr& jcThunk::value() const
+{
+    JC_ASSERT(isEvaluated());
+    return mValue;
+}
+
+void jcThunk::setValue(const jcVariablePtr &value)
+{
+    JC_ASSERT(isEvaluated() == false);
+    mValue = value;
+
+    // the captures are no longer needed
+    mClosure = nullptr;
+}
@@ -0,0 +1,31 @@
+//  jcThunk.hpp
+
+#pragma once
+
+#include <memory>
+
+#include "jc.h"
+
+/**
+ A delayed argument. Holds the closure that computes the value until it is
+ forced, after which the value is memoized and the closure is released.
+ */
+class jcThunk {
+public:
+    jcThunk(const jcClosurePtr &closure);
+
+    bool isEvaluated() const;
+
+    const jcClosurePtr& closure() const;
+
+    const jcVariablePtr& value() const;
+
+    /**
+     Memoizes the forced value, the thunk can only be set once.
+     */
+    void setValue(const jcVariablePtr &value);
+
+private:
+    jcClosurePtr mClosure;
+    jcVariablePtr mValue;
+};
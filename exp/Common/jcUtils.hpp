@@ -2,12 +2,17 @@
 
 #pragma once
 
-#include <functional>
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <exception>
+#include <functional>
+#include <thread>
+#include <vector>
 
 namespace jc
 {
-    double measureElapsedTime(std::function<void(void)> function)
+    inline double measureElapsedTime(std::function<void(void)> function)
     {
         std::chrono::high_resolution_clock::time_point t1 = std::chrono::high_resolution_clock::now();
         function();
@@ -19,4 +24,44 @@ namespace jc
         // now round to 3 places
         return ((int)(secs * 1000)) / 1000.0;
     }
+
+    /**
+     Calls function(i) for every i below count on up to numThreads threads, 0 uses one per core.
+     The calling thread does its share. Rethrows the exception of the lowest i that threw,
+     so the error reported does not depend on the scheduling.
+     */
+    inline void parallelFor(size_t count, unsigned numThreads, const std::function<void(size_t)> &function)
+    {
+        if (numThreads == 0) {
+            numThreads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        numThreads = (unsigned)std::min<size_t>(numThreads, count);
+
+        std::vector<std::exception_ptr> errors(count);
+        std::atomic<size_t> next(0);
+        auto work = [&]() {
+            for (size_t i = next++; i < count; i = next++) {
+                try {
+                    function(i);
+                } catch (...) {
+                    errors[i] = std::current_exception();
+                }
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (unsigned i = 1; i < numThreads; i++) {
+            threads.emplace_back(work);
+        }
+        work();
+        for (std::thread &thread : threads) {
+            thread.join();
+        }
+
+        for (std::exception_ptr &error : errors) {
+            if (error) {
+                std::rethrow_exception(error);
+            }
+        }
+    }
 }
@@ -5,6 +5,10 @@
 #include "jcClosure.hpp"
 #include "jcString.hpp"
 #include "jcList.hpp"
+#include "jcThunk.hpp"
+#include "jcReclaimer.hpp"
+
+#include <type_traits>
 
 jcVariablePtr jcVariable::Create()
 {
@@ -60,6 +64,13 @@ jcVariablePtr jcVariable::Create(const jcListPtr &value)
     return me;
 }
 
+jcVariablePtr jcVariable::Create(const jcThunkPtr &thunk)
+{
+    auto me = jcVariable::Create();
+    me->set_Thunk(thunk);
+    return me;
+}
+
 jcVariable::jcVariable()
     : mCurrentType(TypeNone)
 {
@@ -82,6 +93,16 @@ jcVariablePtr jcVariable::CreateFromCollection(const jcCollectionPtr &collection
 
 jcVariable::~jcVariable()
 {
+    // the last reference to something holding variables, which may hold more of them
+    std::visit([](auto &value) {
+        using T = std::decay_t<decltype(value)>;
+        if constexpr (std::is_same<T, jcArrayPtr>::value || std::is_same<T, jcClosurePtr>::value ||
+                      std::is_same<T, jcListPtr>::value || std::is_same<T, jcThunkPtr>::value) {
+            if (value.use_count() == 1) {
+                jcReclaimer::release(std::move(value));
+            }
+        }
+    }, mData);
 }
 
 std::string jcVariable::asString() const
@@ -139,6 +160,14 @@ jcList* jcVariable::asListRaw() const {
     return nullptr;
 }
 
+jcThunk* jcVariable::asThunkRaw() const
+{
+    if (mCurrentType == TypeThunk) {
+        return std::get<jcThunkPtr>(mData).get();
+    }
+    return nullptr;
+}
+
 jcCollection* jcVariable::asCollection() const
 {
     switch (getType()) {
@@ -194,6 +223,12 @@ void jcVariable::set_List(const jcListPtr &list) {
     mCurrentType = TypeList;
 }
 
+void jcVariable::set_Thunk(const jcThunkPtr &thunk)
+{
+    mData = thunk;
+    mCurrentType = TypeThunk;
+}
+
 std::string jcVariable::stringRepresentation() const {
     if (getType() == TypeInt) {
         return std::to_string(asInt());
@@ -22,6 +22,7 @@ public:
         TypeArray,
         TypeClosure,
         TypeList,
+        TypeThunk,
         TypeNone
     };
 
@@ -34,6 +35,7 @@ public:
     static jcVariablePtr Create(const jcClosurePtr &closure);
     static jcVariablePtr Create(const jcStringPtr &value);
     static jcVariablePtr Create(const jcListPtr &value);
+    static jcVariablePtr Create(const jcThunkPtr &thunk);
 
      static jcVariablePtr CreateFromCollection(const jcCollectionPtr &collection);
 
@@ -46,6 +48,7 @@ public:
     jcClosure* asClosureRaw() const;
     jcString* asJcStringRaw() const;
     jcList* asListRaw() const;
+    jcThunk* asThunkRaw() const;
     jcCollection *asCollection() const;
 
     /**
@@ -85,6 +88,7 @@ protected:
     void set_Char(const char val);
     void set_jcString(const jcStringPtr &string);
     void set_List(const jcListPtr &list);
+    void set_Thunk(const jcThunkPtr &thunk);
 
 protected:
     Type mCurrentType;
@@ -95,7 +99,8 @@ protected:
         jcArrayPtr,
         jcClosurePtr,
         jcStringPtr,
-        jcListPtr> mData;
+        jcListPtr,
+        jcThunkPtr> mData;
 };
 
 class jcMutableVariable : public jcVariable
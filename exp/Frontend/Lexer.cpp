@@ -5,234 +5,372 @@
 #include "jc.h"
 #include "jcString.hpp"
 
-Lexer::Lexer(std::istream& inputStream)
-    : mInput(inputStream)
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define JC_LEXER_SIMD 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define JC_LEXER_SIMD 1
+#endif
+
+namespace {
+
+enum class CharClass {
+    Whitespace,
+    Alnum,
+    Digit,
+};
+
+// ascii only, like the grammar
+template <CharClass cls>
+inline bool inClass(unsigned char c)
 {
+    switch (cls) {
+    case CharClass::Whitespace:
+        return c == ' ' || (unsigned char)(c - '\t') <= '\r' - '\t';
+    case CharClass::Alnum:
+        return (unsigned char)((c | 0x20) - 'a') <= 'z' - 'a' || (unsigned char)(c - '0') <= 9;
+    case CharClass::Digit:
+        return (unsigned char)(c - '0') <= 9;
+    }
+    return false;
 }
 
-Token Lexer::peekToken()
+#if defined(__SSE2__)
+
+// c - low <= high - low, unsigned
+inline __m128i inRange(__m128i bytes, char low, char high)
 {
-    int64_t i = position();
-    int64_t tmpLineNum = mLineNumber;
-    Token peeked = getNextToken();
-    seekPosition(i);
-    mLineNumber = tmpLineNum;
+    __m128i offset = _mm_sub_epi8(bytes, _mm_set1_epi8(low));
+    return _mm_cmpeq_epi8(_mm_min_epu8(offset, _mm_set1_epi8(high - low)), offset);
+}
 
-    return peeked;
+/**
+ Bit i is set when byte i of the 16 at p is in the class
+ */
+template <CharClass cls>
+inline uint32_t classMask(const char *p)
+{
+    __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    __m128i matches = _mm_setzero_si128();
+    switch (cls) {
+    case CharClass::Whitespace:
+        matches = _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(' ')), inRange(bytes, '\t', '\r'));
+        break;
+    case CharClass::Alnum:
+        matches = _mm_or_si128(inRange(_mm_or_si128(bytes, _mm_set1_epi8(0x20)), 'a', 'z'), inRange(bytes, '0', '9'));
+        break;
+    case CharClass::Digit:
+        matches = inRange(bytes, '0', '9');
+        break;
+    }
+    return (uint32_t)_mm_movemask_epi8(matches);
 }
 
-void Lexer::skipToken()
+#elif defined(__ARM_NEON)
+
+inline uint8x16_t inRange(uint8x16_t bytes, char low, char high)
 {
-    getNextToken();
+    return vcleq_u8(vsubq_u8(bytes, vdupq_n_u8(low)), vdupq_n_u8(high - low));
 }
 
-int64_t Lexer::getLineNumber() const
+template <CharClass cls>
+inline uint32_t classMask(const char *p)
 {
-    return mLineNumber;
+    uint8x16_t bytes = vld1q_u8(reinterpret_cast<const uint8_t*>(p));
+    uint8x16_t matches = vdupq_n_u8(0);
+    switch (cls) {
+    case CharClass::Whitespace:
+        matches = vorrq_u8(vceqq_u8(bytes, vdupq_n_u8(' ')), inRange(bytes, '\t', '\r'));
+        break;
+    case CharClass::Alnum:
+        matches = vorrq_u8(inRange(vorrq_u8(bytes, vdupq_n_u8(0x20)), 'a', 'z'), inRange(bytes, '0', '9'));
+        break;
+    case CharClass::Digit:
+        matches = inRange(bytes, '0', '9');
+        break;
+    }
+
+    // no movemask, weigh each lane by its bit and add up the halves
+    static const uint8_t weights[16] = { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+    uint8x16_t bits = vandq_u8(matches, vld1q_u8(weights));
+    return vaddv_u8(vget_low_u8(bits)) | (vaddv_u8(vget_high_u8(bits)) << 8);
 }
 
-Token Lexer::getNextToken()
+#endif
+
+/**
+ Returns the end of the run of class characters starting at p
+ */
+template <CharClass cls>
+const char* scanRun(const char *p, const char *end)
 {
-    TokenType nextToken = TokenType::Error;
-    if (hasMoreChars()) {
-        char next;
-        if (nextNonWhitespaceChar(&next) == false) {
-            return Token(TokenType::EndOfStream, nullptr, mLineNumber);
-        }
+    // most runs are a single space or a short name, don't load a block for those
+    if (p == end || inClass<cls>(*p) == false) {
+        return p;
+    }
 
-        switch (next) {
-        case '(':
-            nextToken = TokenType::LParen;
-            break;
-        case ')':
-            nextToken = TokenType::RParen;
-            break;
-        case '+':
-            nextToken = TokenType::Add;
-            break;
-        case '!':
-            nextToken = TokenType::Bang;
-            break;
-        case '-':
-            nextToken = TokenType::Subtract;
-            break;
-        case '/':
-            nextToken = TokenType::Divide;
-            break;
-        case '*':
-            nextToken = TokenType::Multiply;
-            break;
-        case '=':
-            nextToken = TokenType::Assign;
-            break;
-        case ',':
-            nextToken = TokenType::Comma;
-            break;
-        case '>':
-            nextToken = TokenType::Greater_Than;
-            break;
-        case '<':
-            nextToken = TokenType::Less_Than;
-            break;
-        case '|':
-            nextToken = TokenType::Pipe;
-            break;
-        case '[':
-            nextToken = TokenType::LeftBracket;
-            break;
-        case ']':
-            nextToken = TokenType::RightBracket;
-            break;
-        case '{':
-            nextToken = TokenType::LeftBrace;
-            break;
-        case '}':
-            nextToken = TokenType::RightBrace;
-            break;
-        case ':':
-            nextToken = TokenType::Colon;
-            break;
-        case '?':
-            nextToken = TokenType::QuestionMark;
-            break;
-        case '#':
-            // comment!
-            skipTillNewline();
-            return getNextToken();
-        default:
-            break;
+#if JC_LEXER_SIMD
+    while (end - p >= 16) {
+        uint32_t outside = ~classMask<cls>(p) & 0xFFFF;
+        if (outside) {
+            return p + __builtin_ctz(outside);
         }
+        p += 16;
+    }
+#endif
 
-        if (nextToken != TokenType::Error) {
-            return Token(resolveTwoCharOperator(nextToken), nullptr, mLineNumber);
-        }
+    while (p < end && inClass<cls>(*p)) {
+        p++;
+    }
+    return p;
+}
 
-        // must be a number
-        if (isdigit(next)) {
-            std::string numString = "";
-            numString += next;
-            while (isdigit(peek())) {
-                numString += nextChar();
-                if (!hasMoreChars()) {
-                    break;
-                }
-            }
-            int value = atoi(numString.c_str());
+}
 
-            return Token(TokenType::Num, jcVariable::Create(value), mLineNumber);
-        } else if (isalpha(next)) {
-            std::string word(1, next);
+Lexer::Lexer(std::istream& inputStream)
+    : mBuffer(std::istreambuf_iterator<char>(inputStream), std::istreambuf_iterator<char>())
+    , mCursor(mBuffer.data())
+    , mEnd(mBuffer.data() + mBuffer.size())
+    , mRing(kLookahead, Token(TokenType::None, nullptr, 0))
+{
+}
+
+Lexer::Lexer(const char *data, size_t size, int64_t firstLine)
+    : mCursor(data)
+    , mEnd(data + size)
+    , mScanLine(firstLine)
+    , mLineNumber(firstLine)
+    , mRing(kLookahead, Token(TokenType::None, nullptr, 0))
+{
+}
 
-            while (hasMoreChars() && isalnum(peek())) {
-                word += std::string(1, nextChar());
+std::vector<Lexer::Chunk> Lexer::split(size_t minSize)
+{
+    JC_ASSERT(mNumBuffered == 0);
 
-                TokenType keywordToken = TokenType::Error;
-                if (word == "let") {
-                    keywordToken = TokenType::LetKw;
-                } else if (word == "else") {
-                    keywordToken = TokenType::ElseKw;
-                }
+    std::vector<Chunk> chunks;
+    const char *chunkStart = mCursor;
+    int64_t chunkLine = mScanLine;
 
-                if (keywordToken != TokenType::Error) {
-                    return Token(keywordToken, nullptr, mLineNumber);
-                }
-            }
+    // only tells words and strings apart, the tokens are lexed again with the chunk
+    while (true) {
+        skipWhitespace(mCursor, mScanLine);
+        if (atEnd(mCursor)) {
+            break;
+        }
+
+        const char *start = mCursor;
+        char next = *mCursor++;
 
-            return Token(TokenType::Id, jcVariable::Create(word), mLineNumber);
+        if (inClass<CharClass::Digit>(next)) {
+            mCursor = scanRun<CharClass::Digit>(mCursor, mEnd);
+        } else if (isalpha(next)) {
+            mCursor = scanRun<CharClass::Alnum>(mCursor, mEnd);
+
+            if (mCursor - start == 3 && memcmp(start, "let", 3) == 0 && (size_t)(start - chunkStart) >= minSize) {
+                chunks.push_back({ chunkStart, (size_t)(start - chunkStart), chunkLine });
+                chunkStart = start;
+                chunkLine = mScanLine;
+            }
         } else if (next == '"') {
-            std::string stringValue = "";
-            for (char c = nextChar(); c != '"'; c = nextChar()) {
-                // TODO
-                JC_ASSERT_OR_THROW_PARSE(c != '\\',
-                                         "I see you are trying to use an escape character, this has not been implemented!",
-                                         mLineNumber);
-
-                stringValue += c;
+            const char *quote = static_cast<const char*>(memchr(mCursor, '"', mEnd - mCursor));
+            if (quote == nullptr) {
+                // lexing the last chunk reports it
+                break;
             }
-            jcStringPtr jcStringValue = jcString::Create(stringValue, jcString::StringContextValue);
-            return Token(TokenType::String, jcVariable::Create(jcStringValue), mLineNumber);
-        } else {
-            return Token(TokenType::Error, nullptr, mLineNumber);
+            mScanLine += std::count(mCursor, quote, '\n');
+            mCursor = quote + 1;
         }
-    } else {
-        return Token(TokenType::EndOfStream, nullptr, mLineNumber);
     }
-    return Token(TokenType::Error, nullptr, mLineNumber);
-}
-
-TokenType Lexer::resolveTwoCharOperator(TokenType firstOperator)
-{
-    TokenType returnToken = firstOperator;
-    Token peeked = peekToken();
-    bool foundTwoCharOp = false;
-    if (peeked.getType() != TokenType::Error) {
-        if (firstOperator == TokenType::Greater_Than && peeked.getType() == TokenType::Assign) {
-            returnToken = TokenType::Greater_Than_Equal;
-            foundTwoCharOp = true;
-        } else if (firstOperator == TokenType::Less_Than && peeked.getType() == TokenType::Assign) {
-            returnToken = TokenType::Less_Than_Equal;
-            foundTwoCharOp = true;
-        } else if (firstOperator == TokenType::Assign && peeked.getType() == TokenType::Assign) {
-            returnToken = TokenType::Equals;
-            foundTwoCharOp = true;
-        } else if (firstOperator == TokenType::Colon && peeked.getType() == TokenType::Colon) {
-            returnToken = TokenType::Cons;
-            foundTwoCharOp = true;
-        } else if (firstOperator == TokenType::Add && peeked.getType() == TokenType::Add) {
-            returnToken = TokenType::Concat;
-            foundTwoCharOp = true;
-        }
+
+    if (chunkStart != mEnd) {
+        chunks.push_back({ chunkStart, (size_t)(mEnd - chunkStart), chunkLine });
     }
-    if (foundTwoCharOp) {
-        skipToken();
+    mCursor = mEnd;
+    return chunks;
+}
+
+Token Lexer::peekToken(size_t ahead)
+{
+    JC_ASSERT(ahead < kLookahead);
+    while (mNumBuffered <= ahead) {
+        mRing[(mFirstBuffered + mNumBuffered) % kLookahead] = lexToken();
+        mNumBuffered++;
     }
-    return returnToken;
+    return mRing[(mFirstBuffered + ahead) % kLookahead];
 }
 
-char Lexer::peek()
+Token Lexer::getNextToken()
 {
-    return mInput.peek();
+    Token token = peekToken();
+    mFirstBuffered = (mFirstBuffered + 1) % kLookahead;
+    mNumBuffered--;
+
+    mLineNumber = token.getLineNumber();
+    return token;
 }
 
-char Lexer::nextChar()
+void Lexer::skipToken()
 {
-    char next = mInput.get();
-    if (next == '\n') mLineNumber++;
-    return next;
+    getNextToken();
 }
 
-int64_t Lexer::position()
+int64_t Lexer::getLineNumber() const
 {
-    return mInput.tellg();
+    return mLineNumber;
 }
 
-void Lexer::seekPosition(int64_t pos)
+bool Lexer::atEnd(const char *cursor) const
 {
-    mInput.seekg(pos);
+    return cursor == mEnd || *cursor == '\0';
 }
 
-bool Lexer::nextNonWhitespaceChar(char* c)
+void Lexer::skipWhitespace(const char *&cursor, int64_t &line) const
 {
-    while (hasMoreChars() && isspace(peek())) {
-        nextChar();
-    }
+    while (true) {
+        const char *start = cursor;
+        cursor = scanRun<CharClass::Whitespace>(cursor, mEnd);
+        line += std::count(start, cursor, '\n');
 
-    if (hasMoreChars()) {
-        if (c != nullptr) {
-            *c = peek();
+        if (cursor == mEnd || *cursor != '#') {
+            return;
         }
-        nextChar();
-        return true;
+
+        // comment, the newline is counted with the next run
+        const char *newline = static_cast<const char*>(memchr(cursor, '\n', mEnd - cursor));
+        cursor = newline ? newline : mEnd;
     }
-    return false;
 }
 
-bool Lexer::hasMoreChars()
+bool Lexer::matchSecondChar(char c)
 {
-    return mInput.eof() == false && peek() != EOF && peek() != '\0';
+    // whitespace may separate the two characters
+    const char *cursor = mCursor;
+    int64_t line = mScanLine;
+    skipWhitespace(cursor, line);
+
+    if (atEnd(cursor) || *cursor != c) {
+        return false;
+    }
+
+    mCursor = cursor + 1;
+    mScanLine = line;
+    return true;
 }
 
-void Lexer::skipTillNewline()
+Token Lexer::lexToken()
 {
-    while (nextChar() != '\n' && hasMoreChars());
+    skipWhitespace(mCursor, mScanLine);
+    if (atEnd(mCursor)) {
+        return Token(TokenType::EndOfStream, nullptr, mScanLine);
+    }
+
+    const char *start = mCursor;
+    char next = *mCursor++;
+
+    TokenType nextToken = TokenType::Error;
+    switch (next) {
+    case '(':
+        nextToken = TokenType::LParen;
+        break;
+    case ')':
+        nextToken = TokenType::RParen;
+        break;
+    case '+':
+        nextToken = matchSecondChar('+') ? TokenType::Concat : TokenType::Add;
+        break;
+    case '!':
+        nextToken = TokenType::Bang;
+        break;
+    case '-':
+        nextToken = TokenType::Subtract;
+        break;
+    case '/':
+        nextToken = TokenType::Divide;
+        break;
+    case '*':
+        nextToken = TokenType::Multiply;
+        break;
+    case '=':
+        nextToken = matchSecondChar('=') ? TokenType::Equals : TokenType::Assign;
+        break;
+    case ',':
+        nextToken = TokenType::Comma;
+        break;
+    case '>':
+        nextToken = matchSecondChar('=') ? TokenType::Greater_Than_Equal : TokenType::Greater_Than;
+        break;
+    case '<':
+        nextToken = matchSecondChar('=') ? TokenType::Less_Than_Equal : TokenType::Less_Than;
+        break;
+    case '|':
+        nextToken = TokenType::Pipe;
+        break;
+    case '[':
+        nextToken = TokenType::LeftBracket;
+        break;
+    case ']':
+        nextToken = TokenType::RightBracket;
+        break;
+    case '{':
+        nextToken = TokenType::LeftBrace;
+        break;
+    case '}':
+        nextToken = TokenType::RightBrace;
+        break;
+    case ':':
+        nextToken = matchSecondChar(':') ? TokenType::Cons : TokenType::Colon;
+        break;
+    case '?':
+        nextToken = TokenType::QuestionMark;
+        break;
+    default:
+        break;
+    }
+
+    if (nextToken != TokenType::Error) {
+        return Token(nextToken, nullptr, mScanLine);
+    }
+
+    // must be a number
+    if (inClass<CharClass::Digit>(next)) {
+        mCursor = scanRun<CharClass::Digit>(mCursor, mEnd);
+
+        int64_t value = 0;
+        for (const char *digit = start; digit < mCursor; digit++) {
+            value = value * 10 + (*digit - '0');
+        }
+        return Token(TokenType::Num, jcVariable::Create((int)value), mScanLine);
+    } else if (isalpha(next)) {
+        mCursor = scanRun<CharClass::Alnum>(mCursor, mEnd);
+
+        std::string word(start, mCursor);
+        if (word == "let") {
+            return Token(TokenType::LetKw, nullptr, mScanLine);
+        } else if (word == "else") {
+            return Token(TokenType::ElseKw, nullptr, mScanLine);
+        }
+        return Token(TokenType::Id, jcVariable::Create(word), mScanLine);
+    } else if (next == '"') {
+        const char *quote = static_cast<const char*>(memchr(mCursor, '"', mEnd - mCursor));
+        JC_ASSERT_OR_THROW_PARSE(quote != nullptr, "Unterminated string", mScanLine);
+
+        // TODO
+        JC_ASSERT_OR_THROW_PARSE(memchr(mCursor, '\\', quote - mCursor) == nullptr,
+                                 "I see you are trying to use an escape character, this has not been implemented!",
+                                 mScanLine);
+
+        std::string stringValue(mCursor, quote);
+        mScanLine += std::count(mCursor, quote, '\n');
+        mCursor = quote + 1;
+
+        jcStringPtr jcStringValue = jcString::Create(stringValue, jcString::StringContextValue);
+        return Token(TokenType::String, jcVariable::Create(jcStringValue), mScanLine);
+    }
+    return Token(TokenType::Error, nullptr, mScanLine);
 }
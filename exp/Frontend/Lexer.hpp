@@ -4,40 +4,83 @@
 
 #include <istream>
 #include <string>
+#include <vector>
 
 #include "Token.hpp"
 #include "jcVariable.hpp"
 
 class Lexer {
 public:
+    /**
+     Lexes the rest of the stream, which is read into a buffer up front
+     */
     Lexer(std::istream& inputStream);
 
-    Token peekToken();
+    /**
+     Lexes a buffer the caller keeps alive, e.g. a mapped SourceFile. firstLine is the line the buffer starts on.
+     */
+    Lexer(const char *data, size_t size, int64_t firstLine = 0);
+
+    /**
+     A piece of the input that can be lexed on its own
+     */
+    struct Chunk {
+        const char *data;
+        size_t size;
+        int64_t line;
+    };
+
+    /**
+     Consumes the rest of the input and cuts it into chunks of at least minSize bytes.
+     Chunks only start on a let, which is always a top level definition, and point into the input.
+     */
+    std::vector<Chunk> split(size_t minSize);
+
+    /**
+     Returns a token without consuming it, ahead is the number of tokens to look past
+     */
+    Token peekToken(size_t ahead = 0);
 
     Token getNextToken();
 
     void skipToken();
 
+    /**
+     Line of the last token consumed
+     */
     int64_t getLineNumber() const;
 
-private:
-    std::istream& mInput;
-    int64_t mLineNumber=0;
+    // tokens that can be looked at before they are consumed
+    static const size_t kLookahead = 4;
 
 private:
+    // input, owned when lexing a stream
+    std::string mBuffer;
+    const char *mCursor;
+    const char *mEnd;
 
-    void skipTillNewline();
+    // line of the cursor
+    int64_t mScanLine=0;
+    int64_t mLineNumber=0;
 
-    char peek();
+    // lexed tokens not consumed yet, mNumBuffered of them from mFirstBuffered on
+    std::vector<Token> mRing;
+    size_t mFirstBuffered=0;
+    size_t mNumBuffered=0;
 
-    char nextChar();
+private:
 
-    int64_t position();
-    void seekPosition(int64_t pos);
+    Token lexToken();
 
-    bool nextNonWhitespaceChar(char* c);
+    /**
+     Moves the cursor past whitespace and comments
+     */
+    void skipWhitespace(const char *&cursor, int64_t &line) const;
 
-    bool hasMoreChars();
+    /**
+     Consumes the second character of a two character operator if it follows
+     */
+    bool matchSecondChar(char c);
 
-    TokenType resolveTwoCharOperator(TokenType firstOperator);
+    bool atEnd(const char *cursor) const;
 };
@@ -13,20 +13,54 @@ Parser::Parser(Lexer& lexer)
 {
 }
 
-std::vector<std::shared_ptr<Node>> Parser::parse()
+std::vector<Node*> Parser::parse()
 {
-    std::vector<std::shared_ptr<Node>> output;
-    while (auto node = parseLine()) {
+    std::vector<Node*> output;
+    mLines.clear();
+    while (true) {
+        auto node = parseLine();
+        if (node == nullptr) {
+            break;
+        }
         output.push_back(node);
+        mLines.push_back(mLastLine);
     }
     return output;
 }
 
-std::shared_ptr<Node> Parser::parseLine()
+int64_t Parser::lastLine() const
+{
+    return mLastLine;
+}
+
+void Parser::releaseNodes()
+{
+    mArena.clear();
+}
+
+const std::vector<int64_t>& Parser::lines() const
+{
+    return mLines;
+}
+
+const Arena& Parser::arena() const
+{
+    return mArena;
+}
+
+Span<Expression*> Parser::popExpressions(size_t first)
+{
+    Span<Expression*> expressions = mArena.copy(mExpressions.data() + first, mExpressions.size() - first);
+    mExpressions.resize(first);
+    return expressions;
+}
+
+Node* Parser::parseLine()
 {
     if (peekToken().getType() == TokenType::EndOfStream) {
         return nullptr;
     }
+    mLastLine = peekToken().getLineNumber();
 
     if (peekToken().getType() == TokenType::LetKw) {
         return getFunctionDecl();
@@ -50,10 +84,10 @@ bool Parser::peekExpression()
            token == TokenType::String;
 }
 
-std::vector<std::shared_ptr<Expression>> Parser::getFunctionCallArgs()
+Span<Expression*> Parser::getFunctionCallArgs()
 {
     eat(TokenType::LParen);
-    std::vector<std::shared_ptr<Expression>> args;
+    size_t first = mExpressions.size();
     while (1) {
         if (peekExpression() == false) {
             break;
@@ -61,7 +95,7 @@ std::vector<std::shared_ptr<Expression>> Parser::getFunctionCallArgs()
 
         auto argument = getExpression();
 
-        args.push_back(argument);
+        mExpressions.push_back(argument);
 
         if (peekToken().getType() != TokenType::RParen) {
             eat(TokenType::Comma);
@@ -69,26 +103,26 @@ std::vector<std::shared_ptr<Expression>> Parser::getFunctionCallArgs()
     }
 
     eat(TokenType::RParen);
-    return args;
+    return popExpressions(first);
 }
 
-std::shared_ptr<Expression> Parser::getPostfixOps(std::shared_ptr<Expression> expIn)
+Expression* Parser::getPostfixOps(Expression* expIn)
 {
     if (peekToken().getType() == TokenType::LParen) {
         auto functionCallArgs = getFunctionCallArgs();
-        return getPostfixOps(std::make_shared<FunctionCallExpression>(expIn, functionCallArgs));
+        return getPostfixOps(mArena.make<FunctionCallExpression>(expIn, functionCallArgs));
     } else if (peekToken().getType() == TokenType::LeftBracket) {
         nextToken();
 
         if (peekToken().getType() == TokenType::Colon) {
             nextToken();
 
-            std::shared_ptr<Expression> expression2 = nullptr;
+            Expression* expression2 = nullptr;
             if (peekToken().getType() != TokenType::RightBracket) {
                 expression2 = getExpression();
             }
 
-            auto sliceExpression = getPostfixOps(std::make_shared<SliceExpression>(expIn, nullptr, expression2));
+            auto sliceExpression = getPostfixOps(mArena.make<SliceExpression>(expIn, nullptr, expression2));
             eat(TokenType::RightBracket);
             return sliceExpression;
         }
@@ -98,16 +132,16 @@ std::shared_ptr<Expression> Parser::getPostfixOps(std::shared_ptr<Expression> ex
         if (peekToken().getType() == TokenType::Colon) {
             nextToken();
 
-            std::shared_ptr<Expression> expression2 = nullptr;
+            Expression* expression2 = nullptr;
             if (peekToken().getType() != TokenType::RightBracket) {
                 expression2 = getExpression();
             }
 
-            auto sliceExpression = getPostfixOps(std::make_shared<SliceExpression>(expIn, expression, expression2));
+            auto sliceExpression = getPostfixOps(mArena.make<SliceExpression>(expIn, expression, expression2));
             eat(TokenType::RightBracket);
             return sliceExpression;
         } else {
-            auto indexExpression = getPostfixOps(std::make_shared<IndexExpression>(expIn, expression));
+            auto indexExpression = getPostfixOps(mArena.make<IndexExpression>(expIn, expression));
             eat(TokenType::RightBracket);
             return indexExpression;
         }
@@ -115,48 +149,48 @@ std::shared_ptr<Expression> Parser::getPostfixOps(std::shared_ptr<Expression> ex
     return expIn;
 }
 
-std::shared_ptr<Expression> Parser::getPrefixOps(std::shared_ptr<Expression> expIn, TokenType prefixOp)
+Expression* Parser::getPrefixOps(Expression* expIn, TokenType prefixOp)
 {
     switch (prefixOp) {
         case TokenType::Subtract:
-            return std::make_shared<NegateExpression>(expIn);
+            return mArena.make<NegateExpression>(expIn);
         case TokenType::Bang:
-            return std::make_shared<NotExpression>(expIn);
+            return mArena.make<NotExpression>(expIn);
         default:
             JC_THROW_PARSE_EXCEPTION("Invalid prefix operator", lex.getLineNumber());
     }
 }
 
-std::shared_ptr<Expression> Parser::getTerm()
+Expression* Parser::getTerm()
 {
     Token tok = nextToken();
     if (tok.getType() == TokenType::Num) {
-        return std::make_shared<IntExpression>(IntExpression(tok.getLexeme()->asInt()));
+        return mArena.make<IntExpression>(tok.getLexeme()->asInt());
     } else if (tok.getType() == TokenType::LParen) {
         auto exp = getExpression();
         eat(TokenType::RParen);
         return exp;
     } else if (tok.getType() == TokenType::Id) {
-        return std::make_shared<VariableExpression>(tok.getLexeme()->asString());
+        return mArena.make<VariableExpression>(mArena.copy(tok.getLexeme()->asString()));
     } else if (tok.getType() == TokenType::String) {
-        return std::make_shared<StringExpression>(tok.getLexeme()->asSharedPtr<jcString>());
+        return mArena.make<StringExpression>(mArena.copy(tok.getLexeme()->asString()));
     } else if (tok.getType() == TokenType::LeftBracket) {
-        std::vector<std::shared_ptr<Expression>> elements;
+        size_t first = mExpressions.size();
         while (1) {
             if (peekExpression() == false) {
                 break;
             }
-            elements.push_back(getExpression());
+            mExpressions.push_back(getExpression());
             if (peekToken().getType() != TokenType::RightBracket) {
                 eat(TokenType::Comma);
             }
         }
         eat(TokenType::RightBracket);
-        return std::make_shared<ListExpression>(elements);
+        return mArena.make<ListExpression>(popExpressions(first));
     } else if (tok.getType() == TokenType::LeftBrace) {
         auto closure = getFunctionBody();
         eat(TokenType::RightBrace);
-        return std::make_shared<Closure>(closure);
+        return mArena.make<Closure>(closure);
     }
     return nullptr;
 }
@@ -197,9 +231,9 @@ TokenType Parser::peekPrefixOp()
     }
 }
 
-std::vector<std::string> Parser::getFunctionParams()
+Span<std::string_view> Parser::getFunctionParams()
 {
-    std::vector<std::string> funcParams;
+    std::vector<std::string_view> funcParams;
 
     if (peekToken().getType() == TokenType::LParen) {
         eat(TokenType::LParen);
@@ -207,7 +241,7 @@ std::vector<std::string> Parser::getFunctionParams()
         while (peekToken().getType() == TokenType::Id) {
             jcVariablePtr var = nextToken().getLexeme();
 
-            funcParams.push_back(var->asString());
+            funcParams.push_back(mArena.copy(var->asString()));
 
             if (peekToken().getType() != TokenType::Comma) {
                 break;
@@ -217,12 +251,12 @@ std::vector<std::string> Parser::getFunctionParams()
         }
         eat(TokenType::RParen);
     }
-    return funcParams;
+    return mArena.copy(funcParams);
 }
 
-std::vector<std::shared_ptr<Guard>> Parser::getGuards()
+Span<Guard*> Parser::getGuards()
 {
-    std::vector<std::shared_ptr<Guard>> guards;
+    std::vector<Guard*> guards;
 
     while (peekToken().getType() == TokenType::Pipe) {
         skipToken();
@@ -236,25 +270,25 @@ std::vector<std::shared_ptr<Guard>> Parser::getGuards()
         eat(TokenType::Assign);
         auto bodyExpression = getExpression();
 
-        guards.push_back(std::make_shared<Guard>(guardExpression, bodyExpression));
+        guards.push_back(mArena.make<Guard>(guardExpression, bodyExpression));
     }
-    return guards;
+    return mArena.copy(guards);
 }
 
-std::shared_ptr<FunctionBody> Parser::getFunctionBody()
+FunctionBody* Parser::getFunctionBody()
 {
-    std::vector<std::string> funcParams = getFunctionParams();
+    Span<std::string_view> funcParams = getFunctionParams();
 
-    std::vector<std::shared_ptr<Guard>> guards = getGuards();
+    Span<Guard*> guards = getGuards();
 
     eat(TokenType::Assign);
     auto exp = getExpression();
     JC_ASSERT_OR_THROW_PARSE(exp != nullptr, "Function must have expression", lex.getLineNumber());
 
-    return std::make_shared<FunctionBody>(exp, funcParams, guards);
+    return mArena.make<FunctionBody>(exp, funcParams, guards);
 }
 
-std::shared_ptr<FunctionDecl> Parser::getFunctionDecl()
+FunctionDecl* Parser::getFunctionDecl()
 {
     eat(TokenType::LetKw);
 
@@ -262,18 +296,18 @@ std::shared_ptr<FunctionDecl> Parser::getFunctionDecl()
 
     JC_ASSERT_OR_THROW_PARSE(tok.getType() == TokenType::Id, "Expected an ID", lex.getLineNumber());
     
-    auto decl = std::make_shared<FunctionDecl>(tok.getLexeme()->asString(), getFunctionBody());
+    auto decl = mArena.make<FunctionDecl>(mArena.copy(tok.getLexeme()->asString()), getFunctionBody());
     return decl;
 }
 
-std::shared_ptr<Expression> Parser::getExpression(int prevPrec)
+Expression* Parser::getExpression(int prevPrec)
 {
     TokenType prefixOp = peekPrefixOp();
     if (prefixOp != TokenType::Error) {
         skipToken();
     }
     
-    std::shared_ptr<Expression> left = getPostfixOps(getTerm());
+    Expression* left = getPostfixOps(getTerm());
 
     if (prefixOp != TokenType::Error) {
         left = getPrefixOps(left, prefixOp);
@@ -308,10 +342,10 @@ std::shared_ptr<Expression> Parser::getExpression(int prevPrec)
 
             auto falseExpression = getExpression(1);
 
-            left = std::make_shared<TernaryExpresssion>(left, trueExpression, falseExpression);
+            left = mArena.make<TernaryExpresssion>(left, trueExpression, falseExpression);
         } else {
             auto right = getExpression(nextPrec);
-            left = std::make_shared<BinaryExpression>(BinaryExpression(left, op, right));
+            left = mArena.make<BinaryExpression>(left, op, right);
         }
     }
     return left;
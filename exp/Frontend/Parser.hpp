@@ -2,8 +2,10 @@
 
 #pragma once
 
+#include "Arena.hpp"
 #include "jcVariable.hpp"
-#include <memory>
+#include <string_view>
+#include <vector>
 
 class Lexer;
 class Expression;
@@ -16,27 +18,62 @@ class Parser {
 public:
     Parser(Lexer& lexer);
 
-    std::vector<std::shared_ptr<Node>> parse();
-    std::shared_ptr<Node> parseLine();
+    /**
+     The nodes returned are owned by the parser's arena and freed with the parser
+     */
+    std::vector<Node*> parse();
+
+    /**
+     Parses the next top level definition or expression, nullptr at the end of the input
+     */
+    Node* parseLine();
+
+    /**
+     Line the node returned by the last parseLine() starts on
+     */
+    int64_t lastLine() const;
+
+    /**
+     Frees every node parsed so far
+     */
+    void releaseNodes();
+
+    /**
+     Line each node returned by the last parse() starts on
+     */
+    const std::vector<int64_t>& lines() const;
+
+    const Arena& arena() const;
 
     // private member variables
 private:
     Lexer& lex;
+    std::vector<int64_t> mLines;
+    int64_t mLastLine=0;
+    Arena mArena;
+
+    // elements of the argument and list literals being parsed, copied into the arena once complete
+    std::vector<Expression*> mExpressions;
     // private helper functions
 private:
-    std::shared_ptr<Expression> getTerm();
+    Expression* getTerm();
+
+    Span<std::string_view> getFunctionParams();
+    Span<Guard*> getGuards();
+    FunctionBody* getFunctionBody();
 
-    std::vector<std::string> getFunctionParams();
-    std::vector<std::shared_ptr<Guard>> getGuards();
-    std::shared_ptr<FunctionBody> getFunctionBody();
+    Span<Expression*> getFunctionCallArgs();
 
-    std::vector<std::shared_ptr<Expression>> getFunctionCallArgs();
+    /**
+     Moves the expressions pushed since first into the arena
+     */
+    Span<Expression*> popExpressions(size_t first);
 
     // Will return Error token if the given token is not a prefix operator
     TokenType peekPrefixOp();
 
-    std::shared_ptr<Expression> getPostfixOps(std::shared_ptr<Expression> expIn);
-    std::shared_ptr<Expression> getPrefixOps(std::shared_ptr<Expression> expIn, TokenType prefixOp);
+    Expression* getPostfixOps(Expression* expIn);
+    Expression* getPrefixOps(Expression* expIn, TokenType prefixOp);
 
     // Will return the error token if the next token is not an operator
     TokenType peekOperator();
@@ -49,6 +86,6 @@ private:
     // asserts the next token is of a given type
     void eat(TokenType token);
 
-    std::shared_ptr<Expression> getExpression(int prevPrec = 1);
-    std::shared_ptr<FunctionDecl> getFunctionDecl();
+    Expression* getExpression(int prevPrec = 1);
+    FunctionDecl* getFunctionDecl();
 };
@@ -0,0 +1,59 @@
+//  SourceFile.cpp
+
+#include "SourceFile.hpp"
+
+#include <fstream>
+#include <iterator>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+std::shared_ptr<SourceFile> SourceFile::open(const std::string &path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return nullptr;
+    }
+
+    std::shared_ptr<SourceFile> file(new SourceFile());
+
+    struct stat info;
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        void *address = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (address != MAP_FAILED) {
+            // the lexer reads it front to back once
+            madvise(address, info.st_size, MADV_SEQUENTIAL);
+            file->mAddress = address;
+            file->mSize = info.st_size;
+        }
+    }
+    close(fd);
+
+    if (file->mAddress == nullptr) {
+        std::ifstream stream(path.c_str(), std::ifstream::in | std::ifstream::binary);
+        if (stream.is_open() == false) {
+            return nullptr;
+        }
+        file->mContents.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+    }
+    return file;
+}
+
+SourceFile::~SourceFile()
+{
+    if (mAddress != nullptr) {
+        munmap(mAddress, mSize);
+    }
+}
+
+const char* SourceFile::data() const
+{
+    return mAddress != nullptr ? static_cast<const char*>(mAddress) : mContents.data();
+}
+
+size_t SourceFile::size() const
+{
+    return mAddress != nullptr ? mSize : mContents.size();
+}
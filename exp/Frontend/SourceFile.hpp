@@ -0,0 +1,34 @@
+//  SourceFile.hpp
+
+#pragma once
+
+#include <memory>
+#include <string>
+
+/**
+ Read only contents of a source file. Regular files are mapped, so lexing a large
+ script does not copy it into the heap first.
+ */
+class SourceFile {
+public:
+    /**
+     Returns nullptr if the file cannot be opened
+     */
+    static std::shared_ptr<SourceFile> open(const std::string &path);
+
+    ~SourceFile();
+
+    const char* data() const;
+    size_t size() const;
+
+private:
+    SourceFile() = default;
+    SourceFile(const SourceFile&) = delete;
+    SourceFile& operator=(const SourceFile&) = delete;
+
+    void *mAddress=nullptr;
+    size_t mSize=0;
+
+    // contents of files that cannot be mapped, e.g. pipes and empty files
+    std::string mContents;
+};
@@ -10,10 +10,6 @@ IntExpression::IntExpression(int value)
 {
 }
 
-IntExpression::~IntExpression()
-{
-}
-
 int IntExpression::getValue() const
 {
     return value;
@@ -26,16 +22,11 @@ void IntExpression::accept(Visitor* v)
 
 // MARK: - StringExpression
 
-StringExpression::StringExpression(const jcStringPtr& value) : mValue(value)
-{
-}
-
-StringExpression::~StringExpression()
+StringExpression::StringExpression(std::string_view value) : mValue(value)
 {
-
 }
 
-jcStringPtr StringExpression::getValue() const
+std::string_view StringExpression::getValue() const
 {
     return mValue;
 }
@@ -47,28 +38,24 @@ void StringExpression::accept(Visitor* v)
 
 // MARK: - BinaryExpression
 
-BinaryExpression::BinaryExpression(std::shared_ptr<Expression> left, TokenType op, std::shared_ptr<Expression> right)
+BinaryExpression::BinaryExpression(Expression* left, TokenType op, Expression* right)
 {
     this->left = left;
     this->op = op;
     this->right = right;
 }
 
-BinaryExpression::~BinaryExpression()
-{
-}
-
 void BinaryExpression::accept(Visitor* v)
 {
     v->visit(this);
 }
 
-std::shared_ptr<Expression> BinaryExpression::getLeft()
+Expression* BinaryExpression::getLeft() const
 {
     return left;
 }
 
-std::shared_ptr<Expression> BinaryExpression::getRight()
+Expression* BinaryExpression::getRight() const
 {
     return right;
 }
@@ -80,9 +67,9 @@ TokenType BinaryExpression::getOperator() const
 
 // MARK: - FunctionBody
 
-FunctionBody::FunctionBody(std::shared_ptr<Expression> exp,
-                           std::vector<std::string> params,
-                           const std::vector<std::shared_ptr<Guard>>& guards)
+FunctionBody::FunctionBody(Expression* exp,
+                           Span<std::string_view> params,
+                           Span<Guard*> guards)
 : mExpression(exp), mParams(params), mGuards(guards)
 {
 
@@ -93,17 +80,17 @@ void FunctionBody::accept(Visitor* v)
     v->visit(this);
 }
 
-std::shared_ptr<Expression> FunctionBody::getDefaultExpression() const
+Expression* FunctionBody::getDefaultExpression() const
 {
     return mExpression;
 }
 
-std::vector<std::string> FunctionBody::getParameters() const
+Span<std::string_view> FunctionBody::getParameters() const
 {
     return mParams;
 }
 
-Closure::Closure(std::shared_ptr<FunctionBody> body)
+Closure::Closure(FunctionBody* body)
 : mFunctionBody(body)
 {
 }
@@ -113,19 +100,19 @@ void Closure::accept(Visitor* v)
     v->visit(this);
 }
 
-std::shared_ptr<FunctionBody> Closure::getBody() const
+FunctionBody* Closure::getBody() const
 {
     return mFunctionBody;
 }
 
-std::vector<std::shared_ptr<Guard>> FunctionBody::getGuards() const
+Span<Guard*> FunctionBody::getGuards() const
 {
     return mGuards;
 }
 
 // MARK: - FunctionDecl
 
-FunctionDecl::FunctionDecl(const std::string& id, std::shared_ptr<FunctionBody> body)
+FunctionDecl::FunctionDecl(std::string_view id, FunctionBody* body)
     : mId(id)
     , mBody(body)
 {
@@ -136,24 +123,24 @@ void FunctionDecl::accept(Visitor* v)
     v->visit(this);
 }
 
-std::string FunctionDecl::getId() const
+std::string_view FunctionDecl::getId() const
 {
     return mId;
 }
 
-std::shared_ptr<FunctionBody> FunctionDecl::getFunctionBody() const
+FunctionBody* FunctionDecl::getFunctionBody() const
 {
     return mBody;
 }
 
 // MARK: - VariableExpression
 
-VariableExpression::VariableExpression(std::string variableName)
+VariableExpression::VariableExpression(std::string_view variableName)
     : mVariableName(variableName)
 {
 }
 
-std::string VariableExpression::getVariableName() const
+std::string_view VariableExpression::getVariableName() const
 {
     return mVariableName;
 }
@@ -165,11 +152,11 @@ void VariableExpression::accept(Visitor* v)
 
 // MARK: - NegateExpression
 
-NegateExpression::NegateExpression(std::shared_ptr<Expression> exp) : mExpression(exp)
+NegateExpression::NegateExpression(Expression* exp) : mExpression(exp)
 {
 }
 
-std::shared_ptr<Expression> NegateExpression::getExpression() const
+Expression* NegateExpression::getExpression() const
 {
     return mExpression;
 }
@@ -179,11 +166,11 @@ void NegateExpression::accept(Visitor* v)
     v->visit(this);
 }
 
-NotExpression::NotExpression(std::shared_ptr<Expression> exp) : mExpression(exp)
+NotExpression::NotExpression(Expression* exp) : mExpression(exp)
 {
 }
 
-std::shared_ptr<Expression> NotExpression::getExpression() const
+Expression* NotExpression::getExpression() const
 {
     return mExpression;
 }
@@ -195,18 +182,18 @@ void NotExpression::accept(Visitor* v)
 
 // MARK: - FunctionCallExpression
 
-FunctionCallExpression::FunctionCallExpression(std::shared_ptr<Expression> callee, const std::vector<std::shared_ptr<Expression>> arguments)
+FunctionCallExpression::FunctionCallExpression(Expression* callee, Span<Expression*> arguments)
     : mCallee(callee)
     , mArguments(arguments)
 {
 }
 
-std::shared_ptr<Expression> FunctionCallExpression::getCallee() const
+Expression* FunctionCallExpression::getCallee() const
 {
     return mCallee;
 }
 
-std::vector<std::shared_ptr<Expression>> FunctionCallExpression::getArguments() const
+Span<Expression*> FunctionCallExpression::getArguments() const
 {
     return mArguments;
 }
@@ -218,17 +205,17 @@ void FunctionCallExpression::accept(Visitor* v)
 
 // MARK: - IndexExpression
 
-IndexExpression::IndexExpression(std::shared_ptr<Expression> callee, std::shared_ptr<Expression> index)
+IndexExpression::IndexExpression(Expression* callee, Expression* index)
 : mCallee(callee), mIndex(index)
 {
 }
 
-std::shared_ptr<Expression> IndexExpression::getCallee() const
+Expression* IndexExpression::getCallee() const
 {
     return mCallee;
 }
 
-std::shared_ptr<Expression> IndexExpression::getIndex() const
+Expression* IndexExpression::getIndex() const
 {
     return mIndex;
 }
@@ -240,22 +227,22 @@ void IndexExpression::accept(Visitor* v)
 
 // MARK: - SliceExpression
 
-SliceExpression::SliceExpression(std::shared_ptr<Expression> callee, std::shared_ptr<Expression> index1, std::shared_ptr<Expression> index2)
+SliceExpression::SliceExpression(Expression* callee, Expression* index1, Expression* index2)
 : mCallee(callee), mIndex1(index1), mIndex2(index2)
 {
 }
 
-std::shared_ptr<Expression> SliceExpression::getCallee() const
+Expression* SliceExpression::getCallee() const
 {
     return mCallee;
 }
 
-std::shared_ptr<Expression> SliceExpression::getIndex1() const
+Expression* SliceExpression::getIndex1() const
 {
     return mIndex1;
 }
 
-std::shared_ptr<Expression> SliceExpression::getIndex2() const
+Expression* SliceExpression::getIndex2() const
 {
     return mIndex2;
 }
@@ -267,7 +254,7 @@ void SliceExpression::accept(Visitor* v)
 
 // MARK: - Guard
 
-Guard::Guard(const std::shared_ptr<Expression> guardExpression, const std::shared_ptr<Expression> body)
+Guard::Guard(Expression* guardExpression, Expression* body)
     : mGuardExpression(guardExpression)
     , mBodyExpression(body)
 {
@@ -277,19 +264,19 @@ void Guard::accept(Visitor* v)
 {
 }
 
-std::shared_ptr<Expression> Guard::getGuardExpression() const
+Expression* Guard::getGuardExpression() const
 {
     return mGuardExpression;
 }
 
-std::shared_ptr<Expression> Guard::getBodyExpression() const
+Expression* Guard::getBodyExpression() const
 {
     return mBodyExpression;
 }
 
 // MARK: - ListExpression
 
-ListExpression::ListExpression(const std::vector<std::shared_ptr<Expression>> &elements) : mElements(elements)
+ListExpression::ListExpression(Span<Expression*> elements) : mElements(elements)
 {
 }
 
@@ -298,31 +285,31 @@ void ListExpression::accept(Visitor *v)
     v->visit(this);
 }
 
-std::vector<std::shared_ptr<Expression>> ListExpression::getElements() const
+Span<Expression*> ListExpression::getElements() const
 {
     return mElements;
 }
 
 // MARK: - TernaryExpression
 
-TernaryExpresssion::TernaryExpresssion(const std::shared_ptr<Expression> conditionalExpression,
-                   const std::shared_ptr<Expression> trueExpression,
-                   const std::shared_ptr<Expression> falseExpression)
+TernaryExpresssion::TernaryExpresssion(Expression* conditionalExpression,
+                   Expression* trueExpression,
+                   Expression* falseExpression)
 : mConditionalExpression(conditionalExpression), mTrueExpression(trueExpression), mFalseExpression(falseExpression)
 {
 }
 
-std::shared_ptr<Expression> TernaryExpresssion::getConditionalExpression() const
+Expression* TernaryExpresssion::getConditionalExpression() const
 {
     return mConditionalExpression;
 }
 
-std::shared_ptr<Expression> TernaryExpresssion::getTrueExpression() const
+Expression* TernaryExpresssion::getTrueExpression() const
 {
     return mTrueExpression;
 }
 
-std::shared_ptr<Expression> TernaryExpresssion::getFalseExpression() const
+Expression* TernaryExpresssion::getFalseExpression() const
 {
     return mFalseExpression;
 }
@@ -2,35 +2,30 @@
 
 #pragma once
 
+#include "Arena.hpp"
 #include "Token.hpp"
 #include "Visitor.h"
 #include "jc.h"
 
-#include <memory>
-#include <string>
-#include <vector>
+#include <string_view>
 
 static fourcc kExpressionType = 'expr';
 static fourcc kFunctionDeclType = 'decl';
 static fourcc kFunctionGuardType = 'grd_';
 static fourcc kFunctionBody = 'fbdy';
 
+/**
+ Nodes are made in the parser's Arena and freed with it, they must stay trivially destructible:
+ children are arena pointers, lists are spans and names views of arena copies.
+ */
 class Node {
 public:
-    virtual ~Node()
-    {
-    }
-
     virtual void accept(Visitor* v) = 0;
     virtual fourcc type() const = 0;
 };
 
 class Expression : public Node {
 public:
-    virtual ~Expression()
-    {
-    }
-
     fourcc type() const override
     {
         return kExpressionType;
@@ -41,8 +36,6 @@ class IntExpression : public Expression {
 public:
     IntExpression(int value);
 
-    ~IntExpression();
-
     int getValue() const;
 
     void accept(Visitor* v) override;
@@ -53,164 +46,160 @@ private:
 
 class StringExpression : public Expression {
 public:
-    StringExpression(const jcStringPtr& value);
+    StringExpression(std::string_view value);
 
-    ~StringExpression();
-
-    jcStringPtr getValue() const;
+    std::string_view getValue() const;
 
     void accept(Visitor* v) override;
 
 private:
-    jcStringPtr mValue;
+    std::string_view mValue;
 };
 
 class VariableExpression : public Expression {
 public:
-    VariableExpression(std::string variableName);
+    VariableExpression(std::string_view variableName);
 
-    std::string getVariableName() const;
+    std::string_view getVariableName() const;
 
     void accept(Visitor* v) override;
 
 private:
-    std::string mVariableName;
+    std::string_view mVariableName;
 };
 
 class NegateExpression : public Expression {
 public:
-    NegateExpression(std::shared_ptr<Expression> exp);
+    NegateExpression(Expression* exp);
 
-    std::shared_ptr<Expression> getExpression() const;
+    Expression* getExpression() const;
 
     void accept(Visitor* v) override;
 
 private:
-    std::shared_ptr<Expression> mExpression;
+    Expression* mExpression;
 };
 
 class NotExpression : public Expression {
 public:
-    NotExpression(std::shared_ptr<Expression> exp);
+    NotExpression(Expression* exp);
 
-    std::shared_ptr<Expression> getExpression() const;
+    Expression* getExpression() const;
 
     void accept(Visitor* v) override;
 
 private:
-    std::shared_ptr<Expression> mExpression;
+    Expression* mExpression;
 };
 
 class FunctionCallExpression : public Expression {
 public:
-    FunctionCallExpression(std::shared_ptr<Expression> callee, const std::vector<std::shared_ptr<Expression>> arguments);
+    FunctionCallExpression(Expression* callee, Span<Expression*> arguments);
 
-    std::shared_ptr<Expression> getCallee() const;
-    std::vector<std::shared_ptr<Expression>> getArguments() const;
+    Expression* getCallee() const;
+    Span<Expression*> getArguments() const;
 
     void accept(Visitor* v) override;
 
 private:
-    std::shared_ptr<Expression> mCallee;
-    std::vector<std::shared_ptr<Expression>> mArguments;
+    Expression* mCallee;
+    Span<Expression*> mArguments;
 };
 
 class IndexExpression : public Expression
 {
 public:
-    IndexExpression(std::shared_ptr<Expression> callee, std::shared_ptr<Expression> index);
+    IndexExpression(Expression* callee, Expression* index);
 
-    std::shared_ptr<Expression> getCallee() const;
-    std::shared_ptr<Expression> getIndex() const;
+    Expression* getCallee() const;
+    Expression* getIndex() const;
 
     void accept(Visitor* v) override;
 
 private:
-    std::shared_ptr<Expression> mCallee;
-    std::shared_ptr<Expression> mIndex;
+    Expression* mCallee;
+    Expression* mIndex;
 };
 
 class SliceExpression : public Expression
 {
 public:
-    SliceExpression(std::shared_ptr<Expression> callee,
-                    std::shared_ptr<Expression> index1,
-                    std::shared_ptr<Expression> index2);
+    SliceExpression(Expression* callee,
+                    Expression* index1,
+                    Expression* index2);
 
-    std::shared_ptr<Expression> getCallee() const;
-    std::shared_ptr<Expression> getIndex1() const;
-    std::shared_ptr<Expression> getIndex2() const;
+    Expression* getCallee() const;
+    Expression* getIndex1() const;
+    Expression* getIndex2() const;
 
     void accept(Visitor* v) override;
 
 private:
-    std::shared_ptr<Expression> mCallee;
-    std::shared_ptr<Expression> mIndex1;
-    std::shared_ptr<Expression> mIndex2;
+    Expression* mCallee;
+    Expression* mIndex1;
+    Expression* mIndex2;
 };
 
 class BinaryExpression : public Expression {
 public:
-    BinaryExpression(std::shared_ptr<Expression> left, TokenType op, std::shared_ptr<Expression> right);
-
-    ~BinaryExpression();
+    BinaryExpression(Expression* left, TokenType op, Expression* right);
 
     void accept(Visitor* v) override;
 
-    std::shared_ptr<Expression> getLeft();
+    Expression* getLeft() const;
 
-    std::shared_ptr<Expression> getRight();
+    Expression* getRight() const;
 
     TokenType getOperator() const;
 
 private:
-    std::shared_ptr<Expression> left;
-    std::shared_ptr<Expression> right;
+    Expression* left;
+    Expression* right;
     TokenType op;
 };
 
 class ListExpression : public Expression {
 public:
-    ListExpression(const std::vector<std::shared_ptr<Expression>> &elements);
+    ListExpression(Span<Expression*> elements);
 
     void accept(Visitor *v) override;
 
-    std::vector<std::shared_ptr<Expression>> getElements() const;
+    Span<Expression*> getElements() const;
 
 private:
-    std::vector<std::shared_ptr<Expression>> mElements;
+    Span<Expression*> mElements;
 };
 
 class TernaryExpresssion : public Expression {
 public:
-    TernaryExpresssion(const std::shared_ptr<Expression> conditionalExpression,
-                       const std::shared_ptr<Expression> trueExpression,
-                       const std::shared_ptr<Expression> falseExpression);
+    TernaryExpresssion(Expression* conditionalExpression,
+                       Expression* trueExpression,
+                       Expression* falseExpression);
 
-    std::shared_ptr<Expression> getConditionalExpression() const;
-    std::shared_ptr<Expression> getTrueExpression() const;
-    std::shared_ptr<Expression> getFalseExpression() const;
+    Expression* getConditionalExpression() const;
+    Expression* getTrueExpression() const;
+    Expression* getFalseExpression() const;
 
     void accept(Visitor *v) override;
 
 private:
-    std::shared_ptr<Expression> mConditionalExpression;
-    std::shared_ptr<Expression> mTrueExpression;
-    std::shared_ptr<Expression> mFalseExpression;
+    Expression* mConditionalExpression;
+    Expression* mTrueExpression;
+    Expression* mFalseExpression;
 
 private:
 };
 
 class Guard : public Node {
 public:
-    Guard(const std::shared_ptr<Expression> guardExpression,
-        const std::shared_ptr<Expression> body);
+    Guard(Expression* guardExpression,
+        Expression* body);
 
     void accept(Visitor* v) override;
 
-    std::shared_ptr<Expression> getGuardExpression() const;
+    Expression* getGuardExpression() const;
 
-    std::shared_ptr<Expression> getBodyExpression() const;
+    Expression* getBodyExpression() const;
 
     fourcc type() const override
     {
@@ -218,21 +207,21 @@ public:
     }
 
 private:
-    std::shared_ptr<Expression> mGuardExpression;
-    std::shared_ptr<Expression> mBodyExpression;
+    Expression* mGuardExpression;
+    Expression* mBodyExpression;
 };
 
 class FunctionBody : public Node {
 public:
-    FunctionBody(std::shared_ptr<Expression> exp,
-                 std::vector<std::string> params,
-                 const std::vector<std::shared_ptr<Guard>>& guards);
+    FunctionBody(Expression* exp,
+                 Span<std::string_view> params,
+                 Span<Guard*> guards);
 
     void accept(Visitor* v) override;
 
-    std::shared_ptr<Expression> getDefaultExpression() const;
-    std::vector<std::string> getParameters() const;
-    std::vector<std::shared_ptr<Guard>> getGuards() const;
+    Expression* getDefaultExpression() const;
+    Span<std::string_view> getParameters() const;
+    Span<Guard*> getGuards() const;
 
     fourcc type() const override
     {
@@ -240,31 +229,31 @@ public:
     }
 
 private:
-    std::shared_ptr<Expression> mExpression;
-    std::vector<std::string> mParams;
-    std::vector<std::shared_ptr<Guard>> mGuards;
+    Expression* mExpression;
+    Span<std::string_view> mParams;
+    Span<Guard*> mGuards;
 };
 
 class Closure : public Expression {
 public:
-    Closure(std::shared_ptr<FunctionBody> body);
+    Closure(FunctionBody* body);
 
     void accept(Visitor* v) override;
-    std::shared_ptr<FunctionBody> getBody() const;
+    FunctionBody* getBody() const;
     
 private:
-    std::shared_ptr<FunctionBody> mFunctionBody;
+    FunctionBody* mFunctionBody;
 };
 
 class FunctionDecl : public Node {
 public:
-    FunctionDecl(const std::string& id,
-                 std::shared_ptr<FunctionBody> body);
+    FunctionDecl(std::string_view id,
+                 FunctionBody* body);
 
     void accept(Visitor* v) override;
 
-    std::string getId() const;
-    std::shared_ptr<FunctionBody> getFunctionBody() const;
+    std::string_view getId() const;
+    FunctionBody* getFunctionBody() const;
 
     fourcc type() const override
     {
@@ -272,6 +261,6 @@ public:
     }
 
 private:
-    std::string mId;
-    std::shared_ptr<FunctionBody> mBody;
+    std::string_view mId;
+    FunctionBody* mBody;
 };
@@ -0,0 +1,124 @@
+//  FreeVariables.cpp
+
+#include "FreeVariables.hpp"
+
+namespace bc {
+
+std::vector<std::string> FreeVariableAnalyzer::freeVariables(Closure* closure)
+{
+    FreeVariableAnalyzer analyzer;
+    closure->accept(&analyzer);
+    return std::vector<std::string>(analyzer.mFree.begin(), analyzer.mFree.end());
+}
+
+bool FreeVariableAnalyzer::isBound(const std::string &name) const
+{
+    for (auto &scope : mBound) {
+        if (scope.count(name) > 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void FreeVariableAnalyzer::visit(IntExpression* expression)
+{
+}
+
+void FreeVariableAnalyzer::visit(StringExpression* expression)
+{
+}
+
+void FreeVariableAnalyzer::visit(VariableExpression* expression)
+{
+    std::string name(expression->getVariableName());
+    if (isBound(name) == false) {
+        mFree.insert(name);
+    }
+}
+
+void FreeVariableAnalyzer::visit(FunctionCallExpression* expression)
+{
+    expression->getCallee()->accept(this);
+    for (auto argument : expression->getArguments()) {
+        argument->accept(this);
+    }
+}
+
+void FreeVariableAnalyzer::visit(BinaryExpression* expression)
+{
+    expression->getLeft()->accept(this);
+    expression->getRight()->accept(this);
+}
+
+void FreeVariableAnalyzer::visit(ListExpression* expression)
+{
+    for (auto element : expression->getElements()) {
+        element->accept(this);
+    }
+}
+
+void FreeVariableAnalyzer::visit(NegateExpression* expression)
+{
+    expression->getExpression()->accept(this);
+}
+
+void FreeVariableAnalyzer::visit(NotExpression* expression)
+{
+    expression->getExpression()->accept(this);
+}
+
+void FreeVariableAnalyzer::visit(TernaryExpresssion* expression)
+{
+    expression->getConditionalExpression()->accept(this);
+    expression->getTrueExpression()->accept(this);
+    expression->getFalseExpression()->accept(this);
+}
+
+void FreeVariableAnalyzer::visit(FunctionDecl* function)
+{
+    function->getFunctionBody()->accept(this);
+}
+
+void FreeVariableAnalyzer::visit(FunctionBody* functionBody)
+{
+    auto parameters = functionBody->getParameters();
+    mBound.push_back(std::set<std::string>(parameters.begin(), parameters.end()));
+
+    for (auto guard : functionBody->getGuards()) {
+        visit(guard);
+    }
+    functionBody->getDefaultExpression()->accept(this);
+
+    mBound.pop_back();
+}
+
+void FreeVariableAnalyzer::visit(Closure* closure)
+{
+    closure->getBody()->accept(this);
+}
+
+void FreeVariableAnalyzer::visit(Guard* guard)
+{
+    guard->getGuardExpression()->accept(this);
+    guard->getBodyExpression()->accept(this);
+}
+
+void FreeVariableAnalyzer::visit(IndexExpression* expression)
+{
+    expression->getCallee()->accept(this);
+    expression->getIndex()->accept(this);
+}
+
+void FreeVariableAnalyzer::visit(SliceExpression* expression)
+{
+    expression->getCallee()->accept(this);
+    if (expression->getIndex1()) {
+        expression->getIndex1()->accept(this);
+    }
+    if (expression->getIndex2()) {
+        expression->getIndex2()->accept(this);
+    }
+}
+
+}
@@ -0,0 +1,49 @@
+//  FreeVariables.hpp
+
+#pragma once
+
+#include "Visitor.h"
+#include "ast.hpp"
+
+#include <set>
+#include <string>
+#include <vector>
+
+namespace bc {
+
+/**
+ Walks a closure body and collects the variables it references that are
+ not bound by its own parameters (or the parameters of closures nested inside it).
+ */
+class FreeVariableAnalyzer : public Visitor {
+public:
+    /**
+     Returns the free variables of the closure, sorted by name so that
+     capture slots are assigned deterministically.
+     */
+    static std::vector<std::string> freeVariables(Closure* closure);
+
+    void visit(IntExpression* expression) override;
+    void visit(StringExpression* expression) override;
+    void visit(VariableExpression* expression) override;
+    void visit(FunctionCallExpression* expression) override;
+    void visit(BinaryExpression* expression) override;
+    void visit(ListExpression* expression) override;
+    void visit(NegateExpression* expression) override;
+    void visit(NotExpression* expression) override;
+    void visit(TernaryExpresssion* expression) override;
+    void visit(FunctionDecl* expression) override;
+    void visit(FunctionBody* expression) override;
+    void visit(Closure* expression) override;
+    void visit(Guard* expression) override;
+    void visit(IndexExpression* expression) override;
+    void visit(SliceExpression* expression) override;
+
+private:
+    bool isBound(const std::string &name) const;
+
+    std::vector<std::set<std::string>> mBound;
+    std::set<std::string> mFree;
+};
+
+}
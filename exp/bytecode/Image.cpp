@@ -0,0 +1,282 @@
+//  Image.cpp
+
+#include "Image.hpp"
+#include "jc.h"
+#include "jcString.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace bc {
+
+Word* Image::words()
+{
+    return mStorage ? mExternalWords : mWords.data();
+}
+
+const Word* Image::words() const
+{
+    return mStorage ? mExternalWords : mWords.data();
+}
+
+size_t Image::size() const
+{
+    return mStorage ? mNumExternalWords : mWords.size();
+}
+
+const std::vector<jcVariablePtr>& Image::constants() const
+{
+    return mConstants;
+}
+
+const std::map<std::string, int>& Image::labels() const
+{
+    return mLabels;
+}
+
+const std::vector<Image::Line>& Image::lines() const
+{
+    return mLines;
+}
+
+void Image::setLines(std::vector<Line> &&lines)
+{
+    mLines = std::move(lines);
+}
+
+int Image::lineOf(int ip) const
+{
+    auto line = std::upper_bound(mLines.begin(), mLines.end(), (uint32_t)ip, [](uint32_t ip, const Line &line) {
+        return ip < line.firstWord;
+    });
+    if (line == mLines.begin()) {
+        return -1;
+    }
+    return (line - 1)->line;
+}
+
+uint32_t Image::addConstant(const jcVariablePtr &constant)
+{
+    std::string key;
+    switch (constant->getType()) {
+    case jcVariable::TypeInt:
+        key = "i" + std::to_string(constant->asInt());
+        break;
+    case jcVariable::TypeChar:
+        key = "c" + std::string(1, constant->asChar());
+        break;
+    case jcVariable::TypeString:
+        key = (constant->asJcStringRaw()->getContext() == jcString::StringContextId ? "s" : "v") + constant->asString();
+        break;
+    default:
+        // lists and closures are not shared
+        break;
+    }
+
+    if (key.size()) {
+        auto it = mConstantIndex.find(key);
+        if (it != mConstantIndex.end()) {
+            return it->second;
+        }
+    }
+
+    uint32_t index = (uint32_t)mConstants.size();
+    mConstants.push_back(constant);
+    if (key.size()) {
+        mConstantIndex[key] = index;
+        if (mRecording) {
+            mAddedConstantKeys.push_back(key);
+        }
+    }
+    return index;
+}
+
+Image Image::assemble(const std::vector<Instruction> &instructions)
+{
+    Image image;
+    image.append(instructions);
+    return image;
+}
+
+int Image::append(const std::vector<Instruction> &instructions)
+{
+    if (mStorage) {
+        // the storage is shared with other copies, so the image takes its own copy before growing
+        mWords.assign(mExternalWords, mExternalWords + mNumExternalWords);
+        mExternalWords = nullptr;
+        mNumExternalWords = 0;
+        mStorage = nullptr;
+    }
+
+    int base = (int)mWords.size();
+    mWords.resize(base + instructions.size());
+
+    for (int i = 0; i < instructions.size(); i++) {
+        if (instructions[i].getOp() == bc::Label) {
+            std::string name = instructions[i].getOperand()->asString();
+            if (mRecording) {
+                auto previous = mLabels.find(name);
+                mReplacedLabels.push_back({ name, previous != mLabels.end() ? previous->second : -1 });
+            }
+            mLabels[name] = base + i;
+        }
+    }
+
+    for (int i = 0; i < instructions.size(); i++) {
+        const Instruction &instruction = instructions[i];
+        Word &word = mWords[base + i];
+
+        JC_ASSERT_OR_THROW_VM(instruction.getArgument() >= 0 && instruction.getArgument() <= std::numeric_limits<uint16_t>::max(),
+                              "Instruction argument out of range: " + instruction.toString());
+
+        word.op = instruction.getOp();
+        word.flags = 0;
+        word.argument = (uint16_t)instruction.getArgument();
+        word.operand = 0;
+
+        jcVariablePtr operand = instruction.getOperand();
+        if (operand == nullptr) {
+            continue;
+        }
+        word.flags |= Word::HasOperand;
+
+        bc::Op op = instruction.getOp();
+        if (op == bc::Jmp || op == bc::JmpTrue) {
+            auto label = operand->getType() == jcVariable::TypeString ? mLabels.find(operand->asString()) : mLabels.end();
+            if (label != mLabels.end()) {
+                word.operand = label->second + 1;
+                continue;
+            }
+            word.flags |= Word::Unresolved;
+        } else if (op == bc::PushFree && operand->getType() == jcVariable::TypeInt) {
+            word.operand = operand->asInt();
+            continue;
+        }
+
+        word.operand = addConstant(operand);
+    }
+
+    return base;
+}
+
+Image::Checkpoint Image::checkpoint()
+{
+    JC_ASSERT(mRecording == false);
+    mRecording = true;
+    return { size(), mConstants.size() };
+}
+
+void Image::rollback(const Checkpoint &checkpoint)
+{
+    JC_ASSERT(mRecording);
+    JC_ASSERT(mStorage == nullptr || checkpoint.numWords == size());
+
+    // undo in reverse, a label may have been replaced more than once
+    for (auto replaced = mReplacedLabels.rbegin(); replaced != mReplacedLabels.rend(); replaced++) {
+        if (replaced->second < 0) {
+            mLabels.erase(replaced->first);
+        } else {
+            mLabels[replaced->first] = replaced->second;
+        }
+    }
+    for (auto key : mAddedConstantKeys) {
+        mConstantIndex.erase(key);
+    }
+
+    if (mStorage == nullptr) {
+        mWords.resize(checkpoint.numWords);
+    }
+    mConstants.resize(checkpoint.numConstants);
+
+    mReplacedLabels.clear();
+    mAddedConstantKeys.clear();
+    mRecording = false;
+}
+
+Image Image::fromWords(std::vector<Word> &&words,
+                       std::vector<jcVariablePtr> &&constants,
+                       std::map<std::string, int> &&labels)
+{
+    Image image;
+    image.mWords = std::move(words);
+    image.mConstants = std::move(constants);
+    image.mLabels = std::move(labels);
+    return image;
+}
+
+Image Image::fromStorage(Word *words, size_t numWords,
+                         std::vector<jcVariablePtr> &&constants,
+                         std::map<std::string, int> &&labels,
+                         const std::shared_ptr<void> &storage)
+{
+    JC_ASSERT(storage);
+
+    Image image;
+    image.mExternalWords = words;
+    image.mNumExternalWords = numWords;
+    image.mStorage = storage;
+    image.mConstants = std::move(constants);
+    image.mLabels = std::move(labels);
+    return image;
+}
+
+/**
+ Operand of the word as the Instruction it was assembled from
+ */
+static jcVariablePtr unpackOperand(const Word &word, const std::vector<jcVariablePtr> &constants, const std::map<int, std::string> &labelAt)
+{
+    if (word.hasOperand() == false) {
+        return nullptr;
+    }
+
+    bc::Op op = word.getOp();
+    if ((op == bc::Jmp || op == bc::JmpTrue) && (word.flags & Word::Unresolved) == 0) {
+        auto label = labelAt.find((int)word.operand - 1);
+        JC_ASSERT_OR_THROW_VM(label != labelAt.end(), "Jump to a word that is not a label");
+        return jcVariable::Create(label->second);
+    }
+    if (op == bc::PushFree) {
+        return jcVariable::Create((int)word.operand);
+    }
+
+    JC_ASSERT_OR_THROW_VM(word.operand < constants.size(), "Constant index out of range");
+    return constants[word.operand];
+}
+
+std::vector<Instruction> Image::disassemble() const
+{
+    std::map<int, std::string> labelAt;
+    for (auto label : mLabels) {
+        labelAt[label.second] = label.first;
+    }
+
+    const Word *packed = words();
+    std::vector<Instruction> instructions;
+    instructions.reserve(size());
+    for (size_t i = 0; i < size(); i++) {
+        // quickened words are verified as their generic op
+        bc::Op op = genericOp(packed[i].getOp());
+        instructions.push_back(Instruction(op, unpackOperand(packed[i], mConstants, labelAt), packed[i].argument));
+    }
+    return instructions;
+}
+
+std::string Image::toString(int ip) const
+{
+    const Word &word = words()[ip];
+    bc::Op op = word.getOp();
+    if (word.hasOperand() == false) {
+        return Instruction(op, nullptr, word.argument).toString();
+    }
+
+    bool immediate = ((op == bc::Jmp || op == bc::JmpTrue) && (word.flags & Word::Unresolved) == 0) || op == bc::PushFree;
+    jcVariablePtr operand = immediate ? jcVariable::Create((int)word.operand) : mConstants[word.operand];
+
+    std::string output = Instruction(op, operand, word.argument).toString();
+    if (lineOf(ip) >= 0) {
+        output += " ; line " + std::to_string(lineOf(ip));
+    }
+    return output;
+}
+
+}
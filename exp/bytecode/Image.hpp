@@ -0,0 +1,183 @@
+//  Image.hpp
+
+#pragma once
+
+#include "bc.hpp"
+#include "jc.h"
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace bc {
+
+/**
+ Packed form of an Instruction, the interpreter runs these.
+    - op - the bc::Op, rewritten in place when the interpreter quickens the word
+    - argument - Call and PushC argument counts, kKeepThunk on Push and PushFree
+    - operand - an index into the image's constant pool, or an immediate:
+        the target of Jmp/JmpTrue, the capture slot of PushFree
+ */
+struct Word {
+    enum Flags : uint8_t {
+        HasOperand = 1 << 0,
+
+        // the quickened op's guard failed, the word stays generic
+        Deoptimized = 1 << 1,
+
+        // the jump's label does not exist, operand is the constant index of its name
+        Unresolved = 1 << 2,
+    };
+
+    uint8_t op;
+    uint8_t flags;
+    uint16_t argument;
+    uint32_t operand;
+
+    inline bc::Op getOp() const
+    {
+        return (bc::Op)op;
+    }
+
+    inline bool hasOperand() const
+    {
+        return flags & HasOperand;
+    }
+
+    /**
+     Rewrites the word into a specialized form of its op.
+     Has no effect once the word has been deoptimized.
+     */
+    inline void quicken(bc::Op quickened)
+    {
+        JC_ASSERT(genericOp(quickened) == genericOp((bc::Op)op));
+        if ((flags & Deoptimized) == 0) {
+            op = quickened;
+        }
+    }
+
+    /**
+     Reverts a quickened word to its generic op for good.
+     */
+    inline void deoptimize()
+    {
+        op = genericOp((bc::Op)op);
+        flags |= Deoptimized;
+    }
+};
+
+static_assert(sizeof(Word) == 8, "Word must stay packed");
+static_assert(std::is_trivially_copyable<Word>::value, "Word must be copyable with memcpy");
+
+/**
+ A linked instruction stream: packed words plus the constants they refer to.
+ Equal ints and identifiers share one pool entry.
+ The words are either owned by the image or live in storage shared by its copies, e.g. a mapped file.
+ */
+class Image {
+public:
+    /**
+     Source line of the words starting at firstWord, up to the next entry
+     */
+    struct Line {
+        uint32_t firstWord;
+        int32_t line;
+    };
+
+    /**
+     Words, constants and labels of an image at some point, see rollback
+     */
+    struct Checkpoint {
+        size_t numWords;
+        size_t numConstants;
+    };
+
+    /**
+     Packs the instructions, words keep the index of the instruction they were made from
+     */
+    static Image assemble(const std::vector<Instruction> &instructions);
+
+    /**
+     Packs the instructions after the existing words and returns the index of the first one.
+     Labels they define replace existing ones with the same name, so a redefined function is
+     patched in by its entry in the label table and existing words are never touched.
+     */
+    int append(const std::vector<Instruction> &instructions);
+
+    /**
+     Starts recording the changes append makes, one checkpoint can be open at a time
+     */
+    Checkpoint checkpoint();
+
+    /**
+     Drops everything appended since the checkpoint and closes it
+     */
+    void rollback(const Checkpoint &checkpoint);
+
+    /**
+     Image owning already packed words
+     */
+    static Image fromWords(std::vector<Word> &&words,
+                           std::vector<jcVariablePtr> &&constants,
+                           std::map<std::string, int> &&labels);
+
+    /**
+     Image running the words in place, storage keeps them alive
+     */
+    static Image fromStorage(Word *words, size_t numWords,
+                             std::vector<jcVariablePtr> &&constants,
+                             std::map<std::string, int> &&labels,
+                             const std::shared_ptr<void> &storage);
+
+    /**
+     Unpacks the words, used to verify images that were not assembled in this process
+     */
+    std::vector<Instruction> disassemble() const;
+
+    Word* words();
+    const Word* words() const;
+    size_t size() const;
+
+    const std::vector<jcVariablePtr>& constants() const;
+
+    /**
+     Label name to the index of its Label word
+     */
+    const std::map<std::string, int>& labels() const;
+
+    const std::vector<Line>& lines() const;
+    void setLines(std::vector<Line> &&lines);
+
+    /**
+     Returns the source line of the word, -1 if unknown
+     */
+    int lineOf(int ip) const;
+
+    std::string toString(int ip) const;
+
+private:
+    uint32_t addConstant(const jcVariablePtr &constant);
+
+    std::vector<Word> mWords;
+    std::vector<jcVariablePtr> mConstants;
+    std::map<std::string, int> mLabels;
+    std::vector<Line> mLines;
+
+    // words and their owner when they are not in mWords
+    Word *mExternalWords=nullptr;
+    size_t mNumExternalWords=0;
+    std::shared_ptr<void> mStorage;
+
+    // pool index of each int and string constant, keyed by type and value
+    std::map<std::string, uint32_t> mConstantIndex;
+
+    // changes since the open checkpoint: labels with their previous word (-1 if new), and new constant keys
+    bool mRecording=false;
+    std::vector<std::pair<std::string, int>> mReplacedLabels;
+    std::vector<std::string> mAddedConstantKeys;
+};
+
+}
@@ -0,0 +1,405 @@
+//  ImageFile.cpp
+
+#include "ImageFile.hpp"
+#include "jc.h"
+#include "jcList.hpp"
+#include "jcString.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace bc {
+
+static const char kMagic[4] = { 'J', 'C', 'B', '\0' };
+
+struct Header {
+    char magic[4];
+    uint32_t version;
+    uint64_t sourceHash;
+
+    uint64_t wordsOffset;
+    uint64_t numWords;
+
+    uint64_t constantsOffset;
+    uint64_t numConstants;
+
+    uint64_t functionsOffset;
+    uint64_t numFunctions;
+
+    uint64_t linesOffset;
+    uint64_t numLines;
+
+    uint64_t fileSize;
+};
+
+enum ConstantTag : uint8_t {
+    TagInt = 0,
+    TagChar = 1,
+    TagValueString = 2,
+    TagIdString = 3,
+    TagList = 4,
+};
+
+/**
+ Appends plain values to the file contents
+ */
+class Writer {
+public:
+    template<typename T>
+    void write(const T &value)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "only plain values can be written");
+        mData.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    void writeString(const std::string &value)
+    {
+        write<uint32_t>((uint32_t)value.size());
+        mData.append(value);
+    }
+
+    void writeConstant(const jcVariablePtr &constant)
+    {
+        switch (constant->getType()) {
+        case jcVariable::TypeInt:
+            write<uint8_t>(TagInt);
+            write<int32_t>(constant->asInt());
+            break;
+        case jcVariable::TypeChar:
+            write<uint8_t>(TagChar);
+            write<char>(constant->asChar());
+            break;
+        case jcVariable::TypeString: {
+            bool isId = constant->asJcStringRaw()->getContext() == jcString::StringContextId;
+            write<uint8_t>(isId ? TagIdString : TagValueString);
+            writeString(constant->asString());
+            break;
+        }
+        case jcVariable::TypeList: {
+            write<uint8_t>(TagList);
+            write<uint32_t>((uint32_t)constant->asListRaw()->size());
+            constant->asListRaw()->forEach([this](jcVariablePtr &element) {
+                writeConstant(element);
+            });
+            break;
+        }
+        default:
+            JC_THROW_VM_EXCEPTION("Cannot write constant " + constant->stringRepresentation());
+        }
+    }
+
+    /**
+     Pads to the next section boundary and returns its offset
+     */
+    uint64_t align()
+    {
+        while (mData.size() % 8) {
+            mData.push_back('\0');
+        }
+        return mData.size();
+    }
+
+    std::string& data()
+    {
+        return mData;
+    }
+
+private:
+    std::string mData;
+};
+
+/**
+ Reads plain values from the mapped file, every read is bounds checked
+ */
+class Reader {
+public:
+    Reader(const char *data, uint64_t size, uint64_t offset)
+    : mData(data), mSize(size), mOffset(offset)
+    {
+    }
+
+    template<typename T>
+    bool read(T &value)
+    {
+        if (mOffset + sizeof(T) > mSize) {
+            return false;
+        }
+        memcpy(&value, mData + mOffset, sizeof(T));
+        mOffset += sizeof(T);
+        return true;
+    }
+
+    bool readString(std::string &value)
+    {
+        uint32_t size = 0;
+        if (read(size) == false || mOffset + size > mSize) {
+            return false;
+        }
+        value.assign(mData + mOffset, size);
+        mOffset += size;
+        return true;
+    }
+
+    bool readConstant(jcVariablePtr &constant)
+    {
+        uint8_t tag = 0;
+        if (read(tag) == false) {
+            return false;
+        }
+
+        switch (tag) {
+        case TagInt: {
+            int32_t value = 0;
+            if (read(value) == false) {
+                return false;
+            }
+            constant = jcVariable::Create((int)value);
+            return true;
+        }
+        case TagChar: {
+            char value = 0;
+            if (read(value) == false) {
+                return false;
+            }
+            constant = jcVariable::Create(value);
+            return true;
+        }
+        case TagValueString:
+        case TagIdString: {
+            std::string value;
+            if (readString(value) == false) {
+                return false;
+            }
+            auto context = tag == TagIdString ? jcString::StringContextId : jcString::StringContextValue;
+            constant = jcVariable::Create(jcString::Create(value, context));
+            return true;
+        }
+        case TagList: {
+            uint32_t size = 0;
+            if (read(size) == false) {
+                return false;
+            }
+
+            std::vector<jcVariablePtr> elements(size);
+            for (uint32_t i = 0; i < size; i++) {
+                if (readConstant(elements[i]) == false) {
+                    return false;
+                }
+            }
+
+            jcListPtr list = std::make_shared<jcList>();
+            for (auto element = elements.rbegin(); element != elements.rend(); element++) {
+                list = std::shared_ptr<jcList>(list->cons(*element));
+            }
+            constant = jcVariable::Create(list);
+            return true;
+        }
+        default:
+            return false;
+        }
+    }
+
+private:
+    const char *mData;
+    uint64_t mSize;
+    uint64_t mOffset;
+};
+
+/**
+ Owns a private mapping of a file
+ */
+class Mapping {
+public:
+    Mapping(void *address, size_t size)
+    : mAddress(address), mSize(size)
+    {
+    }
+
+    ~Mapping()
+    {
+        munmap(mAddress, mSize);
+    }
+
+    char* data() const
+    {
+        return static_cast<char*>(mAddress);
+    }
+
+private:
+    void *mAddress;
+    size_t mSize;
+};
+
+std::string ImageFile::serialize(const Image &image, uint64_t sourceHash)
+{
+    Writer writer;
+
+    Header header = {};
+    memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.sourceHash = sourceHash;
+    writer.write(header);
+
+    header.wordsOffset = writer.align();
+    header.numWords = image.size();
+    writer.data().append(reinterpret_cast<const char*>(image.words()), image.size() * sizeof(Word));
+
+    header.constantsOffset = writer.align();
+    header.numConstants = image.constants().size();
+    for (auto constant : image.constants()) {
+        writer.writeConstant(constant);
+    }
+
+    header.functionsOffset = writer.align();
+    header.numFunctions = image.labels().size();
+    for (auto label : image.labels()) {
+        writer.write<uint32_t>(label.second);
+        writer.writeString(label.first);
+    }
+
+    header.linesOffset = writer.align();
+    header.numLines = image.lines().size();
+    for (auto line : image.lines()) {
+        writer.write(line);
+    }
+
+    header.fileSize = writer.align();
+    memcpy(&writer.data()[0], &header, sizeof(header));
+    return writer.data();
+}
+
+bool ImageFile::write(const Image &image, uint64_t sourceHash, const std::string &path)
+{
+    std::string data = serialize(image, sourceHash);
+
+    // another process may have the old file mapped, so it is replaced rather than rewritten in place
+    std::string temporary = path + ".tmp." + std::to_string(getpid());
+    std::ofstream output(temporary.c_str(), std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+    if (output.is_open() == false) {
+        return false;
+    }
+    output.write(data.data(), data.size());
+    output.close();
+
+    if (output.fail() || rename(temporary.c_str(), path.c_str()) != 0) {
+        unlink(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+/**
+ Parses the file contents. The image runs the words in place when storage owns data, otherwise they are copied.
+ */
+static bool parse(const char *data, uint64_t size, const std::shared_ptr<void> &storage, Image &image, uint64_t *sourceHash)
+{
+    if (size < sizeof(Header)) {
+        return false;
+    }
+
+    Header header;
+    memcpy(&header, data, sizeof(header));
+
+    bool valid = memcmp(header.magic, kMagic, sizeof(kMagic)) == 0 &&
+                 header.version == ImageFile::kVersion &&
+                 header.fileSize == size &&
+                 header.wordsOffset % alignof(Word) == 0 &&
+                 header.wordsOffset + header.numWords * sizeof(Word) <= size;
+    if (valid == false) {
+        return false;
+    }
+
+    std::vector<jcVariablePtr> constants(header.numConstants);
+    Reader constantReader(data, size, header.constantsOffset);
+    for (auto &constant : constants) {
+        if (constantReader.readConstant(constant) == false) {
+            return false;
+        }
+    }
+
+    std::map<std::string, int> labels;
+    Reader functionReader(data, size, header.functionsOffset);
+    for (uint64_t i = 0; i < header.numFunctions; i++) {
+        uint32_t index = 0;
+        std::string name;
+        if (functionReader.read(index) == false || functionReader.readString(name) == false || index >= header.numWords) {
+            return false;
+        }
+        labels[name] = index;
+    }
+
+    std::vector<Image::Line> lines(header.numLines);
+    Reader lineReader(data, size, header.linesOffset);
+    for (auto &line : lines) {
+        if (lineReader.read(line) == false) {
+            return false;
+        }
+    }
+
+    if (storage) {
+        Word *words = reinterpret_cast<Word*>(const_cast<char*>(data) + header.wordsOffset);
+        image = Image::fromStorage(words, header.numWords, std::move(constants), std::move(labels), storage);
+    } else {
+        std::vector<Word> words(header.numWords);
+        memcpy(words.data(), data + header.wordsOffset, header.numWords * sizeof(Word));
+        image = Image::fromWords(std::move(words), std::move(constants), std::move(labels));
+    }
+    image.setLines(std::move(lines));
+
+    if (sourceHash) {
+        *sourceHash = header.sourceHash;
+    }
+    return true;
+}
+
+bool ImageFile::read(const char *data, size_t size, Image &image, uint64_t *sourceHash)
+{
+    return parse(data, size, nullptr, image, sourceHash);
+}
+
+bool ImageFile::load(const std::string &path, Image &image, uint64_t *sourceHash)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < sizeof(Header)) {
+        close(fd);
+        return false;
+    }
+
+    // private and writable so quickening rewrites words copy-on-write
+    void *address = mmap(nullptr, info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (address == MAP_FAILED) {
+        return false;
+    }
+    auto mapping = std::make_shared<Mapping>(address, info.st_size);
+
+    return parse(mapping->data(), info.st_size, mapping, image, sourceHash);
+}
+
+uint64_t ImageFile::hash(const std::string &data, uint64_t seed)
+{
+    return hash(data.data(), data.size(), seed);
+}
+
+uint64_t ImageFile::hash(const char *data, size_t size, uint64_t seed)
+{
+    uint64_t hash = seed;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= (unsigned char)data[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+}
@@ -0,0 +1,57 @@
+//  ImageFile.hpp
+
+#pragma once
+
+#include "Image.hpp"
+
+#include <cstdint>
+#include <string>
+
+namespace bc {
+
+/**
+ Reads and writes images as .jcb files.
+
+ Layout, in host byte order, every section 8 byte aligned:
+    - header: magic, format version, source hash and the offset and count of each section
+    - words: the packed words, mapped and run in place
+    - constants: a type tag per constant followed by its value
+    - functions: word index and name of every label
+    - lines: Image::Line entries
+ */
+class ImageFile {
+public:
+    static const uint32_t kVersion = 2;
+
+    /**
+     Returns the file contents for the image
+     */
+    static std::string serialize(const Image &image, uint64_t sourceHash);
+
+    /**
+     Writes the image, returns false if the file could not be written.
+     The file is written next to path and renamed over it, so runs that mapped the old file keep it.
+     */
+    static bool write(const Image &image, uint64_t sourceHash, const std::string &path);
+
+    /**
+     Reads an image from file contents already in memory, the words are copied out.
+     Returns false if the data is malformed or from another format version.
+     */
+    static bool read(const char *data, size_t size, Image &image, uint64_t *sourceHash = nullptr);
+
+    /**
+     Maps the file privately and returns an image running its words in place, quickening only
+     touches the pages it rewrites. Returns false if the file is missing, malformed or from
+     another format version.
+     */
+    static bool load(const std::string &path, Image &image, uint64_t *sourceHash = nullptr);
+
+    /**
+     FNV-1a hash of the data, chain calls through seed to hash several inputs
+     */
+    static uint64_t hash(const std::string &data, uint64_t seed = 14695981039346656037ULL);
+    static uint64_t hash(const char *data, size_t size, uint64_t seed = 14695981039346656037ULL);
+};
+
+}
@@ -6,10 +6,12 @@
 #include "Interpreter.hpp"
 #include "jc.h"
 #include "builtin.hpp"
+#include "Verifier.hpp"
 #include "jcClosure.hpp"
 #include "jcArray.hpp"
 #include "jcList.hpp"
 #include "jcString.hpp"
+#include "jcThunk.hpp"
 
 static inline int performArtithmaticOp(bc::Op op, int right, int left)
 {
@@ -55,28 +57,95 @@ Interpreter::Interpreter()
 {
 }
 
-void Interpreter::mapLabels(std::vector<bc::Instruction> instructions)
+void Interpreter::mapArity(int firstWord)
 {
-    for (int i = 0; i < instructions.size(); i++) {
-        bc::Instruction instruction = instructions[i];
-        if (instruction.getOp() == bc::Label) {
-            mLabelLut[instruction.getOperand()->asString()] = i;
+    const bc::Word *words = mImage.words();
+    mArity.resize(mImage.size(), 0);
+    for (int ip = firstWord; ip < mImage.size(); ip++) {
+        if (words[ip].getOp() != bc::Label) {
+            continue;
+        }
+
+        mArity[ip] = 0;
+        for (int i = ip + 1; i < mImage.size() && words[i].getOp() == bc::Pop; i++) {
+            mArity[ip]++;
         }
     }
 }
 
 void Interpreter::setInstructions(const std::vector<bc::Instruction> &instructions)
 {
-    mInstructions = instructions;
-    mapLabels(mInstructions);
+    mVerified = bc::Verifier::verify(instructions);
+    mImage = bc::Image::assemble(instructions);
+    mArity.clear();
+    mapArity(0);
+}
+
+void Interpreter::setImage(const bc::Image &image)
+{
+    mVerified = bc::Verifier::verify(image.disassemble());
+    mImage = image;
+    mArity.clear();
+    mapArity(0);
+}
+
+int Interpreter::appendInstructions(const std::vector<bc::Instruction> &instructions)
+{
+    // chunks are self contained, so verifying each one verifies the image
+    mVerified = mVerified && bc::Verifier::verify(instructions);
+
+    int firstWord = mImage.append(instructions);
+    mapArity(firstWord);
+    return firstWord;
+}
+
+Interpreter::Checkpoint Interpreter::checkpoint()
+{
+    return { mImage.checkpoint(), mVerified };
+}
+
+void Interpreter::rollback(const Checkpoint &checkpoint)
+{
+    mImage.rollback(checkpoint.image);
+    mArity.resize(mImage.size());
+    mVerified = checkpoint.verified;
+}
+
+bool Interpreter::isVerified() const
+{
+    return mVerified;
+}
+
+uint64_t Interpreter::dispatchCount() const
+{
+    return mDispatchCount;
 }
 
 jcVariablePtr Interpreter::interpret()
 {
+    return interpretAt(0);
+}
+
+jcVariablePtr Interpreter::interpretAt(int ip)
+{
+    size_t depth = mState.size();
+    if (depth == 0) {
+        mUnbalanced = false;
+    }
     pushState();
-    auto value = eval();
-    popState();
-    return value;
+    state().mIp = ip;
+
+    try {
+        auto value = eval();
+        popState();
+        return value;
+    } catch (...) {
+        // leave the interpreter usable for the next run
+        while (mState.size() > depth) {
+            popState();
+        }
+        throw;
+    }
 }
 
 jcVariablePtr Interpreter::interpret(jcVariablePtr callableObject, std::vector<jcVariablePtr> args)
@@ -86,11 +155,12 @@ jcVariablePtr Interpreter::interpret(jcVariablePtr callableObject, std::vector<j
     state().mIp = -1;
     state().callCount = 1;
 
-    for (auto arg : args) {
-        state().mStack.push(arg);
+    // the first parameter is popped first
+    for (auto arg = args.rbegin(); arg != args.rend(); arg++) {
+        state().mStack.push(*arg);
     }
 
-    callFunction(callableObject);
+    callFunction(callableObject, (int)args.size());
     jcVariablePtr returnValue = nullptr;
     if (state().mIp != -1) {
         returnValue = eval();
@@ -101,11 +171,156 @@ jcVariablePtr Interpreter::interpret(jcVariablePtr callableObject, std::vector<j
     return returnValue;
 }
 
+jcVariablePtr Interpreter::apply(const jcVariablePtr &function, const jcVariablePtr *args, size_t numArgs)
+{
+    // the caller is suspended in a Call, its position is put back once the function returns
+    _state& curState = state();
+    int ip = curState.mIp;
+    int callCount = curState.callCount;
+    bool callSingleFunction = curState.callSingleFunction;
+
+    curState.mIp = -1;
+    curState.callCount = 1;
+    curState.callSingleFunction = true;
+
+    // the first parameter is popped first
+    for (size_t i = numArgs; i > 0; i--) {
+        curState.mStack.push(args[i - 1]);
+    }
+
+    callFunction(function, (int)numArgs);
+    jcVariablePtr returnValue = curState.mIp != -1 ? eval() : popStack();
+
+    curState.mIp = ip;
+    curState.callCount = callCount;
+    curState.callSingleFunction = callSingleFunction;
+    return returnValue;
+}
+
+bool Interpreter::matchIntComparison(const jcVariablePtr &callableObject, IntComparison &comparison)
+{
+    const jcClosure *closure = callableObject->asClosureRaw();
+    if (closure == nullptr && callableObject->getType() != jcVariable::TypeString) {
+        return false;
+    }
+
+    auto label = mImage.labels().find(closure ? closure->name() : callableObject->asString());
+    if (label == mImage.labels().end()) {
+        return false;
+    }
+
+    // Label, Pop x, the two operands, the comparison, Ret
+    const bc::Word *words = mImage.words();
+    const std::vector<jcVariablePtr> &constants = mImage.constants();
+    size_t end = mImage.size();
+    size_t ip = label->second + 1;
+    if (ip >= end || words[ip].getOp() != bc::Pop) {
+        return false;
+    }
+    std::string parameter = constants[words[ip++].operand]->asString();
+
+    // an operand is the parameter, or an int that cannot change while the function is alive
+    auto matchOperand = [&](bool &isParameter, int &value) -> bool {
+        if (ip >= end) {
+            return false;
+        }
+        const bc::Word &word = words[ip++];
+        bc::Op op = genericOp(word.getOp());
+        if (op == bc::Push) {
+            const jcVariablePtr &operand = constants[word.operand];
+            // a string literal spelled like the parameter is not the parameter
+            isParameter = operand->getType() == jcVariable::TypeString &&
+                          operand->asJcStringRaw()->getContext() == jcString::StringContextId &&
+                          operand->asString() == parameter;
+            value = operand->getType() == jcVariable::TypeInt ? operand->asInt() : 0;
+            return isParameter || operand->getType() == jcVariable::TypeInt;
+        } else if (op != bc::PushFree || closure == nullptr) {
+            return false;
+        }
+
+        isParameter = false;
+        const jcVariablePtr &capture = closure->capture(word.operand);
+        if (capture->getType() == jcVariable::TypeInt) {
+            value = capture->asInt();
+            return true;
+        }
+
+        // head(capture), unless head was redefined or the parameter shadows it
+        if (ip + 1 >= end || genericOp(words[ip].getOp()) != bc::Push || words[ip + 1].getOp() != bc::Call || words[ip + 1].argument != 1) {
+            return false;
+        }
+        const jcVariablePtr &callee = constants[words[ip].operand];
+        if (callee->getType() != jcVariable::TypeString || callee->asString() != lib::kLibHead ||
+            parameter == lib::kLibHead || mImage.labels().count(lib::kLibHead) > 0) {
+            return false;
+        }
+        ip += 2;
+
+        jcCollection *collection = capture->asCollection();
+        if (collection == nullptr || collection->isEmpty() || collection->head()->getType() != jcVariable::TypeInt) {
+            return false;
+        }
+        value = collection->head()->asInt();
+        return true;
+    };
+
+    bool leftIsParameter = false, rightIsParameter = false;
+    int leftValue = 0, rightValue = 0;
+    if (!matchOperand(leftIsParameter, leftValue) || !matchOperand(rightIsParameter, rightValue) ||
+        leftIsParameter == rightIsParameter || ip + 1 >= end || words[ip + 1].getOp() != bc::Ret) {
+        return false;
+    }
+
+    // value op x is matched as x op' value
+    switch (genericOp(words[ip].getOp())) {
+        case bc::Less_Than:
+            comparison.op = leftIsParameter ? IntComparison::LessThan : IntComparison::GreaterThan;
+            break;
+        case bc::Less_Than_Equal:
+            comparison.op = leftIsParameter ? IntComparison::LessThanEqual : IntComparison::GreaterThanEqual;
+            break;
+        case bc::Greater_Than:
+            comparison.op = leftIsParameter ? IntComparison::GreaterThan : IntComparison::LessThan;
+            break;
+        case bc::Greater_Than_Equal:
+            comparison.op = leftIsParameter ? IntComparison::GreaterThanEqual : IntComparison::LessThanEqual;
+            break;
+        case bc::Equals:
+            comparison.op = IntComparison::Equals;
+            break;
+        default:
+            return false;
+    }
+    comparison.value = leftIsParameter ? rightValue : leftValue;
+    return true;
+}
+
+jcVariablePtr Interpreter::eval()
+{
+    return mVerified && !mUnbalanced ? eval<true>() : eval<false>();
+}
+
+template<bool Verified>
+inline jcVariablePtr Interpreter::popOperand()
+{
+    if (Verified == false) {
+        return popStack();
+    }
+    _state& curState = state();
+    auto top = curState.mStack.top();
+    curState.mStack.pop();
+    return top;
+}
+
+template<bool Verified>
 jcVariablePtr Interpreter::eval()
 {
     _state& curState = state();
+    bc::Word *words = mImage.words();
+    const jcVariablePtr *constants = mImage.constants().data();
     while (1) {
-        bc::Instruction& instruction = mInstructions[curState.mIp++];
+        bc::Word& instruction = words[curState.mIp++];
+        mDispatchCount++;
 
         bc::Op op = instruction.getOp();
 
@@ -119,23 +334,37 @@ jcVariablePtr Interpreter::eval()
         case bc::Less_Than_Equal:
         case bc::Greater_Than_Equal:
         case bc::Equals: {
-            jcVariablePtr right = popStack();
-            jcVariablePtr left = popStack();
+            jcVariablePtr right = popOperand<Verified>();
+            jcVariablePtr left = popOperand<Verified>();
 
             jcVariablePtr result = jcVariable::Create(performArtithmaticOp(op, right->asInt(), left->asInt()));
             curState.mStack.push(result);
+
+            if (op == bc::Equals && left->getType() == jcVariable::TypeInt && right->getType() == jcVariable::TypeInt) {
+                instruction.quicken(bc::EqualsInt);
+            }
+            break;
+        }
+        case bc::EqualsInt: {
+            jcVariablePtr right = popOperand<Verified>();
+            jcVariablePtr left = popOperand<Verified>();
+
+            if (left->getType() != jcVariable::TypeInt || right->getType() != jcVariable::TypeInt) {
+                instruction.deoptimize();
+            }
+            curState.mStack.push(jcVariable::Create(left->asInt() == right->asInt()));
             break;
         }
         case bc::Neg:
         case bc::Not: {
-            jcVariablePtr top = popStack();
+            jcVariablePtr top = popOperand<Verified>();
             jcVariablePtr result = jcVariable::Create(performPrefixOp(op, top->asInt()));
             curState.mStack.push(result);
             break;
         }
         case bc::Cons: {
-            jcVariablePtr list = popStack();
-            jcVariablePtr item = popStack();
+            jcVariablePtr list = popOperand<Verified>();
+            jcVariablePtr item = popOperand<Verified>();
 
             JC_ASSERT_OR_THROW_VM(list->getType() == jcVariable::TypeList, "Must cons to list");
 
@@ -144,68 +373,135 @@ jcVariablePtr Interpreter::eval()
             break;
         }
         case bc::Concat: {
-            jcVariablePtr var1 = popStack();
-            jcVariablePtr var2 = popStack();
+            jcVariablePtr var1 = popOperand<Verified>();
+            jcVariablePtr var2 = popOperand<Verified>();
             JC_ASSERT_OR_THROW_VM(var1->asCollection() && var2->asCollection(), "Concat params must be collections");
 
             jcCollection *collection1 = var1->asCollection();
             jcCollection *collection2 = var2->asCollection();
 
+            // lists are immutable, so ++ with an empty one is the other one
+            bool lists = var1->getType() == jcVariable::TypeList && var2->getType() == jcVariable::TypeList;
+            if (lists && (collection1->isEmpty() || collection2->isEmpty())) {
+                curState.mStack.push(collection1->isEmpty() ? var2 : var1);
+                break;
+            }
+
             std::shared_ptr<jcCollection> newCollection = std::shared_ptr<jcCollection>(collection2->concat(*collection1));
             curState.mStack.push(jcVariable::CreateFromCollection(newCollection));
             break;
         }
         case bc::Push: {
-            JC_ASSERT(instruction.getOperand());
-            jcVariablePtr operand = resolveVariable(instruction.getOperand());
+            if (Verified == false) {
+                JC_ASSERT_OR_THROW_VM(instruction.hasOperand(), "Push requires an operand");
+            }
+            jcVariablePtr operand = instruction.argument == bc::kKeepThunk ? passVariable(constants[instruction.operand]) : resolveVariable(constants[instruction.operand]);
             curState.mStack.push(operand);
+            instruction.quicken(specializePush(constants[instruction.operand]));
+            break;
+        }
+        case bc::PushInt:
+        case bc::PushConst: {
+            curState.mStack.push(constants[instruction.operand]);
+            break;
+        }
+        case bc::PushLocal: {
+            auto &frame = curState.mVariableLut.top();
+            auto it = frame.find(constants[instruction.operand]->asJcStringRaw()->asStdString());
+            if (it == frame.end()) {
+                instruction.deoptimize();
+                curState.mIp--;
+                break;
+            }
+
+            if (it->second->getType() == jcVariable::TypeThunk && instruction.argument != bc::kKeepThunk) {
+                it->second = force(it->second);
+            }
+            curState.mStack.push(it->second);
+            break;
+        }
+        case bc::PushFunction: {
+            auto &frame = curState.mVariableLut.top();
+            if (frame.count(constants[instruction.operand]->asJcStringRaw()->asStdString()) > 0) {
+                instruction.deoptimize();
+                curState.mIp--;
+                break;
+            }
+            curState.mStack.push(constants[instruction.operand]);
             break;
         }
         case bc::PushC: {
-            std::string closureName = instruction.getOperand()->asString();
-            std::map<std::string, jcVariablePtr> scope = curState.mVariableLut.top();
+            std::string closureName = constants[instruction.operand]->asString();
+
+            // captures were pushed in slot order, so the last slot is on top
+            std::vector<jcVariablePtr> captures(instruction.argument);
+            for (int slot = instruction.argument - 1; slot >= 0; slot--) {
+                captures[slot] = popOperand<Verified>();
+            }
 
-            jcClosurePtr closure = std::make_shared<jcClosure>(closureName, scope);
+            jcClosurePtr closure = std::make_shared<jcClosure>(closureName, std::move(captures));
 
             curState.mStack.push(jcVariable::Create(closure));
             break;
         }
+        case bc::PushFree: {
+            JC_ASSERT(curState.mClosureStack.top());
+            const jcVariablePtr &capture = curState.mClosureStack.top()->capture(instruction.operand);
+            curState.mStack.push(instruction.argument == bc::kKeepThunk ? capture : force(capture));
+            break;
+        }
+        case bc::Thunk: {
+            jcVariablePtr closure = popOperand<Verified>();
+            JC_ASSERT(closure->getType() == jcVariable::TypeClosure);
+
+            jcThunkPtr thunk = std::make_shared<jcThunk>(closure->asSharedPtr<jcClosure>());
+            curState.mStack.push(jcVariable::Create(thunk));
+            break;
+        }
         case bc::Pop: {
-            jcVariablePtr variableName = instruction.getOperand();
+            const jcVariablePtr &variableName = constants[instruction.operand];
             JC_ASSERT(variableName->asJcStringRaw());
             JC_ASSERT(variableName->asJcStringRaw()->getContext() == jcString::StringContextId);
 
             std::string name = variableName->asString();
-            curState.mVariableLut.top()[name] = popStack();
+            curState.mVariableLut.top()[name] = popOperand<Verified>();
 
             break;
         }
         case bc::Call: {
             curState.callCount += 1;
-            callFunction(popStack());
+            callFunction(popOperand<Verified>(), instruction.argument);
+            if (Verified && mUnbalanced) {
+                // the stack is no longer as deep as the verifier proved, the rest runs checked
+                return eval<false>();
+            }
             break;
         }
         case bc::JmpTrue:
         case bc::Jmp: {
-            JC_ASSERT_OR_THROW_VM(instruction.numOperands() == 1, "Invalid jmpTrue operands");
-            JC_ASSERT_OR_THROW_VM(instruction.getOperand()->getType() == jcVariable::TypeString, "Invalid jmpTrue operands");
+            if (Verified == false) {
+                JC_ASSERT_OR_THROW_VM(instruction.hasOperand(), "Invalid jmpTrue operands");
+            }
 
             if (op == bc::JmpTrue) {
-                bool shouldJump = popStack()->asInt();
+                bool shouldJump = popOperand<Verified>()->asInt();
                 if (shouldJump == false) {
                     break;
                 }
             }
 
-            std::string label = instruction.getOperand()->asString();
-            JC_ASSERT_OR_THROW_VM(mLabelLut.count(label) > 0, "label " + label + " does not exist");
-            curState.mIp = mLabelLut[label] + 1;
+            if (Verified == false) {
+                JC_ASSERT_OR_THROW_VM((instruction.flags & bc::Word::Unresolved) == 0,
+                                      "label " + constants[instruction.operand]->stringRepresentation() + " does not exist");
+            }
+            curState.mIp = instruction.operand;
 
             break;
         }
         case bc::Ret: {
             popIp();
             curState.mVariableLut.pop();
+            curState.mClosureStack.pop();
 
             if ((--curState.callCount == 0) && curState.callSingleFunction) {
                 goto Interpreter_Exit;
@@ -214,21 +510,51 @@ jcVariablePtr Interpreter::eval()
             break;
         }
         case bc::Index: {
-            jcVariablePtr collection = popStack();
-            jcVariablePtr index = popStack();
+            jcVariablePtr collection = popOperand<Verified>();
+            jcVariablePtr index = popOperand<Verified>();
 
             JC_ASSERT_OR_THROW_VM(collection->asCollection(), "Cannot index non-collection type.");
             JC_ASSERT_OR_THROW_VM(index->getType() == jcVariable::TypeInt, "Index expression must be type int.");
 
             curState.mStack.push(collection->asCollection()->at(index->asInt()));
 
+            if (collection->getType() == jcVariable::TypeList) {
+                instruction.quicken(bc::IndexList);
+            } else if (collection->getType() == jcVariable::TypeString) {
+                instruction.quicken(bc::IndexString);
+            }
+            break;
+        }
+        case bc::IndexList:
+        case bc::IndexString: {
+            jcVariablePtr collection = popOperand<Verified>();
+            jcVariablePtr index = popOperand<Verified>();
+
+            jcList *list = collection->asListRaw();
+            jcString *string = collection->asJcStringRaw();
+            bool guard = index->getType() == jcVariable::TypeInt && (op == bc::IndexList ? list != nullptr : string != nullptr);
+            if (guard == false) {
+                // put the operands back and rerun the generic op
+                curState.mStack.push(index);
+                curState.mStack.push(collection);
+                instruction.deoptimize();
+                curState.mIp--;
+                break;
+            }
+
+            // the concrete type is known, so skip the virtual dispatch
+            if (op == bc::IndexList) {
+                curState.mStack.push(list->jcList::at(index->asInt()));
+            } else {
+                curState.mStack.push(string->jcString::at(index->asInt()));
+            }
             break;
         }
 
         case bc::Slice: {
-            jcVariablePtr collectionVar = popStack();
-            jcVariablePtr index1 = popStack();
-            jcVariablePtr index2 = popStack();
+            jcVariablePtr collectionVar = popOperand<Verified>();
+            jcVariablePtr index1 = popOperand<Verified>();
+            jcVariablePtr index2 = popOperand<Verified>();
 
             JC_ASSERT_OR_THROW_VM(collectionVar->asCollection(), "Cannot index non-collection type.");
             JC_ASSERT_OR_THROW_VM(index1->getType() == jcVariable::TypeInt, "Index expression must be type int.");
@@ -256,36 +582,27 @@ jcVariablePtr Interpreter::eval()
         }
     }
 Interpreter_Exit:
-    return resolveVariable(popStack());
+    return resolveVariable(popOperand<Verified>());
 }
 
-void Interpreter::callFunction(jcVariablePtr operand)
+void Interpreter::callFunction(jcVariablePtr operand, int numArguments)
 {
     std::string functionName = "";
+    jcClosurePtr closure = nullptr;
 
     JC_ASSERT_OR_THROW_VM(operand->getType() == jcVariable::TypeString ||
                        operand->getType() == jcVariable::TypeClosure,
                        "Cannot call non-closure or non-id value"
                        );
 
-    auto setupClosure = [&functionName, this](jcClosure* closure) {
-        JC_ASSERT(closure);
-        functionName = closure->name();
-
-        auto scope = closure->scope();
-
-        for (auto keyVal : scope) {
-            state().mStack.push(keyVal.second);
-        }
-    };
-
     if (operand->getType() == jcVariable::TypeClosure) {
-        jcClosure* closure = operand->asClosureRaw();
-        setupClosure(closure);
+        closure = operand->asSharedPtr<jcClosure>();
+        functionName = closure->name();
     } else if (state().mVariableLut.top().count(operand->asString()) > 0) {
         jcVariablePtr functionVar = state().mVariableLut.top()[operand->asString()];
         if (functionVar->getType() == jcVariable::TypeClosure) {
-            setupClosure(functionVar->asClosureRaw());
+            closure = functionVar->asSharedPtr<jcClosure>();
+            functionName = closure->name();
         } else {
             functionName = functionVar->asString();
         }
@@ -293,10 +610,14 @@ void Interpreter::callFunction(jcVariablePtr operand)
         functionName = operand->asString();
     }
 
-    if (functionName.size() > 0 && mLabelLut.count(functionName) > 0) {
+    auto label = mImage.labels().find(functionName);
+    if (functionName.size() > 0 && label != mImage.labels().end()) {
+        // extra arguments stay on the stack, missing ones are popped from what the caller left there
+        mUnbalanced = mUnbalanced || numArguments < mArity[label->second];
         pushIp();
         state().mVariableLut.push(std::map<std::string, jcVariablePtr>());
-        state().mIp = mLabelLut[functionName];
+        state().mClosureStack.push(closure);
+        state().mIp = label->second;
 
         return;
     }
@@ -304,6 +625,9 @@ void Interpreter::callFunction(jcVariablePtr operand)
     auto builtinFunctionInfo = lib::builtin::Shared().info(functionName);
     if (builtinFunctionInfo != nullptr)
     {
+        int builtinArity = (*builtinFunctionInfo)[lib::kLibParameterNumber]->asInt();
+        mUnbalanced = mUnbalanced || numArguments < builtinArity;
+
         jcVariablePtr result = lib::builtin::Shared().execute(functionName, *this);
         state().mStack.push(result);
         state().callCount -= 1;
@@ -322,14 +646,22 @@ jcVariablePtr Interpreter::resolveVariable(const jcVariablePtr &var)
         var->getType() == jcVariable::TypeList) {
         return var;
     } else if (type == jcVariable::TypeClosure) {
-        JC_ASSERT_OR_THROW_VM(false, "Hi dev, please do not use resolveVariable for jcClosures. thx.");
+        return var;
+    } else if (type == jcVariable::TypeThunk) {
+        return force(var);
     } else {
         if (var->asJcStringRaw()->getContext() == jcString::StringContextValue) {
             return var;
         }
 
-        if (state().mVariableLut.top().count(var->asString()) > 0) {
-            return state().mVariableLut.top()[var->asString()];
+        auto &frame = state().mVariableLut.top();
+        auto it = frame.find(var->asString());
+        if (it != frame.end()) {
+            if (it->second->getType() == jcVariable::TypeThunk) {
+                // rebind so later reads skip the thunk
+                it->second = force(it->second);
+            }
+            return it->second;
         }
 
         // if a function is defined with this value let it through
@@ -341,6 +673,53 @@ jcVariablePtr Interpreter::resolveVariable(const jcVariablePtr &var)
     }
 }
 
+jcVariablePtr Interpreter::passVariable(const jcVariablePtr &var)
+{
+    if (var->getType() == jcVariable::TypeString && var->asJcStringRaw()->getContext() == jcString::StringContextId) {
+        auto &frame = state().mVariableLut.top();
+        auto it = frame.find(var->asString());
+        if (it != frame.end()) {
+            return it->second;
+        }
+    }
+    return resolveVariable(var);
+}
+
+bc::Op Interpreter::specializePush(const jcVariablePtr &operand)
+{
+    switch (operand->getType()) {
+        case jcVariable::TypeInt:
+            return bc::PushInt;
+        case jcVariable::TypeString:
+            if (operand->asJcStringRaw()->getContext() == jcString::StringContextValue) {
+                return bc::PushConst;
+            }
+            if (state().mVariableLut.top().count(operand->asString()) > 0) {
+                return bc::PushLocal;
+            }
+            return bc::PushFunction;
+        case jcVariable::TypeChar:
+        case jcVariable::TypeList:
+        case jcVariable::TypeArray:
+            return bc::PushConst;
+        default:
+            return bc::Push;
+    }
+}
+
+jcVariablePtr Interpreter::force(const jcVariablePtr &var)
+{
+    jcThunk *thunk = var->asThunkRaw();
+    if (thunk == nullptr) {
+        return var;
+    }
+
+    if (thunk->isEvaluated() == false) {
+        thunk->setValue(interpret(jcVariable::Create(thunk->closure())));
+    }
+    return thunk->value();
+}
+
 bool Interpreter::functionExists(const jcVariablePtr &var) const
 {
     std::string functionName = "";
@@ -350,7 +729,7 @@ bool Interpreter::functionExists(const jcVariablePtr &var) const
         functionName = var->asString();
     }
 
-    if (mLabelLut.count(functionName) > 0) {
+    if (mImage.labels().count(functionName) > 0) {
         return true;
     }
 
@@ -387,6 +766,7 @@ void Interpreter::pushState()
 {
     Interpreter::_state newState;
     newState.mVariableLut.push(std::map<std::string, jcVariablePtr>());
+    newState.mClosureStack.push(nullptr);
     mState.push(newState);
 
 }
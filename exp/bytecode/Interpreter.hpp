@@ -10,8 +10,10 @@
 #include "ast.hpp"
 
 #include "bc.hpp"
+#include "Image.hpp"
+#include "VirtualMachine.hpp"
 
-class Interpreter {
+class Interpreter : public VirtualMachine {
 public:
     Interpreter();
 
@@ -20,28 +22,104 @@ public:
      */
     jcVariablePtr interpret();
 
+    /**
+     Runs from the given word until Exit and returns the value on the top of the stack
+     */
+    jcVariablePtr interpretAt(int ip);
+
     /**
      Calls the function within the callable object
      and returns the top of the stack
      */
-    jcVariablePtr interpret(jcVariablePtr callableObject, std::vector<jcVariablePtr> args = {});
+    jcVariablePtr interpret(jcVariablePtr callableObject, std::vector<jcVariablePtr> args = {}) override;
+
+    /**
+     Matches functions whose body is a single comparison of their parameter with an int literal,
+     a captured int or head of a captured list, the operand is read when matching
+     */
+    bool matchIntComparison(const jcVariablePtr &callableObject, IntComparison &comparison) override;
 
+    /**
+     Runs the function in the running state instead of pushing a new one, only the frame of the call is made
+     */
+    jcVariablePtr apply(const jcVariablePtr &function, const jcVariablePtr *args, size_t numArgs) override;
+
+    /**
+     Verifies and packs the instructions into the image that runs.
+     Images that pass the bytecode verifier run without per-instruction checks.
+     */
     void setInstructions(const std::vector<bc::Instruction> &instructions);
 
-    jcVariablePtr popStack();
+    /**
+     Runs an already assembled image, e.g. one loaded from a .jcb file. It is verified again before it runs.
+     */
+    void setImage(const bc::Image &image);
+
+    /**
+     Verifies and appends the instructions to the image, returns the index of the first one.
+     Labels they define replace those already linked.
+     */
+    int appendInstructions(const std::vector<bc::Instruction> &instructions);
+
+    struct Checkpoint {
+        bc::Image::Checkpoint image;
+        bool verified;
+    };
+
+    /**
+     Marks the image so code appended after it can be dropped with rollback
+     */
+    Checkpoint checkpoint();
+    void rollback(const Checkpoint &checkpoint);
+
+    bool isVerified() const;
+
+    /**
+     Number of instructions executed so far
+     */
+    uint64_t dispatchCount() const;
+
+    jcVariablePtr popStack() override;
 
 private:
     /**
      Returns value on the top of the stack
      */
+    template<bool Verified>
+    jcVariablePtr eval();
+
     jcVariablePtr eval();
 
+    /**
+     Pops an operand, the empty stack check is skipped for verified images
+     */
+    template<bool Verified>
+    jcVariablePtr popOperand();
+
     /**
      Resolves variables to literal values..
      */
     jcVariablePtr resolveVariable(const jcVariablePtr &var);
 
-    void mapLabels(std::vector<bc::Instruction> instructions);
+    /**
+     Resolves a variable that is only passed on, a thunk bound to it is not forced.
+     */
+    jcVariablePtr passVariable(const jcVariablePtr &var);
+
+    /**
+     Evaluates a thunk the first time it is read, other values are returned as is.
+     */
+    jcVariablePtr force(const jcVariablePtr &var);
+
+    /**
+     Returns the quickened form of a Push that just ran with the given operand
+     */
+    bc::Op specializePush(const jcVariablePtr &operand);
+
+    /**
+     Counts the parameters of the functions labeled from firstWord on
+     */
+    void mapArity(int firstWord);
 
     // push and pop instruction pointer
     void pushIp();
@@ -53,7 +131,7 @@ private:
      Otherwise the instruction pointer will be set to the function to
      be called.
      */
-    void callFunction(jcVariablePtr operand);
+    void callFunction(jcVariablePtr operand, int numArguments);
 
     bool functionExists(const jcVariablePtr &var) const;
 
@@ -63,6 +141,8 @@ private:
         std::stack<jcVariablePtr> mStack;
         std::stack<int> mIpStack;
         std::stack<std::map<std::string, jcVariablePtr>> mVariableLut;
+        // closure whose captures the current frame reads, nullptr for plain functions
+        std::stack<jcClosurePtr> mClosureStack;
 
         // instruction pointer
         int mIp=0;
@@ -81,8 +161,16 @@ private:
 
     std::stack<_state> mState;
 
-    std::map<std::string, int> mLabelLut;
+    // number of parameters popped by the function at each label
+    std::vector<int> mArity;
+
+    bool mVerified=false;
+
+    // set once a call passes fewer arguments than its callee pops, until the next run
+    bool mUnbalanced=false;
+
+    uint64_t mDispatchCount=0;
+
+    bc::Image mImage;
 
-    std::vector<bc::Instruction> mInstructions;
-    
 };
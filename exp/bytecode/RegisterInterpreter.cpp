@@ -0,0 +1,304 @@
+//  RegisterInterpreter.cpp
+
+#include "RegisterInterpreter.hpp"
+#include "jc.h"
+#include "builtin.hpp"
+#include "jcClosure.hpp"
+#include "jcList.hpp"
+
+static inline int performArtithmaticOp(rbc::Op op, int left, int right)
+{
+    switch (op) {
+    case rbc::Add:
+        return left + right;
+    case rbc::Subtract:
+        return left - right;
+    case rbc::Multiply:
+        return left * right;
+    case rbc::Divide:
+        return left / right;
+    case rbc::Greater_Than:
+        return left > right;
+    case rbc::Less_Than:
+        return left < right;
+    case rbc::Greater_Than_Equal:
+        return left >= right;
+    case rbc::Less_Than_Equal:
+        return left <= right;
+    case rbc::Equals:
+        return left == right;
+    default:
+        JC_FAIL();
+        return 0;
+    }
+}
+
+RegisterInterpreter::RegisterInterpreter(const rbc::Module &module)
+: mModule(module)
+{
+}
+
+uint64_t RegisterInterpreter::dispatchCount() const
+{
+    return mDispatchCount;
+}
+
+int RegisterInterpreter::top() const
+{
+    if (mFrames.empty()) {
+        return 0;
+    }
+    return mFrames.back().base + mFrames.back().function->numRegisters;
+}
+
+void RegisterInterpreter::reserve(int numRegisters)
+{
+    if (mRegisters.size() < numRegisters) {
+        mRegisters.resize(std::max((size_t)numRegisters, mRegisters.size() * 2));
+    }
+}
+
+jcVariablePtr RegisterInterpreter::popStack()
+{
+    JC_ASSERT_OR_THROW_VM(mBuiltinArguments.size(), "Popping empty vm-stack!");
+    jcVariablePtr argument = mBuiltinArguments.back();
+    mBuiltinArguments.pop_back();
+    return argument;
+}
+
+jcVariablePtr RegisterInterpreter::interpret()
+{
+    auto main = mModule.functionIndex.find(rbc::kMainFunction);
+    if (main == mModule.functionIndex.end()) {
+        return nullptr;
+    }
+    return interpret(jcVariable::Create(rbc::kMainFunction));
+}
+
+jcVariablePtr RegisterInterpreter::interpret(jcVariablePtr callableObject, std::vector<jcVariablePtr> args)
+{
+    // the result goes to a scratch register above the running frame
+    int destination = top();
+    int argumentBase = destination + 1;
+    reserve(argumentBase + (int)args.size());
+    for (int i = 0; i < args.size(); i++) {
+        mRegisters[argumentBase + i] = args[i];
+    }
+
+    size_t depth = mFrames.size();
+    int pc = mPc;
+    if (call(callableObject, argumentBase, (int)args.size(), destination, pc)) {
+        run(depth);
+    }
+    mPc = pc;
+
+    jcVariablePtr result = mRegisters[destination];
+    mRegisters[destination] = nullptr;
+    return result;
+}
+
+bool RegisterInterpreter::call(const jcVariablePtr &callee, int argumentBase, int numArguments, int destination, int returnPc)
+{
+    JC_ASSERT_OR_THROW_VM(callee->getType() == jcVariable::TypeString ||
+                          callee->getType() == jcVariable::TypeClosure,
+                          "Cannot call non-closure or non-id value");
+
+    jcClosurePtr closure = nullptr;
+    std::string functionName;
+    if (callee->getType() == jcVariable::TypeClosure) {
+        closure = callee->asSharedPtr<jcClosure>();
+        functionName = closure->name();
+    } else {
+        functionName = callee->asString();
+    }
+
+    auto index = mModule.functionIndex.find(functionName);
+    if (index != mModule.functionIndex.end()) {
+        const rbc::Function *function = &mModule.functions[index->second];
+
+        int base = top();
+        if (base <= argumentBase + numArguments) {
+            base = argumentBase + numArguments;
+        }
+        reserve(base + function->numRegisters);
+        if (function->numParameters == numArguments) {
+            for (int i = 0; i < numArguments; i++) {
+                mRegisters[base + i] = mRegisters[argumentBase + i];
+            }
+        } else {
+            matchArguments(functionName, argumentBase, numArguments, function->numParameters, &mRegisters[base]);
+        }
+
+        mFrames.push_back({function, closure, base, destination, returnPc});
+        mPc = function->entry;
+        return true;
+    }
+
+    auto builtinFunctionInfo = lib::builtin::Shared().info(functionName);
+    if (builtinFunctionInfo != nullptr) {
+        int builtinArity = (*builtinFunctionInfo)[lib::kLibParameterNumber]->asInt();
+
+        size_t mark = mBuiltinArguments.size();
+        if (builtinArity == numArguments) {
+            for (int i = numArguments - 1; i >= 0; i--) {
+                mBuiltinArguments.push_back(mRegisters[argumentBase + i]);
+            }
+        } else {
+            std::vector<jcVariablePtr> parameters(builtinArity);
+            matchArguments(functionName, argumentBase, numArguments, builtinArity, parameters.data());
+            mBuiltinArguments.insert(mBuiltinArguments.end(), parameters.rbegin(), parameters.rend());
+        }
+
+        jcVariablePtr result = lib::builtin::Shared().execute(functionName, *this);
+        mBuiltinArguments.resize(mark);
+        mRegisters[destination] = result;
+        return false;
+    }
+
+    JC_THROW_VM_EXCEPTION(callee->asString() + " does not exist");
+}
+
+void RegisterInterpreter::matchArguments(const std::string &functionName, int argumentBase, int numArguments, int numParameters, jcVariablePtr *parameters)
+{
+    for (int i = 0; i < std::min(numArguments, numParameters); i++) {
+        parameters[i] = mRegisters[argumentBase + i];
+    }
+    for (int i = numArguments - 1; i >= numParameters; i--) {
+        mLeftoverArguments.push_back(mRegisters[argumentBase + i]);
+    }
+    for (int i = numArguments; i < numParameters; i++) {
+        JC_ASSERT_OR_THROW_VM(mLeftoverArguments.size(),
+                              functionName + " expects " + std::to_string(numParameters) +
+                              " arguments, got " + std::to_string(numArguments));
+        parameters[i] = mLeftoverArguments.back();
+        mLeftoverArguments.pop_back();
+    }
+}
+
+jcVariablePtr RegisterInterpreter::run(size_t depth)
+{
+    const std::vector<rbc::Instruction> &code = mModule.code;
+    jcVariablePtr *r = &mRegisters[mFrames.back().base];
+
+    while (1) {
+        const rbc::Instruction &instruction = code[mPc++];
+        mDispatchCount++;
+
+        switch (instruction.op) {
+        case rbc::LoadConst:
+            r[instruction.a] = instruction.k;
+            break;
+        case rbc::LoadFree: {
+            const jcClosurePtr &closure = mFrames.back().closure;
+            JC_ASSERT(closure);
+            r[instruction.a] = closure->capture(instruction.b);
+            break;
+        }
+        case rbc::Move:
+            r[instruction.a] = r[instruction.b];
+            break;
+        case rbc::Add:
+        case rbc::Subtract:
+        case rbc::Multiply:
+        case rbc::Divide:
+        case rbc::Greater_Than:
+        case rbc::Less_Than:
+        case rbc::Less_Than_Equal:
+        case rbc::Greater_Than_Equal:
+        case rbc::Equals:
+            r[instruction.a] = jcVariable::Create(performArtithmaticOp(instruction.op, r[instruction.b]->asInt(), r[instruction.c]->asInt()));
+            break;
+        case rbc::Neg:
+            r[instruction.a] = jcVariable::Create(-r[instruction.b]->asInt());
+            break;
+        case rbc::Not:
+            r[instruction.a] = jcVariable::Create(!r[instruction.b]->asInt());
+            break;
+        case rbc::Cons: {
+            const jcVariablePtr &list = r[instruction.c];
+            JC_ASSERT_OR_THROW_VM(list->getType() == jcVariable::TypeList, "Must cons to list");
+
+            jcListPtr newList = std::shared_ptr<jcList>(list->asListRaw()->cons(r[instruction.b]));
+            r[instruction.a] = jcVariable::CreateFromCollection(newList);
+            break;
+        }
+        case rbc::Concat: {
+            jcCollection *left = r[instruction.b]->asCollection();
+            jcCollection *right = r[instruction.c]->asCollection();
+            JC_ASSERT_OR_THROW_VM(left && right, "Concat params must be collections");
+
+            // lists are immutable, so ++ with an empty one is the other one
+            bool lists = left->getType() == jcVariable::TypeList && right->getType() == jcVariable::TypeList;
+            if (lists && (left->isEmpty() || right->isEmpty())) {
+                r[instruction.a] = left->isEmpty() ? r[instruction.c] : r[instruction.b];
+                break;
+            }
+
+            r[instruction.a] = jcVariable::CreateFromCollection(std::shared_ptr<jcCollection>(left->concat(*right)));
+            break;
+        }
+        case rbc::Index: {
+            jcCollection *collection = r[instruction.b]->asCollection();
+            const jcVariablePtr &index = r[instruction.c];
+            JC_ASSERT_OR_THROW_VM(collection, "Cannot index non-collection type.");
+            JC_ASSERT_OR_THROW_VM(index->getType() == jcVariable::TypeInt, "Index expression must be type int.");
+
+            r[instruction.a] = collection->at(index->asInt());
+            break;
+        }
+        case rbc::Slice: {
+            jcCollection *collection = r[instruction.b]->asCollection();
+            const jcVariablePtr &index1 = r[instruction.c];
+            const jcVariablePtr &index2 = r[instruction.c + 1];
+            JC_ASSERT_OR_THROW_VM(collection, "Cannot index non-collection type.");
+            JC_ASSERT_OR_THROW_VM(index1->getType() == jcVariable::TypeInt, "Index expression must be type int.");
+            JC_ASSERT_OR_THROW_VM(index2->getType() == jcVariable::TypeInt, "Index expression must be type int.");
+
+            int startIndex = index1->asInt() == -1 ? 0 : index1->asInt();
+            int endIndex = index2->asInt() == -1 ? (int)collection->size() : index2->asInt();
+
+            r[instruction.a] = jcVariable::CreateFromCollection(std::shared_ptr<jcCollection>(collection->slice(startIndex, endIndex)));
+            break;
+        }
+        case rbc::MakeClosure: {
+            std::vector<jcVariablePtr> captures(r + instruction.b, r + instruction.b + instruction.c);
+            jcClosurePtr closure = std::make_shared<jcClosure>(instruction.k->asString(), std::move(captures));
+            r[instruction.a] = jcVariable::Create(closure);
+            break;
+        }
+        case rbc::Call: {
+            int base = mFrames.back().base;
+            jcVariablePtr callee = r[instruction.b];
+            call(callee, base + instruction.c, instruction.d, base + instruction.a, mPc);
+
+            // the register file may have grown
+            r = &mRegisters[mFrames.back().base];
+            break;
+        }
+        case rbc::Jmp:
+            mPc = instruction.b;
+            break;
+        case rbc::JmpTrue:
+            if (r[instruction.a]->asInt()) {
+                mPc = instruction.b;
+            }
+            break;
+        case rbc::Ret: {
+            jcVariablePtr result = r[instruction.a];
+            Frame frame = mFrames.back();
+            mFrames.pop_back();
+
+            mRegisters[frame.destination] = result;
+            mPc = frame.returnPc;
+            if (mFrames.size() == depth) {
+                return result;
+            }
+            r = &mRegisters[mFrames.back().base];
+            break;
+        }
+        default:
+            JC_FAIL();
+            break;
+        }
+    }
+}
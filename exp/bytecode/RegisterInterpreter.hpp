@@ -0,0 +1,91 @@
+//  RegisterInterpreter.hpp
+
+#pragma once
+
+#include <vector>
+
+#include "rbc.hpp"
+#include "VirtualMachine.hpp"
+
+/**
+ Runs register bytecode. Every frame owns a window of one shared register file,
+ so arguments are copied into the callee's window instead of going through a stack.
+ */
+class RegisterInterpreter : public VirtualMachine {
+public:
+    RegisterInterpreter(const rbc::Module &module);
+
+    /**
+     Runs rbc::kMainFunction and returns the value of the last top level expression
+     */
+    jcVariablePtr interpret();
+
+    /**
+     Calls the function within the callable object, args are given in parameter order
+     */
+    jcVariablePtr interpret(jcVariablePtr callableObject, std::vector<jcVariablePtr> args = {}) override;
+
+    /**
+     Pops the next argument of the running library function
+     */
+    jcVariablePtr popStack() override;
+
+    /**
+     Number of instructions executed so far
+     */
+    uint64_t dispatchCount() const;
+
+private:
+    struct Frame {
+        const rbc::Function *function;
+        jcClosurePtr closure;
+
+        // first register of the frame
+        int base;
+
+        // absolute register receiving the return value
+        int destination;
+
+        int returnPc;
+    };
+
+    /**
+     Runs until the frame at the given depth returns
+     */
+    jcVariablePtr run(size_t depth);
+
+    /**
+     Pushes a frame for the callee, or runs it right away if it is a library function.
+     Returns true if a frame was pushed.
+     */
+    bool call(const jcVariablePtr &callee, int argumentBase, int numArguments, int destination, int returnPc);
+
+    /**
+     Copies the arguments of a call into the callee's parameters. Like on the stack engine, arguments past
+     the parameters are left over and parameters past the arguments take what was left over.
+     */
+    void matchArguments(const std::string &functionName, int argumentBase, int numArguments, int numParameters, jcVariablePtr *parameters);
+
+    /**
+     First register past the running frame
+     */
+    int top() const;
+
+    void reserve(int numRegisters);
+
+private:
+    const rbc::Module &mModule;
+
+    std::vector<jcVariablePtr> mRegisters;
+    std::vector<Frame> mFrames;
+
+    // arguments of the running library function, the first argument is at the back
+    std::vector<jcVariablePtr> mBuiltinArguments;
+
+    // arguments no parameter took, the next one to take is at the back
+    std::vector<jcVariablePtr> mLeftoverArguments;
+
+    int mPc=0;
+
+    uint64_t mDispatchCount=0;
+};
@@ -3,14 +3,19 @@
 #include "jc.h"
 
 #include "Interpreter.hpp"
+#include "RegisterInterpreter.hpp"
 #include "Lexer.hpp"
 #include "Parser.hpp"
 #include "Runtime.hpp"
+#include "SourceFile.hpp"
 #include "Token.hpp"
 #include "Visitor.h"
 #include "ast.hpp"
 
 #include "bc.hpp"
+#include "ImageFile.hpp"
+#include "jcUtils.hpp"
+#include "prelude.hpp"
 
 #include <cstdlib>
 #include <cstring>
@@ -19,25 +24,20 @@
 #include <sstream>
 #include <fstream>
 
-Runtime::Runtime()
-{
-    mImportDefintions = loadLibrary(JC_STD_LIBRARY_PATH);
-}
-
-std::vector<bc::Instruction> Runtime::instructionsFromDefinitions()
-{
-    std::vector<bc::Instruction> instructions(mImportDefintions);
+#include <sys/stat.h>
 
-    for (auto pair : mReplDefinitions) {
-        auto ctx = pair.second;
-        instructions.insert(instructions.end(), ctx.function.begin(), ctx.function.end());
-        instructions.insert(instructions.end(), ctx.closures.begin(), ctx.closures.end());
-    }
+/**
+ Keeps the standard library's generated labels apart from those of code compiled later
+ */
+static const std::string kLibraryLabelPrefix = "std.";
 
-    return instructions;
+Runtime::Runtime(const RuntimeOptions &options)
+: mOptions(options)
+{
+    mInterpreter.setInstructions(*libraryDefinitions(mOptions, mStrictness));
 }
 
-std::vector<bc::Instruction> Runtime::loadLibrary(const std::string &path)
+std::vector<bc::Instruction> Runtime::loadLibrary(const std::string &path, const RuntimeOptions &options, bc::StrictnessTable &strictness)
 {
     std::ifstream inputStream;
     inputStream.open(path.c_str(), std::ifstream::in | std::ifstream::binary);
@@ -46,98 +46,440 @@ std::vector<bc::Instruction> Runtime::loadLibrary(const std::string &path)
         return {};
     }
 
+    return generateLibrary(inputStream, options, strictness);
+}
+
+std::vector<bc::Instruction> Runtime::generateLibrary(std::istream& stream, const RuntimeOptions &options, bc::StrictnessTable &strictness)
+{
     std::vector<bc::Instruction> definitions;
 
-    traverseStream(inputStream,
-       [&definitions](std::string definitionName, std::vector<bc::Instruction> newDefinitions, std::vector<bc::Instruction> closures) {
+    Lexer lexer(stream);
+    traverse(lexer, options, strictness,
+       [&definitions](std::string definitionName, std::vector<bc::Instruction> newDefinitions, std::vector<bc::Instruction> closures, int64_t) {
             definitions.insert(definitions.end(), newDefinitions.begin(), newDefinitions.end());
             definitions.insert(definitions.end(), closures.begin(), closures.end());
-       }, [](std::vector<bc::Instruction>, std::vector<bc::Instruction>) {
+       }, [](std::vector<bc::Instruction>, std::vector<bc::Instruction>, int64_t) {
 
-       });
+       }, kLibraryLabelPrefix);
     return definitions;
 }
 
-void Runtime::traverseStream(std::istream& stream, DefinitionCallback definitionHandler, ExpressionCallback expressionHandler)
+void Runtime::traverse(Lexer &lexer,
+                       const RuntimeOptions &options,
+                       bc::StrictnessTable &strictness,
+                       DefinitionCallback definitionHandler,
+                       ExpressionCallback expressionHandler,
+                       const std::string &labelPrefix)
 {
-    Lexer lex(stream);
-    Parser parser(lex);
-    std::vector<std::shared_ptr<Node>> nodes = parser.parse();
-
-    if (nodes.size() == 0) {
+    if (options.streaming == false) {
+        traverseChunks(lexer, options, strictness, definitionHandler, expressionHandler, labelPrefix);
         return;
     }
 
+    // the AST lives in the parser's arena and is freed as soon as it is generated
+    Parser parser(lexer);
+
     bc::Generator bcGenerator;
+    bcGenerator.setLabelPrefix(labelPrefix);
+    if (options.lazyEvaluation) {
+        bcGenerator.setLazy(&strictness);
+    }
 
-    for (auto ast : nodes) {
-        JC_ASSERT(ast);
+    while (Node *ast = parser.parseLine()) {
+        if (options.lazyEvaluation && ast->type() == kFunctionDeclType) {
+            // functions defined further down are not known yet, calls to them pass their arguments strictly
+            bc::StrictnessAnalyzer::analyze({ static_cast<FunctionDecl*>(ast) }, strictness);
+        }
 
         auto output = bcGenerator.getInstructions(ast);
         auto closures = bcGenerator.getClosureInstructions();
 
         if (output.size()) {
             if (ast->type() == kFunctionDeclType) {
-                std::shared_ptr<FunctionDecl> functionDecl = std::static_pointer_cast<FunctionDecl>(ast);
+                definitionHandler(std::string(static_cast<FunctionDecl*>(ast)->getId()), output, closures, parser.lastLine());
+            } else {
+                expressionHandler(output, closures, parser.lastLine());
+            }
+        }
+        parser.releaseNodes();
+    }
+}
+
+/**
+ Source bytes per compiled chunk, enough to keep every core busy on a large file
+ without setting up a parser and generator for each definition
+ */
+static const size_t kCompileChunkSize = 16 * 1024;
+
+void Runtime::traverseChunks(Lexer &lexer,
+                             const RuntimeOptions &options,
+                             bc::StrictnessTable &strictness,
+                             DefinitionCallback definitionHandler,
+                             ExpressionCallback expressionHandler,
+                             const std::string &labelPrefix)
+{
+    struct Generated {
+        // empty for an expression
+        std::string definitionName;
+        std::vector<bc::Instruction> output;
+        std::vector<bc::Instruction> closures;
+        int64_t line;
+    };
+
+    struct Chunk {
+        std::unique_ptr<Lexer> lexer;
+        std::unique_ptr<Parser> parser;
+        std::vector<Node*> nodes;
+        std::vector<Generated> generated;
+    };
+
+    std::vector<Lexer::Chunk> sources = lexer.split(kCompileChunkSize);
+    std::vector<Chunk> chunks(sources.size());
+
+    auto parse = [&](size_t idx) {
+        Chunk &chunk = chunks[idx];
+        chunk.lexer = std::make_unique<Lexer>(sources[idx].data, sources[idx].size, sources[idx].line);
+        chunk.parser = std::make_unique<Parser>(*chunk.lexer);
+        chunk.nodes = chunk.parser->parse();
+    };
+
+    auto generate = [&](size_t idx) {
+        Chunk &chunk = chunks[idx];
+
+        // labels are numbered per chunk, so they do not depend on the order chunks are generated in
+        bc::Generator bcGenerator;
+        bcGenerator.setLabelPrefix(labelPrefix + std::to_string(idx) + ".");
+        if (options.lazyEvaluation) {
+            bcGenerator.setLazy(&strictness);
+        }
+
+        for (int i = 0; i < chunk.nodes.size(); i++) {
+            Node *ast = chunk.nodes[i];
+            auto output = bcGenerator.getInstructions(ast);
+            auto closures = bcGenerator.getClosureInstructions();
+            if (output.size() == 0) {
+                continue;
+            }
+
+            std::string definitionName;
+            if (ast->type() == kFunctionDeclType) {
+                definitionName = std::string(static_cast<FunctionDecl*>(ast)->getId());
+            }
+            chunk.generated.push_back({ std::move(definitionName), std::move(output), std::move(closures), chunk.parser->lines()[i] });
+        }
+
+        // frees the AST
+        chunk.nodes.clear();
+        chunk.parser.reset();
+        chunk.lexer.reset();
+    };
+
+    if (options.lazyEvaluation) {
+        jc::parallelFor(chunks.size(), options.compileThreads, parse);
+
+        // strictness is solved over every definition before any of them is generated
+        std::vector<FunctionDecl*> functions;
+        for (Chunk &chunk : chunks) {
+            for (Node *ast : chunk.nodes) {
+                if (ast->type() == kFunctionDeclType) {
+                    functions.push_back(static_cast<FunctionDecl*>(ast));
+                }
+            }
+        }
+        bc::StrictnessAnalyzer::analyze(functions, strictness);
+
+        jc::parallelFor(chunks.size(), options.compileThreads, generate);
+    } else {
+        jc::parallelFor(chunks.size(), options.compileThreads, [&](size_t idx) {
+            parse(idx);
+            generate(idx);
+        });
+    }
 
-                definitionHandler(functionDecl->getId(), output, closures);
+    // linked in source order
+    for (Chunk &chunk : chunks) {
+        for (Generated &item : chunk.generated) {
+            if (item.definitionName.size()) {
+                definitionHandler(std::move(item.definitionName), std::move(item.output), std::move(item.closures), item.line);
             } else {
-                expressionHandler(output, closures);
+                expressionHandler(std::move(item.output), std::move(item.closures), item.line);
             }
         }
     }
 }
 
-void Runtime::evaluate(std::istream& stream)
+static void createDirectories(const std::string &path)
+{
+    for (size_t end = path.find('/', 1); ; end = path.find('/', end + 1)) {
+        mkdir(path.substr(0, end).c_str(), 0755);
+        if (end == std::string::npos) {
+            break;
+        }
+    }
+}
+
+static std::string readStream(std::istream& stream)
+{
+    std::stringstream contents;
+    contents << stream.rdbuf();
+    return contents.str();
+}
+
+RuntimeStatistics Runtime::evaluate(std::istream& stream, const RuntimeOptions &options)
+{
+    if (options.engine == RuntimeOptions::Engine::Register) {
+        Lexer lexer(stream);
+        return evaluateRegister(lexer);
+    }
+    if (options.streaming) {
+        Lexer lexer(stream);
+        return evaluateStreaming(lexer, options);
+    }
+
+    std::string source = readStream(stream);
+    return evaluateSource(source.data(), source.size(), options);
+}
+
+RuntimeStatistics Runtime::evaluateFile(const std::string &path, const RuntimeOptions &options)
+{
+    std::shared_ptr<SourceFile> file = SourceFile::open(path);
+    if (file == nullptr) {
+        JC_THROW_VM_EXCEPTION("Unable to open file: " + path);
+    }
+
+    if (options.engine == RuntimeOptions::Engine::Register) {
+        Lexer lexer(file->data(), file->size());
+        return evaluateRegister(lexer);
+    }
+    if (options.streaming) {
+        Lexer lexer(file->data(), file->size());
+        return evaluateStreaming(lexer, options);
+    }
+    return evaluateSource(file->data(), file->size(), options);
+}
+
+RuntimeStatistics Runtime::evaluateSource(const char *source, size_t size, const RuntimeOptions &options)
 {
-    std::vector<bc::Instruction> definitions(loadLibrary(JC_STD_LIBRARY_PATH));
+    if (options.cacheDirectory.empty()) {
+        Lexer lexer(source, size);
+        return evaluate(compile(lexer, options));
+    }
+
+    uint64_t hash = sourceHash(source, size, options);
+
+    std::stringstream name;
+    name << std::hex << hash << ".jcb";
+    std::string path = options.cacheDirectory + "/" + name.str();
+
+    bc::Image image;
+    uint64_t cachedHash = 0;
+    if (bc::ImageFile::load(path, image, &cachedHash) == false || cachedHash != hash) {
+        Lexer lexer(source, size);
+        image = compile(lexer, options);
+
+        // a cache that cannot be written only costs the next run a compile
+        createDirectories(options.cacheDirectory);
+        bc::ImageFile::write(image, hash, path);
+    }
+
+    return evaluate(image);
+}
+
+RuntimeStatistics Runtime::evaluate(const bc::Image &image)
+{
+    Interpreter interpreter;
+    interpreter.setImage(image);
+
+    RuntimeStatistics statistics;
+    statistics.seconds = jc::measureElapsedTime([&interpreter]() {
+        interpreter.interpret();
+    });
+    statistics.dispatchCount = interpreter.dispatchCount();
+    return statistics;
+}
+
+bc::Image Runtime::compile(std::istream& stream, const RuntimeOptions &options)
+{
+    Lexer lexer(stream);
+    return compile(lexer, options);
+}
+
+bc::Image Runtime::compile(Lexer &lexer, const RuntimeOptions &options)
+{
+    bc::StrictnessTable strictness;
+    std::vector<bc::Instruction> definitions(*libraryDefinitions(options, strictness));
     JC_ASSERT(definitions.size());
     std::vector<bc::Instruction> expressions;
-    traverseStream(stream,
-       [&definitions](std::string definitionName, std::vector<bc::Instruction> newDefinitions, std::vector<bc::Instruction> closures) {
+
+    // first instruction of each definition/expression, relative to the section it is added to
+    std::vector<bc::Image::Line> definitionLines = { { (uint32_t)definitions.size(), -1 } };
+    std::vector<bc::Image::Line> expressionLines;
+
+    traverse(lexer, options, strictness,
+       [&definitions, &definitionLines](std::string definitionName, std::vector<bc::Instruction> newDefinitions, std::vector<bc::Instruction> closures, int64_t line) {
+           definitionLines.push_back({ (uint32_t)definitions.size(), (int32_t)line });
            definitions.insert(definitions.end(), newDefinitions.begin(), newDefinitions.end());
            definitions.insert(definitions.end(), closures.begin(), closures.end());
        },
-       [&definitions, &expressions](std::vector<bc::Instruction> newExpressions, std::vector<bc::Instruction> closures) {
+       [&definitions, &expressions, &definitionLines, &expressionLines](std::vector<bc::Instruction> newExpressions, std::vector<bc::Instruction> closures, int64_t line) {
+           expressionLines.push_back({ (uint32_t)expressions.size(), (int32_t)line });
            expressions.insert(expressions.end(), newExpressions.begin(), newExpressions.end());
+
+           definitionLines.push_back({ (uint32_t)definitions.size(), (int32_t)line });
            definitions.insert(definitions.end(), closures.begin(), closures.end());
        });
     expressions.push_back(bc::Instruction(bc::Exit, {}));
+
+    // the library comes before the first definition of the stream
+    uint32_t definitionsStart = (uint32_t)expressions.size();
+    std::vector<bc::Image::Line> lines = expressionLines;
+    lines.push_back({ definitionsStart, -1 });
+    for (auto line : definitionLines) {
+        lines.push_back({ definitionsStart + line.firstWord, line.line });
+    }
+
     expressions.insert(expressions.end(), definitions.begin(), definitions.end());
 
-    Interpreter interpreter;
-    interpreter.setInstructions(expressions);
+    bc::Image image = bc::Image::assemble(expressions);
+    image.setLines(std::move(lines));
+    return image;
+}
 
-    interpreter.interpret();
+uint64_t Runtime::sourceHash(const std::string &source, const RuntimeOptions &options)
+{
+    return sourceHash(source.data(), source.size(), options);
 }
 
+uint64_t Runtime::sourceHash(const char *source, size_t size, const RuntimeOptions &options)
+{
+    std::string settings = std::to_string(bc::ImageFile::kVersion) + (options.lazyEvaluation ? " lazy" : " strict");
+    uint64_t hash = bc::ImageFile::hash(settings);
 
-bool Runtime::evaluateREPL(std::istream& stream, std::vector<jcVariablePtr>& outputValues)
+    if (options.lazyEvaluation == false && lib::kPreludeImageSize > 0) {
+        hash = bc::ImageFile::hash(reinterpret_cast<const char*>(lib::kPreludeImage), lib::kPreludeImageSize, hash);
+    } else {
+        std::ifstream libraryStream;
+        libraryStream.open(JC_STD_LIBRARY_PATH, std::ifstream::in | std::ifstream::binary);
+        if (libraryStream.is_open() == false) {
+            JC_THROW_VM_EXCEPTION(std::string("Unable to load library: ") + JC_STD_LIBRARY_PATH);
+        }
+        hash = bc::ImageFile::hash(readStream(libraryStream), hash);
+    }
+    return bc::ImageFile::hash(source, size, hash);
+}
+
+bc::Image Runtime::compileLibrary(std::istream& stream)
 {
-    traverseStream(stream,
-    [this](std::string definitionName, std::vector<bc::Instruction> definitions, std::vector<bc::Instruction> closures) {
-        FunctionContext ctx;
-        ctx.function = definitions;
-        ctx.closures = closures;
+    bc::StrictnessTable strictness;
+    return bc::Image::assemble(generateLibrary(stream, RuntimeOptions(), strictness));
+}
 
-        mReplDefinitions[definitionName] = ctx;
-    },
-    [&outputValues, this](std::vector<bc::Instruction> expressions, std::vector<bc::Instruction> closures) {
-        expressions.push_back(bc::Instruction(bc::Exit, {}));
+std::shared_ptr<const std::vector<bc::Instruction>> Runtime::libraryDefinitions(const RuntimeOptions &options, bc::StrictnessTable &strictness)
+{
+    // lazy code depends on the strictness table, which the prelude does not carry
+    if (options.lazyEvaluation || lib::kPreludeImageSize == 0) {
+        return std::make_shared<const std::vector<bc::Instruction>>(loadLibrary(JC_STD_LIBRARY_PATH, options, strictness));
+    }
 
-        Interpreter interpreter;
+    static std::shared_ptr<const std::vector<bc::Instruction>> prelude = []() {
+        bc::Image image;
+        bool loaded = bc::ImageFile::read(reinterpret_cast<const char*>(lib::kPreludeImage), lib::kPreludeImageSize, image);
+        JC_ASSERT_OR_THROW_VM(loaded, "Embedded standard library is corrupt");
+        return std::make_shared<const std::vector<bc::Instruction>>(image.disassemble());
+    }();
+    return prelude;
+}
+
+void Runtime::generateModule(Lexer &lexer, rbc::Module &module)
+{
+    Parser parser(lexer);
+    std::vector<Node*> nodes = parser.parse();
 
-        std::vector<bc::Instruction> definitionInstructions = instructionsFromDefinitions();
+    rbc::Generator generator(module);
+    generator.generate(nodes);
+}
 
-        // add definitions
-        expressions.insert(expressions.end(), definitionInstructions.begin(), definitionInstructions.end());
+RuntimeStatistics Runtime::evaluateRegister(Lexer &lexer)
+{
+    std::ifstream libraryStream;
+    libraryStream.open(JC_STD_LIBRARY_PATH, std::ifstream::in | std::ifstream::binary);
+    if (libraryStream.is_open() == false) {
+        JC_THROW_VM_EXCEPTION(std::string("Unable to load library: ") + JC_STD_LIBRARY_PATH);
+    }
 
-        // add closures
-        expressions.insert(expressions.end(), closures.begin(), closures.end());
+    rbc::Module module;
+    Lexer libraryLexer(libraryStream);
+    generateModule(libraryLexer, module);
+    generateModule(lexer, module);
 
-        interpreter.setInstructions(expressions);
+    RegisterInterpreter interpreter(module);
 
-        outputValues.push_back(interpreter.interpret());
+    RuntimeStatistics statistics;
+    statistics.seconds = jc::measureElapsedTime([&interpreter]() {
+        interpreter.interpret();
     });
+    statistics.dispatchCount = interpreter.dispatchCount();
+    return statistics;
+}
+
+
+RuntimeStatistics Runtime::evaluateStreaming(Lexer &lexer, const RuntimeOptions &options)
+{
+    bc::StrictnessTable strictness;
+    Interpreter interpreter;
+    interpreter.setInstructions(*libraryDefinitions(options, strictness));
+
+    // compiling and running are interleaved, so the time covers both
+    RuntimeStatistics statistics;
+    statistics.seconds = jc::measureElapsedTime([&]() {
+        traverse(lexer, options, strictness,
+        [&interpreter](std::string definitionName, std::vector<bc::Instruction> definitions, std::vector<bc::Instruction> closures, int64_t) {
+            linkDefinition(interpreter, std::move(definitions), closures);
+        },
+        [&interpreter](std::vector<bc::Instruction> expressions, std::vector<bc::Instruction> closures, int64_t) {
+            runExpression(interpreter, std::move(expressions), closures);
+        });
+    });
+    statistics.dispatchCount = interpreter.dispatchCount();
+    return statistics;
+}
+
+void Runtime::linkDefinition(Interpreter &interpreter, std::vector<bc::Instruction> definition, const std::vector<bc::Instruction> &closures)
+{
+    definition.insert(definition.end(), closures.begin(), closures.end());
+    interpreter.appendInstructions(definition);
+}
+
+jcVariablePtr Runtime::runExpression(Interpreter &interpreter, std::vector<bc::Instruction> expression, const std::vector<bc::Instruction> &closures)
+{
+    expression.push_back(bc::Instruction(bc::Exit, {}));
+    expression.insert(expression.end(), closures.begin(), closures.end());
+
+    // the expression's code is only needed while it runs
+    Interpreter::Checkpoint checkpoint = interpreter.checkpoint();
+    jcVariablePtr value;
+    try {
+        int entry = interpreter.appendInstructions(expression);
+        value = interpreter.interpretAt(entry);
+    } catch (...) {
+        interpreter.rollback(checkpoint);
+        throw;
+    }
+    interpreter.rollback(checkpoint);
+    return value;
+}
+
+bool Runtime::evaluateREPL(std::istream& stream, std::vector<jcVariablePtr>& outputValues)
+{
+    std::string labelPrefix = "r" + std::to_string(mNumEvaluations++) + ".";
+
+    Lexer lexer(stream);
+    traverse(lexer, mOptions, mStrictness,
+    [this](std::string definitionName, std::vector<bc::Instruction> definitions, std::vector<bc::Instruction> closures, int64_t) {
+        linkDefinition(mInterpreter, std::move(definitions), closures);
+    },
+    [&outputValues, this](std::vector<bc::Instruction> expressions, std::vector<bc::Instruction> closures, int64_t) {
+        outputValues.push_back(runExpression(mInterpreter, std::move(expressions), closures));
+    }, labelPrefix);
     return true;
 }
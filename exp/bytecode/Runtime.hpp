@@ -3,53 +3,185 @@
 #pragma once
 
 #include "bc.hpp"
+#include "rbc.hpp"
+#include "Interpreter.hpp"
+#include "Image.hpp"
+#include "Strictness.hpp"
+
+class Lexer;
 
 #include <istream>
 #include <string>
 #include <functional>
 #include <map>
+#include <memory>
+
+struct RuntimeOptions {
+    enum class Engine {
+        Stack,
+        Register,
+    };
+
+    /**
+     Pass arguments to non-strict parameters as memoized thunks (call-by-need)
+     Only supported by the stack engine.
+     */
+    bool lazyEvaluation=false;
+
+    /**
+     Bytecode and virtual machine used when evaluating a file, the REPL always uses the stack engine
+     */
+    Engine engine=Engine::Stack;
+
+    /**
+     Directory where compiled files are cached by source hash, empty disables the cache.
+     Only used by the stack engine.
+     */
+    std::string cacheDirectory;
+
+    /**
+     Run each top level expression as soon as it is parsed instead of compiling the whole file first.
+     Definitions are linked as they are read and calls are resolved when they run, so an expression
+     can call any function defined above it. Memory stays bounded by the definitions, not the file.
+     Only used by the stack engine and never cached.
+     */
+    bool streaming=false;
+
+    /**
+     Threads that compile a file, 0 uses one per core. The file is cut into chunks at top level definitions
+     which are compiled independently and linked in order, so the image is the same for any number of threads.
+     */
+    unsigned compileThreads=0;
+};
+
+struct RuntimeStatistics {
+    // instructions executed
+    uint64_t dispatchCount=0;
+
+    // wall time of the run, excluding compilation
+    double seconds=0;
+};
 
 class Runtime {
 public:
-    Runtime();
+    Runtime(const RuntimeOptions &options = RuntimeOptions());
 
     /**
      This method should be used when evaluating instructions generated from the REPL.
-     If a definition is redefined, it will override the previous definition
+     If a definition is redefined, it will override the previous definition.
+     Only the new code is linked, so the cost does not grow with the session.
      */
     bool evaluateREPL(std::istream& stream, std::vector<jcVariablePtr>& outputValues);
 
     /**
      Use this when evaluating instructions generated from a file
      */
-    static void evaluate(std::istream& stream);
+    static RuntimeStatistics evaluate(std::istream& stream, const RuntimeOptions &options = RuntimeOptions());
+
+    /**
+     Maps the source file and evaluates it, the file is lexed in place
+     */
+    static RuntimeStatistics evaluateFile(const std::string &path, const RuntimeOptions &options = RuntimeOptions());
+
+    /**
+     Runs a compiled file
+     */
+    static RuntimeStatistics evaluate(const bc::Image &image);
+
+    /**
+     Compiles the stream together with the standard library into the image evaluate would run
+     */
+    static bc::Image compile(std::istream& stream, const RuntimeOptions &options = RuntimeOptions());
+
+    /**
+     Identifies the image compile would produce for the source: hashes the source, the standard library,
+     the image format version and the options that change code generation
+     */
+    static uint64_t sourceHash(const std::string &source, const RuntimeOptions &options);
+    static uint64_t sourceHash(const char *source, size_t size, const RuntimeOptions &options);
+
+    /**
+     Compiles the standard library on its own, the build embeds the result as lib::kPreludeImage
+     */
+    static bc::Image compileLibrary(std::istream& stream);
 private:
 
+    /**
+     Evaluates source held in memory, looking up and filling the compile cache
+     */
+    static RuntimeStatistics evaluateSource(const char *source, size_t size, const RuntimeOptions &options);
+
+    static bc::Image compile(Lexer &lexer, const RuntimeOptions &options);
+
+    static RuntimeStatistics evaluateRegister(Lexer &lexer);
+
+    static RuntimeStatistics evaluateStreaming(Lexer &lexer, const RuntimeOptions &options);
+
+    /**
+     Appends a definition and the closures it creates to the interpreter's image
+     */
+    static void linkDefinition(Interpreter &interpreter, std::vector<bc::Instruction> definition, const std::vector<bc::Instruction> &closures);
+
+    /**
+     Appends an expression, runs it and drops its code again
+     */
+    static jcVariablePtr runExpression(Interpreter &interpreter, std::vector<bc::Instruction> expression, const std::vector<bc::Instruction> &closures);
+
+    /**
+     Parses the input and adds its definitions and top level expressions to the module
+     */
+    static void generateModule(Lexer &lexer, rbc::Module &module);
+
     // Type aliases
-    using DefinitionCallback = std::function<void(std::string, std::vector<bc::Instruction>, std::vector<bc::Instruction>)>;
-    using ExpressionCallback = std::function<void(std::vector<bc::Instruction>, std::vector<bc::Instruction>)>;
+    // the last argument is the source line of the definition/expression
+    using DefinitionCallback = std::function<void(std::string, std::vector<bc::Instruction>, std::vector<bc::Instruction>, int64_t)>;
+    using ExpressionCallback = std::function<void(std::vector<bc::Instruction>, std::vector<bc::Instruction>, int64_t)>;
+
+    /**
+     The standard library definitions. The embedded prelude is decoded once and shared by every runtime,
+     lazy mode and builds without it compile JC_STD_LIBRARY_PATH instead.
+     */
+    static std::shared_ptr<const std::vector<bc::Instruction>> libraryDefinitions(const RuntimeOptions &options, bc::StrictnessTable &strictness);
 
     /**
      load-library
      */
-    static std::vector<bc::Instruction> loadLibrary(const std::string &path);
+    static std::vector<bc::Instruction> loadLibrary(const std::string &path, const RuntimeOptions &options, bc::StrictnessTable &strictness);
+
+    static std::vector<bc::Instruction> generateLibrary(std::istream& stream, const RuntimeOptions &options, bc::StrictnessTable &strictness);
 
     /**
-     Traverses the input stream and generates instructions
+     Traverses the input and generates instructions, top level items are handled in the order they are read.
+     In lazy mode the strictness of the definitions found is added to the given table.
+     Unless streaming, the whole input is compiled before the first item is handled.
      */
-    static void traverseStream(std::istream& stream, DefinitionCallback definitionHandler, ExpressionCallback expressionHandler);
+    static void traverse(Lexer &lexer,
+                               const RuntimeOptions &options,
+                               bc::StrictnessTable &strictness,
+                               DefinitionCallback definitionHandler,
+                               ExpressionCallback expressionHandler,
+                               const std::string &labelPrefix = "");
 
     /**
-     Returns all the import/repl defintions
+     Compiles chunks of the input on options.compileThreads threads
      */
-    std::vector<bc::Instruction> instructionsFromDefinitions();
+    static void traverseChunks(Lexer &lexer,
+                               const RuntimeOptions &options,
+                               bc::StrictnessTable &strictness,
+                               DefinitionCallback definitionHandler,
+                               ExpressionCallback expressionHandler,
+                               const std::string &labelPrefix);
 
-    struct FunctionContext {
-        std::vector<bc::Instruction> function;
-        std::vector<bc::Instruction> closures;
-    };
+    /**
+     Holds the library and every REPL definition. Definitions are appended as they are read,
+     an expression is appended, run and rolled back.
+     */
+    Interpreter mInterpreter;
+
+    // keeps the labels generated by each REPL evaluation apart
+    int mNumEvaluations=0;
+
+    RuntimeOptions mOptions;
 
-    std::map<std::string, FunctionContext> mReplDefinitions;
-    
-    std::vector<bc::Instruction> mImportDefintions;
+    bc::StrictnessTable mStrictness;
 };
@@ -0,0 +1,200 @@
+//  Strictness.cpp
+
+#include "Strictness.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+namespace bc {
+
+static std::set<std::string> setUnion(const std::set<std::string> &a, const std::set<std::string> &b)
+{
+    std::set<std::string> result(a);
+    result.insert(b.begin(), b.end());
+    return result;
+}
+
+static std::set<std::string> setIntersection(const std::set<std::string> &a, const std::set<std::string> &b)
+{
+    std::set<std::string> result;
+    std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::inserter(result, result.begin()));
+    return result;
+}
+
+StrictnessAnalyzer::StrictnessAnalyzer(const StrictnessTable &table)
+: mTable(table)
+{
+}
+
+void StrictnessAnalyzer::analyze(const std::vector<FunctionDecl*> &functions, StrictnessTable &table)
+{
+    // start by assuming every parameter is strict and weaken until nothing changes
+    for (auto function : functions) {
+        auto parameters = function->getFunctionBody()->getParameters();
+        table[std::string(function->getId())] = std::vector<bool>(parameters.size(), true);
+    }
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (auto function : functions) {
+            StrictnessAnalyzer analyzer(table);
+            std::set<std::string> forced = analyzer.forcedBy(function);
+
+            auto parameters = function->getFunctionBody()->getParameters();
+            std::vector<bool> strictness;
+            for (std::string_view parameter : parameters) {
+                strictness.push_back(forced.count(std::string(parameter)) > 0);
+            }
+
+            if (strictness != table[std::string(function->getId())]) {
+                table[std::string(function->getId())] = strictness;
+                changed = true;
+            }
+        }
+    }
+}
+
+bool StrictnessAnalyzer::isTrivial(Expression* expression)
+{
+    return dynamic_cast<IntExpression*>(expression) ||
+           dynamic_cast<StringExpression*>(expression) ||
+           dynamic_cast<Closure*>(expression);
+}
+
+std::set<std::string> StrictnessAnalyzer::forcedBy(Node* node)
+{
+    mForced.clear();
+    node->accept(this);
+    return mForced;
+}
+
+void StrictnessAnalyzer::visit(IntExpression* expression)
+{
+    mForced.clear();
+}
+
+void StrictnessAnalyzer::visit(StringExpression* expression)
+{
+    mForced.clear();
+}
+
+void StrictnessAnalyzer::visit(VariableExpression* expression)
+{
+    mForced.clear();
+    std::string name(expression->getVariableName());
+    if (mParameters.count(name) > 0) {
+        mForced.insert(name);
+    }
+}
+
+void StrictnessAnalyzer::visit(FunctionCallExpression* expression)
+{
+    std::vector<bool> calleeStrictness;
+
+    // only a global function has a known strictness, a parameter could be bound to anything
+    auto callee = dynamic_cast<VariableExpression*>(expression->getCallee());
+    std::string name = callee ? std::string(callee->getVariableName()) : std::string();
+    if (callee && mParameters.count(name) == 0 && mTable.count(name) > 0) {
+        calleeStrictness = mTable.at(name);
+    }
+
+    auto arguments = expression->getArguments();
+    bool knownCallee = calleeStrictness.size() == arguments.size();
+
+    std::set<std::string> forced = forcedBy(expression->getCallee());
+    for (int i = 0; i < arguments.size(); i++) {
+        // unknown callees get their arguments eagerly, the rest are delayed or passed on unforced unless strict
+        if (knownCallee == false || calleeStrictness[i]) {
+            forced = setUnion(forced, forcedBy(arguments[i]));
+        }
+    }
+    mForced = forced;
+}
+
+void StrictnessAnalyzer::visit(BinaryExpression* expression)
+{
+    std::set<std::string> left = forcedBy(expression->getLeft());
+    mForced = setUnion(left, forcedBy(expression->getRight()));
+}
+
+void StrictnessAnalyzer::visit(ListExpression* expression)
+{
+    std::set<std::string> forced;
+    for (auto element : expression->getElements()) {
+        forced = setUnion(forced, forcedBy(element));
+    }
+    mForced = forced;
+}
+
+void StrictnessAnalyzer::visit(NegateExpression* expression)
+{
+    expression->getExpression()->accept(this);
+}
+
+void StrictnessAnalyzer::visit(NotExpression* expression)
+{
+    expression->getExpression()->accept(this);
+}
+
+void StrictnessAnalyzer::visit(TernaryExpresssion* expression)
+{
+    std::set<std::string> condition = forcedBy(expression->getConditionalExpression());
+    std::set<std::string> trueBranch = forcedBy(expression->getTrueExpression());
+    std::set<std::string> falseBranch = forcedBy(expression->getFalseExpression());
+    mForced = setUnion(condition, setIntersection(trueBranch, falseBranch));
+}
+
+void StrictnessAnalyzer::visit(FunctionDecl* function)
+{
+    function->getFunctionBody()->accept(this);
+}
+
+void StrictnessAnalyzer::visit(FunctionBody* functionBody)
+{
+    auto parameters = functionBody->getParameters();
+    mParameters = std::set<std::string>(parameters.begin(), parameters.end());
+
+    // guards are tried in order, so work backwards from the default expression:
+    // forced(guard i) = forced(condition i) + (forced(body i) * forced(rest))
+    std::set<std::string> forced = forcedBy(functionBody->getDefaultExpression());
+
+    auto guards = functionBody->getGuards();
+    for (int i = (int)guards.size() - 1; i >= 0; i--) {
+        std::set<std::string> condition = forcedBy(guards[i]->getGuardExpression());
+        std::set<std::string> body = forcedBy(guards[i]->getBodyExpression());
+        forced = setUnion(condition, setIntersection(body, forced));
+    }
+    mForced = forced;
+}
+
+void StrictnessAnalyzer::visit(Closure* closure)
+{
+    // the body runs whenever the closure is called, which may be never
+    mForced.clear();
+}
+
+void StrictnessAnalyzer::visit(Guard* guard)
+{
+    JC_FAIL();
+}
+
+void StrictnessAnalyzer::visit(IndexExpression* expression)
+{
+    std::set<std::string> callee = forcedBy(expression->getCallee());
+    mForced = setUnion(callee, forcedBy(expression->getIndex()));
+}
+
+void StrictnessAnalyzer::visit(SliceExpression* expression)
+{
+    std::set<std::string> forced = forcedBy(expression->getCallee());
+    if (expression->getIndex1()) {
+        forced = setUnion(forced, forcedBy(expression->getIndex1()));
+    }
+    if (expression->getIndex2()) {
+        forced = setUnion(forced, forcedBy(expression->getIndex2()));
+    }
+    mForced = forced;
+}
+
+}
@@ -0,0 +1,67 @@
+//  Strictness.hpp
+
+#pragma once
+
+#include "Visitor.h"
+#include "ast.hpp"
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace bc {
+
+/**
+ Function name -> for each parameter, whether the function always forces it.
+ */
+using StrictnessTable = std::map<std::string, std::vector<bool>>;
+
+/**
+ Computes which parameters a function evaluates on every path through its body.
+ Arguments bound to strict parameters can be evaluated eagerly in lazy mode
+ without changing the meaning of the program.
+ */
+class StrictnessAnalyzer : public Visitor {
+public:
+    /**
+     Adds the strictness of the given functions to the table. Functions already in the
+     table are treated as known, recursive groups are solved by iterating to a fixpoint.
+     */
+    static void analyze(const std::vector<FunctionDecl*> &functions, StrictnessTable &table);
+
+    /**
+     Returns true if the expression is a literal, cheap enough that delaying it would cost more than evaluating it.
+     */
+    static bool isTrivial(Expression* expression);
+
+    void visit(IntExpression* expression) override;
+    void visit(StringExpression* expression) override;
+    void visit(VariableExpression* expression) override;
+    void visit(FunctionCallExpression* expression) override;
+    void visit(BinaryExpression* expression) override;
+    void visit(ListExpression* expression) override;
+    void visit(NegateExpression* expression) override;
+    void visit(NotExpression* expression) override;
+    void visit(TernaryExpresssion* expression) override;
+    void visit(FunctionDecl* expression) override;
+    void visit(FunctionBody* expression) override;
+    void visit(Closure* expression) override;
+    void visit(Guard* expression) override;
+    void visit(IndexExpression* expression) override;
+    void visit(SliceExpression* expression) override;
+
+private:
+    StrictnessAnalyzer(const StrictnessTable &table);
+
+    /**
+     Returns the parameters that are forced whenever the node is evaluated
+     */
+    std::set<std::string> forcedBy(Node* node);
+
+    const StrictnessTable &mTable;
+    std::set<std::string> mParameters;
+    std::set<std::string> mForced;
+};
+
+}
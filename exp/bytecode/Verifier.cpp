@@ -0,0 +1,223 @@
+//  Verifier.cpp
+
+#include "Verifier.hpp"
+#include "jcString.hpp"
+
+#include <map>
+#include <set>
+
+namespace bc {
+
+static bool isLabelOperand(const Instruction &instruction)
+{
+    jcVariablePtr operand = instruction.getOperand();
+    return operand && operand->getType() == jcVariable::TypeString &&
+           operand->asJcStringRaw()->getContext() == jcString::StringContextId;
+}
+
+static bool hasWellFormedOperands(const Instruction &instruction)
+{
+    jcVariablePtr operand = instruction.getOperand();
+    switch (genericOp(instruction.getOp())) {
+        case bc::Push:
+            return operand && operand->getType() != jcVariable::TypeClosure && operand->getType() != jcVariable::TypeThunk;
+        case bc::PushC:
+            return isLabelOperand(instruction) && instruction.getArgument() >= 0;
+        case bc::PushFree:
+            return operand && operand->getType() == jcVariable::TypeInt && operand->asInt() >= 0;
+        case bc::Pop:
+        case bc::Label:
+        case bc::Jmp:
+        case bc::JmpTrue:
+            return isLabelOperand(instruction);
+        case bc::Call:
+            return operand == nullptr && instruction.getArgument() >= 0;
+        default:
+            return operand == nullptr;
+    }
+}
+
+int Verifier::stackEffect(const Instruction &instruction, int *pops)
+{
+    int popped = 0;
+    int pushed = 0;
+    switch (genericOp(instruction.getOp())) {
+        case bc::Push:
+        case bc::PushFree:
+            pushed = 1;
+            break;
+        case bc::PushC:
+            popped = instruction.getArgument();
+            pushed = 1;
+            break;
+        case bc::Pop:
+        case bc::JmpTrue:
+        case bc::Exit:
+            popped = 1;
+            break;
+        case bc::Neg:
+        case bc::Not:
+        case bc::Thunk:
+            popped = 1;
+            pushed = 1;
+            break;
+        case bc::Add:
+        case bc::Subtract:
+        case bc::Multiply:
+        case bc::Divide:
+        case bc::Less_Than:
+        case bc::Greater_Than:
+        case bc::Less_Than_Equal:
+        case bc::Greater_Than_Equal:
+        case bc::Equals:
+        case bc::Cons:
+        case bc::Concat:
+        case bc::Index:
+            popped = 2;
+            pushed = 1;
+            break;
+        case bc::Slice:
+            popped = 3;
+            pushed = 1;
+            break;
+        case bc::Call:
+            // the callee and its arguments are replaced with the return value
+            popped = instruction.getArgument() + 1;
+            pushed = 1;
+            break;
+        case bc::Label:
+        case bc::Jmp:
+        case bc::Ret:
+        default:
+            break;
+    }
+    if (pops) {
+        *pops = popped;
+    }
+    return pushed - popped;
+}
+
+bool Verifier::verify(const std::vector<Instruction> &instructions, std::string *error)
+{
+    auto fail = [error](const std::string &message, int ip) {
+        if (error) {
+            *error = message + " at " + std::to_string(ip);
+        }
+        return false;
+    };
+
+    std::map<std::string, int> labels;
+    std::set<std::string> jumpTargets;
+
+    for (int ip = 0; ip < instructions.size(); ip++) {
+        const Instruction &instruction = instructions[ip];
+        if (hasWellFormedOperands(instruction) == false) {
+            return fail("malformed operands", ip);
+        }
+
+        if (instruction.getOp() == bc::Label) {
+            if (labels.count(instruction.getOperand()->asString()) > 0) {
+                return fail("duplicate label " + instruction.getOperand()->asString(), ip);
+            }
+            labels[instruction.getOperand()->asString()] = ip;
+        } else if (instruction.getOp() == bc::Jmp || instruction.getOp() == bc::JmpTrue) {
+            jumpTargets.insert(instruction.getOperand()->asString());
+        }
+    }
+
+    for (auto &instruction : instructions) {
+        bool hasTarget = instruction.getOp() == bc::Jmp || instruction.getOp() == bc::JmpTrue || instruction.getOp() == bc::PushC;
+        if (hasTarget && labels.count(instruction.getOperand()->asString()) == 0) {
+            return fail("missing label " + instruction.getOperand()->asString(), 0);
+        }
+    }
+
+    // every region is entered either at the top of the image or at a label nobody jumps to
+    struct Region {
+        int entry;
+        int arity;
+    };
+
+    std::vector<Region> regions;
+    bool startsWithFunction = instructions.size() &&
+                              instructions[0].getOp() == bc::Label &&
+                              jumpTargets.count(instructions[0].getOperand()->asString()) == 0;
+    if (startsWithFunction == false) {
+        regions.push_back({ 0, 0 });
+    }
+
+    for (auto &pair : labels) {
+        if (jumpTargets.count(pair.first) == 0) {
+            int arity = 0;
+            for (int ip = pair.second + 1; ip < instructions.size() && instructions[ip].getOp() == bc::Pop; ip++) {
+                arity++;
+            }
+            regions.push_back({ pair.second, arity });
+        }
+    }
+
+    // depth relative to the entry of the region, the caller's arguments sit below zero
+    std::vector<int> depths(instructions.size(), INT32_MIN);
+    std::vector<int> owners(instructions.size(), -1);
+
+    for (int regionIdx = 0; regionIdx < regions.size(); regionIdx++) {
+        Region region = regions[regionIdx];
+        if (region.entry >= instructions.size()) {
+            continue;
+        }
+
+        std::vector<std::pair<int, int>> worklist = { { region.entry, 0 } };
+        while (worklist.size()) {
+            int ip = worklist.back().first;
+            int depth = worklist.back().second;
+            worklist.pop_back();
+
+            if (ip >= instructions.size()) {
+                return fail("falls off the end of the image", ip);
+            }
+
+            if (owners[ip] != -1) {
+                if (owners[ip] != regionIdx) {
+                    return fail("falls into another function", ip);
+                }
+                if (depths[ip] != depth) {
+                    return fail("inconsistent stack depth", ip);
+                }
+                continue;
+            }
+            owners[ip] = regionIdx;
+            depths[ip] = depth;
+
+            const Instruction &instruction = instructions[ip];
+
+            int pops = 0;
+            int effect = stackEffect(instruction, &pops);
+            if (depth - pops < -region.arity) {
+                return fail("stack underflow", ip);
+            }
+
+            switch (instruction.getOp()) {
+                case bc::Ret:
+                    if (depth != 1 - region.arity) {
+                        return fail("unbalanced stack at return", ip);
+                    }
+                    break;
+                case bc::Exit:
+                    break;
+                case bc::Jmp:
+                    worklist.push_back({ labels[instruction.getOperand()->asString()], depth });
+                    break;
+                case bc::JmpTrue:
+                    worklist.push_back({ labels[instruction.getOperand()->asString()], depth + effect });
+                    worklist.push_back({ ip + 1, depth + effect });
+                    break;
+                default:
+                    worklist.push_back({ ip + 1, depth + effect });
+                    break;
+            }
+        }
+    }
+    return true;
+}
+
+}
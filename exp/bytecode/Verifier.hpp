@@ -0,0 +1,34 @@
+//  Verifier.hpp
+
+#pragma once
+
+#include "bc.hpp"
+
+#include <string>
+#include <vector>
+
+namespace bc {
+
+/**
+ Checks a linked instruction image once so the interpreter can skip its per-instruction checks.
+
+ A verified image has:
+    - well formed operands for every instruction
+    - unique labels and jump/closure targets that exist
+    - a consistent stack depth at every instruction, no pops below what a function was called with,
+      exactly one value left on a function's stack frame at Ret, and at least one at Exit
+ */
+class Verifier {
+public:
+    /**
+     Returns true if the image is safe to run unchecked. On failure the reason is written to error.
+     */
+    static bool verify(const std::vector<Instruction> &instructions, std::string *error = nullptr);
+
+    /**
+     Returns how many values the instruction pops off and pushes onto the argument stack
+     */
+    static int stackEffect(const Instruction &instruction, int *pops);
+};
+
+}
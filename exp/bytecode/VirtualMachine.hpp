@@ -0,0 +1,78 @@
+//  VirtualMachine.hpp
+
+#pragma once
+
+#include <vector>
+
+#include "jc.h"
+
+/**
+ A predicate of one parameter x that computes x op value for an int value fixed when it is matched
+ */
+struct IntComparison {
+    enum Op {
+        LessThan,
+        LessThanEqual,
+        GreaterThan,
+        GreaterThanEqual,
+        Equals,
+    };
+
+    Op op;
+    int value;
+
+    inline bool test(int x) const
+    {
+        switch (op) {
+            case LessThan:
+                return x < value;
+            case LessThanEqual:
+                return x <= value;
+            case GreaterThan:
+                return x > value;
+            case GreaterThanEqual:
+                return x >= value;
+            case Equals:
+                return x == value;
+        }
+        return false;
+    }
+};
+
+/**
+ What library functions need from whichever engine is running them.
+ */
+class VirtualMachine {
+public:
+    virtual ~VirtualMachine() {}
+
+    /**
+     Pops the next argument of the library function being called
+     */
+    virtual jcVariablePtr popStack() = 0;
+
+    /**
+     Calls the function within the callable object
+     and returns its result, args are given in parameter order
+     */
+    virtual jcVariablePtr interpret(jcVariablePtr callableObject, std::vector<jcVariablePtr> args = {}) = 0;
+
+    /**
+     Calls the function from the library function that is running and returns its result, args are given in parameter order.
+     Meant for library functions calling a function argument once per element, engines run it on the caller's stack.
+     */
+    virtual jcVariablePtr apply(const jcVariablePtr &function, const jcVariablePtr *args, size_t numArgs)
+    {
+        return interpret(function, std::vector<jcVariablePtr>(args, args + numArgs));
+    }
+
+    /**
+     Returns true if calling the callable object with an int x is the same as comparison.test(x),
+     e.g. {(x) = x < pivot}, so library functions can compare ints without calling it.
+     Engines that do not look into their functions never match.
+     */
+    virtual bool matchIntComparison(const jcVariablePtr &callableObject, IntComparison &comparison)
+    {
+        return false;
+    }
+};
@@ -1,9 +1,11 @@
 //  bc.cpp
 
 #include "bc.hpp"
+#include "FreeVariables.hpp"
 #include "jc.h"
 #include "builtin.hpp"
 #include "jcList.hpp"
+#include "jcString.hpp"
 
 #include <algorithm>
 #include <string>
@@ -49,6 +51,24 @@ static std::string opToString(bc::Op op)
         return "Label";
     case bc::PushC:
         return "PushC";
+    case bc::PushFree:
+        return "PushFree";
+    case bc::Thunk:
+        return "Thunk";
+    case bc::PushInt:
+        return "PushInt";
+    case bc::PushConst:
+        return "PushConst";
+    case bc::PushLocal:
+        return "PushLocal";
+    case bc::PushFunction:
+        return "PushFunction";
+    case bc::IndexList:
+        return "IndexList";
+    case bc::IndexString:
+        return "IndexString";
+    case bc::EqualsInt:
+        return "EqualsInt";
     default:
         JC_FAIL();
         break;
@@ -56,12 +76,37 @@ static std::string opToString(bc::Op op)
     return "";
 }
 
+bc::Op genericOp(bc::Op op)
+{
+    switch (op) {
+    case bc::PushInt:
+    case bc::PushConst:
+    case bc::PushLocal:
+    case bc::PushFunction:
+        return bc::Push;
+    case bc::IndexList:
+    case bc::IndexString:
+        return bc::Index;
+    case bc::EqualsInt:
+        return bc::Equals;
+    default:
+        return op;
+    }
+}
+
 Instruction::Instruction(bc::Op op, const jcVariablePtr &operands)
     : mOp(op)
     , mOperand(operands)
 {
 }
 
+Instruction::Instruction(bc::Op op, const jcVariablePtr &operand, int argument)
+    : mOp(op)
+    , mOperand(operand)
+    , mArgument(argument)
+{
+}
+
 Instruction::Instruction(bc::Op op)
     : mOp(op)
 {
@@ -77,6 +122,11 @@ jcVariablePtr Instruction::getOperand() const
     return mOperand;
 }
 
+int Instruction::getArgument() const
+{
+    return mArgument;
+}
+
 bc::Op Instruction::getOp() const
 {
     return mOp;
@@ -97,6 +147,10 @@ std::string Instruction::toString() const
             output += mOperand->asString();
         }
     }
+
+    if (mOp == bc::PushC || mOp == bc::Call) {
+        output += " " + std::to_string(mArgument);
+    }
     return output;
 }
 
@@ -104,11 +158,22 @@ Generator::Generator()
 {
 }
 
-std::vector<Instruction> Generator::getInstructions(std::shared_ptr<Node> root)
+void Generator::setLabelPrefix(const std::string &prefix)
+{
+    mLabelPrefix = prefix;
+}
+
+void Generator::setLazy(const StrictnessTable *strictness)
+{
+    mStrictness = strictness;
+}
+
+std::vector<Instruction> Generator::getInstructions(Node* root)
 {
     mOutput.clear();
     mClosures.clear();
     mScope.clear();
+    mCaptureSlots.clear();
     root->accept(this);
     return mOutput;
 }
@@ -117,34 +182,43 @@ std::vector<Instruction> Generator::getClosureInstructions()
 {
     mOutput.clear();
     generateClosures();
+    mThunks.clear();
     return mOutput;
 }
 
 void Generator::generateClosures()
 {
+    // closures generated here may add more closures to the end of mClosures
     for (int i = 0; i < mClosures.size(); i++) {
-        Closure *closure = mClosures[i].first;
-        std::set<std::string> scope = mClosures[i].second;
-
-        std::string label = closureLabel(i);
-        mCurrentFunctionLabel = label;
-        mOutput.push_back(Instruction(bc::Label, jcVariable::Create(label)));
-
-        // push the current scope into the closure
-        for (auto it = scope.rbegin(); it != scope.rend(); ++it) {
-            std::string var = *it;
-            jcVariablePtr paramVar = jcVariable::Create(var);
-            Instruction popOp = Instruction(bc::Pop, paramVar);
-            mOutput.push_back(popOp);
+        PendingClosure pending = mClosures[i];
+
+        mCurrentFunctionLabel = pending.label;
+        mOutput.push_back(Instruction(bc::Label, jcVariable::Create(pending.label)));
+
+        // captured values are read out of the closure by slot, they are never bound into the frame
+        mScope = std::set<std::string>(pending.captures.begin(), pending.captures.end());
+        mCaptureSlots.clear();
+        for (int slot = 0; slot < pending.captures.size(); slot++) {
+            mCaptureSlots[pending.captures[slot]] = slot;
         }
 
-        closure->getBody()->accept(this);
+        pending.closure->getBody()->accept(this);
+    }
+    mCaptureSlots.clear();
+}
+
+void Generator::generateVariable(const std::string &name, int argument)
+{
+    if (mCaptureSlots.count(name) > 0) {
+        mOutput.push_back(Instruction(bc::PushFree, jcVariable::Create(mCaptureSlots[name]), argument));
+    } else {
+        mOutput.push_back(Instruction(bc::Push, jcVariable::Create(name), argument));
     }
 }
 
 std::string Generator::closureLabel(int idx) const
 {
-    return std::string("c.") + std::to_string(idx);
+    return mLabelPrefix + "c." + std::to_string(idx);
 }
 
 /**
@@ -152,8 +226,7 @@ std::string Generator::closureLabel(int idx) const
  */
 std::string Generator::labelMaker()
 {
-    static int numLabels = 0;
-    return std::string(".") + std::to_string(numLabels++);
+    return mLabelPrefix + "." + std::to_string(mNumLabels++);
 }
 
 void Generator::visit(FunctionBody* functionBody)
@@ -162,7 +235,8 @@ void Generator::visit(FunctionBody* functionBody)
 
     std::string functionName = mCurrentFunctionLabel;
 
-    for (std::string param : functionBody->getParameters()) {
+    for (std::string_view parameter : functionBody->getParameters()) {
+        std::string param(parameter);
         jcVariablePtr paramVar = jcVariable::Create(param);
         Instruction popOp = Instruction(bc::Pop, paramVar);
         mOutput.push_back(popOp);
@@ -176,7 +250,7 @@ void Generator::visit(FunctionBody* functionBody)
 
         // do guard expressions
         for (int i = 0; i < functionBody->getGuards().size(); i++) {
-            std::shared_ptr<Guard> guard = functionBody->getGuards()[i];
+            Guard* guard = functionBody->getGuards()[i];
             guard->getGuardExpression()->accept(this);
 
             std::string label = labelMaker();
@@ -193,7 +267,7 @@ void Generator::visit(FunctionBody* functionBody)
         // now do the guard bodies
 
         for (int i = 0; i < functionBody->getGuards().size(); i++) {
-            std::shared_ptr<Guard> guard = functionBody->getGuards()[i];
+            Guard* guard = functionBody->getGuards()[i];
             std::string label = labels[i];
 
             mOutput.push_back(Instruction(bc::Label, jcVariable::Create(label)));
@@ -219,13 +293,23 @@ void Generator::visit(Closure* closure)
 {
     std::string closureName = closureLabel(mNumClosures++);
 
-    mOutput.push_back(Instruction(bc::PushC, jcVariable::Create(closureName)));
+    // only capture the variables the body references, anything else is a global function
+    std::vector<std::string> captures;
+    for (std::string name : FreeVariableAnalyzer::freeVariables(closure)) {
+        if (mScope.count(name) > 0) {
+            captures.push_back(name);
+        }
+    }
 
+    // push the captured values in slot order, PushC pops them into the closure.
+    // Capturing a lazy argument does not force it, the closure body does when it reads it.
+    for (std::string name : captures) {
+        generateVariable(name, mStrictness ? kKeepThunk : 0);
+    }
+
+    mOutput.push_back(Instruction(bc::PushC, jcVariable::Create(closureName), (int)captures.size()));
 
-    // NEED TO PUSH WHAT IS IN SCOPE SO WE KNOW WHAT WE HAVE IN SCOPE..., NEED TO ADD A PUSHC INSTRUCTION THAT CAN PUSH
-    // A CLOSURE OBJECT. THE CLOSURE OBJECT WILL HOLD A COPY OF THE ITEMS IN SCOPE. WHEN IT IS CALLED IT WILL PUSH THOSE
-    // ITEMS ONTO THE STACK... AHHHHH THIS IS WHAT NEEDS TO HAPPEN FOR THIS TO WORK>>>
-    mClosures.push_back(std::make_pair(closure, std::set<std::string>(mScope)));
+    mClosures.push_back({closure, closureName, captures});
 }
 
 void Generator::visit(NegateExpression* expression)
@@ -266,8 +350,9 @@ void Generator::visit(FunctionDecl* function)
 {
     // new function new scope..
     mScope.clear();
+    mCaptureSlots.clear();
 
-    std::string functionName = function->getId();
+    std::string functionName(function->getId());
 
     Instruction functionLabel = Instruction(bc::Label, jcVariable::Create(functionName));
     mOutput.push_back(functionLabel);
@@ -286,9 +371,7 @@ void Generator::visit(Guard* guard)
 
 void Generator::visit(VariableExpression* expression)
 {
-    jcVariablePtr varId = jcVariable::Create(expression->getVariableName());
-    Instruction pushOp = Instruction(bc::Push, varId);
-    mOutput.push_back(pushOp);
+    generateVariable(std::string(expression->getVariableName()));
 }
 
 void Generator::visit(IntExpression* expression)
@@ -300,7 +383,8 @@ void Generator::visit(IntExpression* expression)
 
 void Generator::visit(StringExpression* expression)
 {
-    jcVariablePtr string = jcVariable::Create(expression->getValue());
+    jcStringPtr value = jcString::Create(std::string(expression->getValue()), jcString::StringContextValue);
+    jcVariablePtr string = jcVariable::Create(value);
     Instruction pushOp = Instruction(bc::Push, string);
     mOutput.push_back(pushOp);
 }
@@ -318,16 +402,64 @@ void Generator::visit(ListExpression* list)
     }
 }
 
+void Generator::generateThunk(Expression* expression)
+{
+    auto body = mThunks.make<FunctionBody>(expression, Span<std::string_view>(), Span<Guard*>());
+    auto closure = mThunks.make<Closure>(body);
+
+    visit(closure);
+    mOutput.push_back(Instruction(bc::Thunk));
+}
+
+/**
+ Returns the strictness of the called function, empty if it cannot be known at compile time.
+ */
+std::vector<bool> Generator::calleeStrictness(FunctionCallExpression* expression)
+{
+    if (mStrictness == nullptr) {
+        return {};
+    }
+
+    auto callee = dynamic_cast<VariableExpression*>(expression->getCallee());
+    if (callee == nullptr) {
+        return {};
+    }
+
+    // locals may shadow the global function
+    std::string name(callee->getVariableName());
+    if (mScope.count(name) > 0 || mCaptureSlots.count(name) > 0 || mStrictness->count(name) == 0) {
+        return {};
+    }
+
+    std::vector<bool> strictness = mStrictness->at(name);
+    if (strictness.size() != expression->getArguments().size()) {
+        return {};
+    }
+    return strictness;
+}
+
 void Generator::visit(FunctionCallExpression* expression)
 {
     auto arguments = expression->getArguments();
-    std::reverse(std::begin(arguments), std::end(arguments));
-    for (auto arg : arguments) {
-        arg->accept(this);
+    std::vector<bool> strictness = calleeStrictness(expression);
+
+    for (int i = (int)arguments.size() - 1; i >= 0; i--) {
+        bool lazy = strictness.size() && strictness[i] == false;
+        auto variable = dynamic_cast<VariableExpression*>(arguments[i]);
+        std::string name = variable ? std::string(variable->getVariableName()) : std::string();
+
+        if (lazy && variable && (mScope.count(name) > 0 || mCaptureSlots.count(name) > 0)) {
+            // a local is passed on as it is bound, delayed arguments stay delayed
+            generateVariable(name, kKeepThunk);
+        } else if (lazy && StrictnessAnalyzer::isTrivial(arguments[i]) == false) {
+            generateThunk(arguments[i]);
+        } else {
+            arguments[i]->accept(this);
+        }
     }
 
     expression->getCallee()->accept(this);
-    mOutput.push_back(Instruction(bc::Call));
+    mOutput.push_back(Instruction(bc::Call, nullptr, (int)arguments.size()));
 }
 
 void Generator::visit(IndexExpression* expression)
@@ -340,7 +472,7 @@ void Generator::visit(IndexExpression* expression)
 
 void Generator::visit(SliceExpression* expression)
 {
-    auto pushIndex = [this](std::shared_ptr<Expression> expression){
+    auto pushIndex = [this](Expression* expression){
         if (expression) {
             expression->accept(this);
         } else {
@@ -2,12 +2,14 @@
 
 #pragma once
 
+#include "Strictness.hpp"
 #include "Visitor.h"
 #include "ast.hpp"
 #include "jcVariable.hpp"
 
 #include <stack>
 #include <vector>
+#include <map>
 #include <set>
 #include <utility>
 
@@ -17,11 +19,14 @@ namespace bc {
 enum Op {
     /**
      Pushes a value to the argument stack
+        - argument - kKeepThunk passes a thunk bound to the variable on unforced
      */
     Push = 0,
 
     /**
      Push a closure
+        - operand - the closure label
+        - argument - number of captured values to pop off the argument stack
      */
     PushC = 1,
 
@@ -138,18 +143,89 @@ enum Op {
      Returns a slice of the collection
      */
     Slice = 23,
+
+    /**
+     Pushes a value captured by the running closure
+        - operand - the capture slot
+        - argument - kKeepThunk passes a captured thunk on unforced
+     */
+    PushFree = 24,
+
+    /**
+     Wraps the closure on the top of the stack in a memoized thunk
+     */
+    Thunk = 25,
+
+    /**
+     Quickened forms. The generator never emits these, the interpreter rewrites a generic
+     word of its image into one of them after it first runs, and back if its guard fails.
+     */
+
+    /**
+     Push with an int literal operand
+     */
+    PushInt = 26,
+
+    /**
+     Push with a non-int literal operand (string value, char or list)
+     */
+    PushConst = 27,
+
+    /**
+     Push of a variable bound in the current frame
+        - guard: the name is still bound in the frame
+     */
+    PushLocal = 28,
+
+    /**
+     Push of a function name
+        - guard: the name is not shadowed by a variable in the frame
+     */
+    PushFunction = 29,
+
+    /**
+     Index into a list
+        - guard: the collection is a list and the index an int
+     */
+    IndexList = 30,
+
+    /**
+     Index into a string
+        - guard: the collection is a string and the index an int
+     */
+    IndexString = 31,
+
+    /**
+     Equality of two ints
+        - guard: both operands are ints
+     */
+    EqualsInt = 32,
 };
 
+/**
+ Argument of a Push or PushFree that only passes the variable on, to a lazy parameter or a closure
+ capture. Thunks are forced where their value is used, not where they are passed.
+ */
+const int kKeepThunk = 1;
+
+/**
+ Returns the generic op a quickened op was specialized from, other ops are returned as is.
+ */
+bc::Op genericOp(bc::Op op);
+
 
 class Instruction {
 public:
     explicit Instruction(bc::Op op, const jcVariablePtr &operand);
+    Instruction(bc::Op op, const jcVariablePtr &operand, int argument);
     Instruction(bc::Op op);
 
     int numOperands() const;
 
     jcVariablePtr getOperand() const;
 
+    int getArgument() const;
+
     bc::Op getOp() const;
 
     std::string toString() const;
@@ -157,6 +233,7 @@ public:
 private:
     bc::Op mOp;
     jcVariablePtr mOperand;
+    int mArgument=0;
 };
 
 /**
@@ -166,7 +243,19 @@ class Generator : public Visitor {
 public:
     Generator();
 
-    std::vector<Instruction> getInstructions(std::shared_ptr<Node> root);
+    /**
+     Enables call-by-need, arguments to non-strict parameters of known functions
+     are passed as thunks. The table must outlive the generator.
+     */
+    void setLazy(const StrictnessTable *strictness);
+
+    /**
+     Prefixes the generated closure and jump labels, so code compiled separately
+     (e.g. the prebuilt standard library or another chunk of the same file) cannot clash with labels generated here.
+     */
+    void setLabelPrefix(const std::string &prefix);
+
+    std::vector<Instruction> getInstructions(Node* root);
     std::vector<Instruction> getClosureInstructions();
 
     void visit(IntExpression* expression) override;
@@ -200,17 +289,35 @@ public:
     void visit(SliceExpression* expression) override;
 
 private:
+    struct PendingClosure {
+        Closure *closure;
+        std::string label;
+        // captured variable names, indexed by slot
+        std::vector<std::string> captures;
+    };
+
     void generateClosures();
+    void generateVariable(const std::string &name, int argument=0);
+    void generateThunk(Expression* expression);
+    std::vector<bool> calleeStrictness(FunctionCallExpression* expression);
     std::string labelMaker();
     std::string closureLabel(int idx) const;
 private:
     std::vector<Instruction> mOutput;
     // closures to be generated at the end..
-    std::vector<std::pair<Closure *, std::set<std::string>>> mClosures;
+    std::vector<PendingClosure> mClosures;
     std::set<std::string> mScope;
+    // capture slots of the closure currently being generated
+    std::map<std::string, int> mCaptureSlots;
+    // synthesized closures for delayed arguments, kept alive until generated
+    Arena mThunks;
+    const StrictnessTable *mStrictness=nullptr;
     std::string mCurrentFunctionLabel;
+    std::string mLabelPrefix;
 
+    // numbered per generator, the prefix keeps generators apart
     int mNumClosures=0;
+    int mNumLabels=0;
 };
 
 }
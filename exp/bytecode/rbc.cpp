@@ -0,0 +1,446 @@
+//  rbc.cpp
+
+#include "rbc.hpp"
+#include "FreeVariables.hpp"
+#include "jcList.hpp"
+#include "jcString.hpp"
+
+#include <algorithm>
+
+namespace rbc {
+
+static std::string opToString(Op op)
+{
+    switch (op) {
+    case LoadConst:
+        return "LOADK";
+    case LoadFree:
+        return "LOADFREE";
+    case Move:
+        return "MOVE";
+    case Add:
+        return "ADD";
+    case Subtract:
+        return "SUB";
+    case Multiply:
+        return "MUL";
+    case Divide:
+        return "DIV";
+    case Less_Than:
+        return "LESS_THAN";
+    case Greater_Than:
+        return "GREATER_THAN";
+    case Less_Than_Equal:
+        return "LESS_THAN_EQUAL";
+    case Greater_Than_Equal:
+        return "GREATER_THAN_EQUAL";
+    case Equals:
+        return "EQUALS";
+    case Neg:
+        return "NEG";
+    case Not:
+        return "NOT";
+    case Cons:
+        return "CONS";
+    case Concat:
+        return "CONCAT";
+    case Index:
+        return "INDEX";
+    case Slice:
+        return "SLICE";
+    case MakeClosure:
+        return "CLOSURE";
+    case Call:
+        return "CALL";
+    case Jmp:
+        return "JMP";
+    case JmpTrue:
+        return "JMP_TRUE";
+    case Ret:
+        return "RET";
+    }
+    return "";
+}
+
+std::string Instruction::toString() const
+{
+    std::string output = opToString(op) + " " + std::to_string(a) + ", " + std::to_string(b) + ", " + std::to_string(c);
+    if (op == Call) {
+        output += ", " + std::to_string(d);
+    }
+    if (k) {
+        output += " " + k->stringRepresentation();
+    }
+    return output;
+}
+
+Generator::Generator(Module &module)
+: mModule(module)
+{
+}
+
+void Generator::generate(const std::vector<Node*> &nodes)
+{
+    std::vector<Expression*> expressions;
+    for (auto node : nodes) {
+        if (node->type() == kFunctionDeclType) {
+            node->accept(this);
+        } else {
+            expressions.push_back(static_cast<Expression*>(node));
+        }
+    }
+
+    if (expressions.size()) {
+        generateMain(expressions);
+    }
+
+    // closures generated here may add more closures to the end of mClosures
+    for (int i = 0; i < mClosures.size(); i++) {
+        PendingClosure pending = mClosures[i];
+        generateFunction(pending.label, pending.closure->getBody(), pending.captures);
+    }
+    mClosures.clear();
+}
+
+void Generator::beginFunction(const std::string &name, int numParameters)
+{
+    mFunction = Function();
+    mFunction.name = name;
+    mFunction.entry = (int)mModule.code.size();
+    mFunction.numParameters = numParameters;
+    mFunction.numRegisters = numParameters;
+
+    mLocals.clear();
+    mCaptureSlots.clear();
+    mNextRegister = numParameters;
+}
+
+void Generator::endFunction()
+{
+    mModule.functionIndex[mFunction.name] = (int)mModule.functions.size();
+    mModule.functions.push_back(mFunction);
+}
+
+void Generator::generateFunction(const std::string &name, FunctionBody *body, const std::vector<std::string> &captures)
+{
+    auto parameters = body->getParameters();
+    beginFunction(name, (int)parameters.size());
+
+    for (int i = 0; i < parameters.size(); i++) {
+        mLocals[std::string(parameters[i])] = i;
+    }
+    for (int slot = 0; slot < captures.size(); slot++) {
+        mCaptureSlots[captures[slot]] = slot;
+    }
+
+    body->accept(this);
+    endFunction();
+}
+
+void Generator::generateMain(const std::vector<Expression*> &expressions)
+{
+    beginFunction(kMainFunction, 0);
+
+    int result = 0;
+    for (auto expression : expressions) {
+        mNextRegister = 0;
+        result = generateExpression(expression);
+    }
+    emit(Ret, result);
+
+    endFunction();
+}
+
+int Generator::allocate()
+{
+    int reg = mNextRegister++;
+    mFunction.numRegisters = std::max(mFunction.numRegisters, mNextRegister);
+    return reg;
+}
+
+int Generator::emit(Op op, int a, int b, int c, int d, const jcVariablePtr &k)
+{
+    Instruction instruction;
+    instruction.op = op;
+    instruction.a = a;
+    instruction.b = b;
+    instruction.c = c;
+    instruction.d = d;
+    instruction.k = k;
+    mModule.code.push_back(instruction);
+    return (int)mModule.code.size() - 1;
+}
+
+void Generator::move(int destination, int source)
+{
+    if (destination != source) {
+        emit(Move, destination, source);
+    }
+}
+
+int Generator::generateExpression(Expression *expression)
+{
+    expression->accept(this);
+    return mResult;
+}
+
+void Generator::visit(FunctionDecl* function)
+{
+    generateFunction(std::string(function->getId()), function->getFunctionBody(), {});
+}
+
+void Generator::visit(FunctionBody* functionBody)
+{
+    // every guard body returns directly, so there is no shared end label
+    std::vector<int> jumps;
+    for (auto guard : functionBody->getGuards()) {
+        int mark = mNextRegister;
+        int condition = generateExpression(guard->getGuardExpression());
+        jumps.push_back(emit(JmpTrue, condition));
+        mNextRegister = mark;
+    }
+
+    int mark = mNextRegister;
+    emit(Ret, generateExpression(functionBody->getDefaultExpression()));
+
+    for (int i = 0; i < jumps.size(); i++) {
+        mModule.code[jumps[i]].b = (int)mModule.code.size();
+
+        mNextRegister = mark;
+        emit(Ret, generateExpression(functionBody->getGuards()[i]->getBodyExpression()));
+    }
+}
+
+void Generator::visit(Guard* guard)
+{
+    JC_FAIL();
+}
+
+void Generator::visit(Closure* closure)
+{
+    std::string label = "c." + std::to_string(mModule.numClosures++);
+
+    std::vector<std::string> captures;
+    for (std::string name : bc::FreeVariableAnalyzer::freeVariables(closure)) {
+        if (mLocals.count(name) > 0 || mCaptureSlots.count(name) > 0) {
+            captures.push_back(name);
+        }
+    }
+
+    int destination = allocate();
+    int base = mNextRegister;
+    for (int i = 0; i < captures.size(); i++) {
+        allocate();
+    }
+    for (int i = 0; i < captures.size(); i++) {
+        VariableExpression variable(captures[i]);
+        move(base + i, generateExpression(&variable));
+        mNextRegister = base + (int)captures.size();
+    }
+
+    emit(MakeClosure, destination, base, (int)captures.size(), 0, jcVariable::Create(label));
+    mClosures.push_back({closure, label, captures});
+
+    mNextRegister = destination + 1;
+    mResult = destination;
+}
+
+void Generator::visit(VariableExpression* expression)
+{
+    std::string name(expression->getVariableName());
+    if (mLocals.count(name) > 0) {
+        mResult = mLocals[name];
+    } else if (mCaptureSlots.count(name) > 0) {
+        mResult = allocate();
+        emit(LoadFree, mResult, mCaptureSlots[name]);
+    } else {
+        // a global function, called by name
+        mResult = allocate();
+        emit(LoadConst, mResult, 0, 0, 0, jcVariable::Create(name));
+    }
+}
+
+void Generator::visit(IntExpression* expression)
+{
+    mResult = allocate();
+    emit(LoadConst, mResult, 0, 0, 0, jcVariable::Create(expression->getValue()));
+}
+
+void Generator::visit(StringExpression* expression)
+{
+    mResult = allocate();
+    jcStringPtr value = jcString::Create(std::string(expression->getValue()), jcString::StringContextValue);
+    emit(LoadConst, mResult, 0, 0, 0, jcVariable::Create(value));
+}
+
+void Generator::visit(ListExpression* list)
+{
+    auto elements = list->getElements();
+
+    int destination = allocate();
+    int base = mNextRegister;
+    for (int i = 0; i < elements.size(); i++) {
+        allocate();
+    }
+    for (int i = 0; i < elements.size(); i++) {
+        move(base + i, generateExpression(elements[i]));
+        mNextRegister = base + (int)elements.size();
+    }
+
+    emit(LoadConst, destination, 0, 0, 0, jcVariable::Create(std::make_shared<jcList>()));
+    for (int i = (int)elements.size() - 1; i >= 0; i--) {
+        emit(Cons, destination, base + i, destination);
+    }
+
+    mNextRegister = destination + 1;
+    mResult = destination;
+}
+
+void Generator::visit(FunctionCallExpression* expression)
+{
+    auto arguments = expression->getArguments();
+
+    int destination = allocate();
+    int base = mNextRegister;
+    for (int i = 0; i < arguments.size(); i++) {
+        allocate();
+    }
+    // last argument first, like the stack machine pushes them
+    for (int i = (int)arguments.size() - 1; i >= 0; i--) {
+        move(base + i, generateExpression(arguments[i]));
+        mNextRegister = base + (int)arguments.size();
+    }
+
+    int callee = generateExpression(expression->getCallee());
+    emit(Call, destination, callee, base, (int)arguments.size());
+
+    mNextRegister = destination + 1;
+    mResult = destination;
+}
+
+void Generator::visit(NegateExpression* expression)
+{
+    int mark = mNextRegister;
+    int value = generateExpression(expression->getExpression());
+    mNextRegister = mark;
+    mResult = allocate();
+    emit(Neg, mResult, value);
+}
+
+void Generator::visit(NotExpression* expression)
+{
+    int mark = mNextRegister;
+    int value = generateExpression(expression->getExpression());
+    mNextRegister = mark;
+    mResult = allocate();
+    emit(Not, mResult, value);
+}
+
+void Generator::visit(TernaryExpresssion* expression)
+{
+    int destination = allocate();
+
+    int condition = generateExpression(expression->getConditionalExpression());
+    int trueJump = emit(JmpTrue, condition);
+    mNextRegister = destination + 1;
+
+    move(destination, generateExpression(expression->getFalseExpression()));
+    int endJump = emit(Jmp, 0);
+    mNextRegister = destination + 1;
+
+    mModule.code[trueJump].b = (int)mModule.code.size();
+    move(destination, generateExpression(expression->getTrueExpression()));
+    mModule.code[endJump].b = (int)mModule.code.size();
+
+    mNextRegister = destination + 1;
+    mResult = destination;
+}
+
+void Generator::visit(IndexExpression* expression)
+{
+    int mark = mNextRegister;
+    // the index is evaluated before the collection, as on the stack machine
+    int index = generateExpression(expression->getIndex());
+    int collection = generateExpression(expression->getCallee());
+
+    mNextRegister = mark;
+    mResult = allocate();
+    emit(Index, mResult, collection, index);
+}
+
+void Generator::visit(SliceExpression* expression)
+{
+    int destination = allocate();
+    int bounds = allocate();
+    allocate();
+
+    // the end before the start, as on the stack machine
+    Expression* indexes[] = { expression->getIndex1(), expression->getIndex2() };
+    for (int i = 1; i >= 0; i--) {
+        if (indexes[i]) {
+            move(bounds + i, generateExpression(indexes[i]));
+        } else {
+            emit(LoadConst, bounds + i, 0, 0, 0, jcVariable::Create(-1));
+        }
+        mNextRegister = bounds + 2;
+    }
+
+    int collection = generateExpression(expression->getCallee());
+    emit(Slice, destination, collection, bounds);
+
+    mNextRegister = destination + 1;
+    mResult = destination;
+}
+
+void Generator::visit(BinaryExpression* expression)
+{
+    int mark = mNextRegister;
+    int left = generateExpression(expression->getLeft());
+    int right = generateExpression(expression->getRight());
+
+    Op op;
+    switch (expression->getOperator()) {
+    case TokenType::Add:
+        op = Add;
+        break;
+    case TokenType::Multiply:
+        op = Multiply;
+        break;
+    case TokenType::Subtract:
+        op = Subtract;
+        break;
+    case TokenType::Divide:
+        op = Divide;
+        break;
+    case TokenType::Greater_Than:
+        op = Greater_Than;
+        break;
+    case TokenType::Less_Than:
+        op = Less_Than;
+        break;
+    case TokenType::Less_Than_Equal:
+        op = Less_Than_Equal;
+        break;
+    case TokenType::Greater_Than_Equal:
+        op = Greater_Than_Equal;
+        break;
+    case TokenType::Equals:
+        op = Equals;
+        break;
+    case TokenType::Cons:
+        op = Cons;
+        break;
+    case TokenType::Concat:
+        op = Concat;
+        break;
+    default:
+        JC_FAIL();
+        op = Add;
+    }
+
+    mNextRegister = mark;
+    mResult = allocate();
+    emit(op, mResult, left, right);
+}
+
+}
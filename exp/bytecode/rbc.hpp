@@ -0,0 +1,200 @@
+//  rbc.hpp
+
+#pragma once
+
+#include "Visitor.h"
+#include "ast.hpp"
+#include "jcVariable.hpp"
+
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// register based bytecode, an alternative to the stack machine in bc.hpp
+
+namespace rbc {
+
+/**
+ Name of the function holding the top level expressions of a module
+ */
+const std::string kMainFunction = ".main";
+
+enum Op {
+    /**
+     a = k
+     */
+    LoadConst = 0,
+
+    /**
+     a = capture slot b of the running closure
+     */
+    LoadFree = 1,
+
+    /**
+     a = b
+     */
+    Move = 2,
+
+    /**
+     a = b op c
+     */
+    Add = 3,
+    Subtract = 4,
+    Multiply = 5,
+    Divide = 6,
+    Less_Than = 7,
+    Greater_Than = 8,
+    Less_Than_Equal = 9,
+    Greater_Than_Equal = 10,
+    Equals = 11,
+
+    /**
+     a = op b
+     */
+    Neg = 12,
+    Not = 13,
+
+    /**
+     a = b :: c
+     */
+    Cons = 14,
+
+    /**
+     a = b ++ c
+     */
+    Concat = 15,
+
+    /**
+     a = b[c]
+     */
+    Index = 16,
+
+    /**
+     a = b[c:c+1], -1 in c or c+1 means the slice is open on that side
+     */
+    Slice = 17,
+
+    /**
+     a = closure k capturing registers b..b+c-1
+     */
+    MakeClosure = 18,
+
+    /**
+     a = b(c..c+d-1)
+     */
+    Call = 19,
+
+    /**
+     jump to b
+     */
+    Jmp = 20,
+
+    /**
+     jump to b if a is true
+     */
+    JmpTrue = 21,
+
+    /**
+     return a to the caller
+     */
+    Ret = 22,
+};
+
+struct Instruction {
+    Op op;
+    int a=0;
+    int b=0;
+    int c=0;
+    int d=0;
+
+    // constant operand
+    jcVariablePtr k;
+
+    std::string toString() const;
+};
+
+struct Function {
+    std::string name;
+    int entry=0;
+    int numParameters=0;
+    int numRegisters=0;
+};
+
+/**
+ A linked program: every function's code in one instruction stream
+ */
+struct Module {
+    std::vector<Instruction> code;
+    std::vector<Function> functions;
+
+    // later definitions replace earlier ones with the same name
+    std::unordered_map<std::string, int> functionIndex;
+
+    // keeps closure labels unique across generators adding to the module
+    int numClosures=0;
+};
+
+/**
+ Walks through the AST and generates register bytecode.
+ Parameters live in registers 0..n-1 of their frame, so variables are resolved at compile time.
+ */
+class Generator : public Visitor {
+public:
+    Generator(Module &module);
+
+    /**
+     Adds the definitions to the module, top level expressions are collected into kMainFunction.
+     */
+    void generate(const std::vector<Node*> &nodes);
+
+    void visit(IntExpression* expression) override;
+    void visit(StringExpression* expression) override;
+    void visit(VariableExpression* expression) override;
+    void visit(FunctionCallExpression* expression) override;
+    void visit(BinaryExpression* expression) override;
+    void visit(ListExpression* expression) override;
+    void visit(NegateExpression* expression) override;
+    void visit(NotExpression* expression) override;
+    void visit(TernaryExpresssion* expression) override;
+    void visit(FunctionDecl* expression) override;
+    void visit(FunctionBody* expression) override;
+    void visit(Closure* expression) override;
+    void visit(Guard* expression) override;
+    void visit(IndexExpression* expression) override;
+    void visit(SliceExpression* expression) override;
+
+private:
+    struct PendingClosure {
+        Closure *closure;
+        std::string label;
+        std::vector<std::string> captures;
+    };
+
+    void generateFunction(const std::string &name, FunctionBody *body, const std::vector<std::string> &captures);
+    void generateMain(const std::vector<Expression*> &expressions);
+    void beginFunction(const std::string &name, int numParameters);
+    void endFunction();
+
+    /**
+     Evaluates the expression and returns the register holding its value
+     */
+    int generateExpression(Expression *expression);
+
+    int allocate();
+    int emit(Op op, int a, int b = 0, int c = 0, int d = 0, const jcVariablePtr &k = nullptr);
+    void move(int destination, int source);
+
+private:
+    Module &mModule;
+    Function mFunction;
+
+    std::map<std::string, int> mLocals;
+    std::map<std::string, int> mCaptureSlots;
+    std::vector<PendingClosure> mClosures;
+
+    int mNextRegister=0;
+    int mResult=0;
+};
+
+}
@@ -4,7 +4,9 @@
 #include "jcArray.hpp"
 #include "jcClosure.hpp"
 #include "jcList.hpp"
+#include "kernels.hpp"
 
+#include <algorithm>
 #include <functional>
 #include <iostream>
 
@@ -32,14 +34,326 @@ std::unordered_map<std::string, std::map<std::string, jcVariablePtr>> builtin::m
             {kLibParameterNumber, jcVariable::Create(1)},
             {kLibReturnType, jcVariable::Create(jcVariable::TypeInt)}
         }
+    },
+    {
+        kLibHead,
+        {
+            {kLibParameterNumber, jcVariable::Create(1)},
+            {kLibReturnType, jcVariable::Create(jcVariable::TypeNone)}
+        }
+    },
+    {
+        kLibTail,
+        {
+            {kLibParameterNumber, jcVariable::Create(1)},
+            {kLibReturnType, jcVariable::Create(jcVariable::TypeNone)}
+        }
+    },
+    {
+        kLibRange,
+        {
+            {kLibParameterNumber, jcVariable::Create(2)},
+            {kLibReturnType, jcVariable::Create(jcVariable::TypeList)}
+        }
+    },
+    {
+        kLibSum,
+        {
+            {kLibParameterNumber, jcVariable::Create(1)},
+            {kLibReturnType, jcVariable::Create(jcVariable::TypeInt)}
+        }
+    },
+    {
+        kLibProduct,
+        {
+            {kLibParameterNumber, jcVariable::Create(1)},
+            {kLibReturnType, jcVariable::Create(jcVariable::TypeInt)}
+        }
+    },
+    {
+        kLibMinimum,
+        {
+            {kLibParameterNumber, jcVariable::Create(1)},
+            {kLibReturnType, jcVariable::Create(jcVariable::TypeInt)}
+        }
+    },
+    {
+        kLibMaximum,
+        {
+            {kLibParameterNumber, jcVariable::Create(1)},
+            {kLibReturnType, jcVariable::Create(jcVariable::TypeInt)}
+        }
+    },
+    {
+        kLibCount,
+        {
+            {kLibParameterNumber, jcVariable::Create(2)},
+            {kLibReturnType, jcVariable::Create(jcVariable::TypeInt)}
+        }
+    },
+    {
+        kLibIndexOf,
+        {
+            {kLibParameterNumber, jcVariable::Create(2)},
+            {kLibReturnType, jcVariable::Create(jcVariable::TypeInt)}
+        }
+    },
+    {
+        kLibElem,
+        {
+            {kLibParameterNumber, jcVariable::Create(2)},
+            {kLibReturnType, jcVariable::Create(jcVariable::TypeInt)}
+        }
+    },
+    {
+        kLibFilter,
+        {
+            {kLibParameterNumber, jcVariable::Create(2)},
+            {kLibReturnType, jcVariable::Create(jcVariable::TypeList)}
+        }
+    },
+    {
+        kLibMap,
+        {
+            {kLibParameterNumber, jcVariable::Create(2)},
+            {kLibReturnType, jcVariable::Create(jcVariable::TypeList)}
+        }
+    },
+    {
+        kLibFoldl,
+        {
+            {kLibParameterNumber, jcVariable::Create(3)},
+            {kLibReturnType, jcVariable::Create(jcVariable::TypeNone)}
+        }
+    },
+    {
+        kLibFoldr,
+        {
+            {kLibParameterNumber, jcVariable::Create(3)},
+            {kLibReturnType, jcVariable::Create(jcVariable::TypeNone)}
+        }
+    },
+    {
+        kLibZipWith,
+        {
+            {kLibParameterNumber, jcVariable::Create(3)},
+            {kLibReturnType, jcVariable::Create(jcVariable::TypeList)}
+        }
+    },
+    {
+        kLibConcatMap,
+        {
+            {kLibParameterNumber, jcVariable::Create(2)},
+            {kLibReturnType, jcVariable::Create(jcVariable::TypeList)}
+        }
+    },
+    {
+        kLibSortBy,
+        {
+            {kLibParameterNumber, jcVariable::Create(2)},
+            {kLibReturnType, jcVariable::Create(jcVariable::TypeList)}
+        }
+    },
+    {
+        kLibSort,
+        {
+            {kLibParameterNumber, jcVariable::Create(1)},
+            {kLibReturnType, jcVariable::Create(jcVariable::TypeList)}
+        }
+    },
+    {
+        kLibBinarySearch,
+        {
+            {kLibParameterNumber, jcVariable::Create(2)},
+            {kLibReturnType, jcVariable::Create(jcVariable::TypeInt)}
+        }
     }
 };
 
+/**
+ Combines the ints of the collection starting from initial, runs of packed ints are reduced by the kernel first
+ */
+static int reduceInts(const jcCollection &collection, const std::string &name, int initial, int (*kernel)(const int*, size_t), int (*combine)(int, int))
+{
+    int result = initial;
+    collection.forEachRun([&result, kernel, combine](const int *ints, size_t count) {
+        result = combine(result, kernel(ints, count));
+        return true;
+    }, [&result, &name, combine](jcVariablePtr &item) {
+        JC_ASSERT_OR_THROW_VM(item->getType() == jcVariable::TypeInt, name + " expects a collection of ints.");
+        result = combine(result, item->asInt());
+        return true;
+    });
+    return result;
+}
+
+static jcCollection* collectionArgument(const jcVariablePtr &arg, const std::string &name)
+{
+    jcCollection* collection = arg->asCollection();
+    JC_ASSERT_OR_THROW_VM(collection != nullptr, name + " expects a collection.");
+    return collection;
+}
+
+/**
+ Index of the first element equal to value, the size of the collection if there is none
+ */
+static size_t indexOf(const jcCollection &collection, const jcVariablePtr &value)
+{
+    // packed runs hold ints only, so they are skipped when looking for anything else
+    bool isInt = value->getType() == jcVariable::TypeInt;
+    size_t index = 0;
+    collection.forEachRun([&index, &value, isInt](const int *ints, size_t count) {
+        size_t found = isInt ? kernels::indexOf(ints, count, value->asInt()) : count;
+        index += found;
+        return found == count;
+    }, [&index, &value](jcVariablePtr &item) {
+        if (value->equal(*item)) {
+            return false;
+        }
+        index++;
+        return true;
+    });
+    return index;
+}
+
+
+/**
+ The elements of the collection in order, packed ints are boxed
+ */
+static std::vector<jcVariablePtr> elements(const jcCollection &collection)
+{
+    std::vector<jcVariablePtr> items;
+    items.reserve(collection.size());
+    collection.forEach([&items](jcVariablePtr &item) {
+        items.push_back(item);
+    });
+    return items;
+}
+
+/**
+ The ints of the collection in order, copied from packed runs without boxing
+ */
+static std::vector<int> intElements(const jcCollection &collection, const std::string &name)
+{
+    std::vector<int> ints;
+    ints.reserve(collection.size());
+    collection.forEachRun([&ints](const int *run, size_t count) {
+        ints.insert(ints.end(), run, run + count);
+        return true;
+    }, [&ints, &name](jcVariablePtr &item) {
+        JC_ASSERT_OR_THROW_VM(item->getType() == jcVariable::TypeInt, name + " expects a collection of ints.");
+        ints.push_back(item->asInt());
+        return true;
+    });
+    return ints;
+}
+
+/**
+ Stable merge sort of the items. Unlike std::sort it stays in bounds when the comparison
+ is not a strict weak ordering, which a jc function need not be.
+ */
+static void mergeSort(std::vector<jcVariablePtr> &items, const std::function<bool(const jcVariablePtr&, const jcVariablePtr&)> &less)
+{
+    // runs this short are insertion sorted before merging
+    const size_t runSize = 16;
+
+    for (size_t start = 0; start < items.size(); start += runSize) {
+        size_t end = std::min(start + runSize, items.size());
+        for (size_t idx = start + 1; idx < end; idx++) {
+            jcVariablePtr item = std::move(items[idx]);
+            size_t slot = idx;
+            for (; slot > start && less(item, items[slot - 1]); slot--) {
+                items[slot] = std::move(items[slot - 1]);
+            }
+            items[slot] = std::move(item);
+        }
+    }
+
+    std::vector<jcVariablePtr> buffer(items.size());
+    for (size_t width = runSize; width < items.size(); width *= 2) {
+        for (size_t start = 0; start < items.size(); start += 2 * width) {
+            size_t middle = std::min(start + width, items.size());
+            size_t end = std::min(start + 2 * width, items.size());
+            std::merge(std::make_move_iterator(items.begin() + start), std::make_move_iterator(items.begin() + middle),
+                       std::make_move_iterator(items.begin() + middle), std::make_move_iterator(items.begin() + end),
+                       buffer.begin() + start, less);
+        }
+        items.swap(buffer);
+    }
+}
+
+/**
+ Collects the items of a new list, keeping them as ints while every item is one so the list is packed
+ */
+class ListBuilder {
+public:
+    void append(const jcVariablePtr &item)
+    {
+        if (mPacked && item->getType() == jcVariable::TypeInt) {
+            mInts.push_back(item->asInt());
+            return;
+        } else if (mPacked) {
+            mPacked = false;
+            for (int value : mInts) {
+                mItems.push_back(jcVariable::Create(value));
+            }
+        }
+        mItems.push_back(item);
+    }
+
+    /**
+     Room for count more ints at the end of the list, returns nullptr once it holds anything else.
+     The list is cut back to size with commit.
+     */
+    int* reserveInts(size_t count)
+    {
+        if (!mPacked) {
+            return nullptr;
+        }
+        mInts.resize(mInts.size() + count);
+        return mInts.data() + mInts.size() - count;
+    }
+
+    void commitInts(size_t reserved, size_t used)
+    {
+        mInts.resize(mInts.size() - reserved + used);
+    }
+
+    void append(const jcCollection &collection)
+    {
+        collection.forEachRun([this](const int *ints, size_t count) {
+            int *out = reserveInts(count);
+            if (out != nullptr) {
+                std::copy(ints, ints + count, out);
+                return true;
+            }
+            for (size_t idx = 0; idx < count; idx++) {
+                append(jcVariable::Create(ints[idx]));
+            }
+            return true;
+        }, [this](jcVariablePtr &item) {
+            append(item);
+            return true;
+        });
+    }
+
+    jcVariablePtr build() const
+    {
+        PersistentVector items = mPacked ? PersistentVector(mInts.data(), mInts.size()) : PersistentVector(mItems.data(), mItems.size());
+        return jcVariable::Create(std::make_shared<jcList>(items));
+    }
+
+private:
+    bool mPacked=true;
+    std::vector<int> mInts;
+    std::vector<jcVariablePtr> mItems;
+};
+
 std::unordered_map<std::string, LibraryFunction> builtin::mFunctions =
 {
     {
         kLibPrint,
-        [](Interpreter &interpreter, LibState state) -> jcVariablePtr {
+        [](VirtualMachine &interpreter, LibState state) -> jcVariablePtr {
             jcVariablePtr arg = interpreter.popStack();
             state.mStdout << arg->stringRepresentation() << std::endl;
             return jcVariable::Create(0);
@@ -47,7 +361,7 @@ std::unordered_map<std::string, LibraryFunction> builtin::mFunctions =
     },
     {
         kLibLen,
-        [](Interpreter &interpreter, LibState state) -> jcVariablePtr {
+        [](VirtualMachine &interpreter, LibState state) -> jcVariablePtr {
             jcVariablePtr arg = interpreter.popStack();
             JC_ASSERT(arg->asCollection() != nullptr);
             jcCollection* collection = arg->asCollection();
@@ -57,7 +371,7 @@ std::unordered_map<std::string, LibraryFunction> builtin::mFunctions =
     },
     {
         kLibIsEmpty,
-        [](Interpreter &interpreter, LibState state) -> jcVariablePtr {
+        [](VirtualMachine &interpreter, LibState state) -> jcVariablePtr {
             jcVariablePtr list = interpreter.popStack();
 
              JC_ASSERT(list->asCollection() != nullptr);
@@ -66,6 +380,326 @@ std::unordered_map<std::string, LibraryFunction> builtin::mFunctions =
 
             return jcVariable::Create(array->isEmpty());
         }
+    },
+    {
+        kLibHead,
+        [](VirtualMachine &interpreter, LibState state) -> jcVariablePtr {
+            jcVariablePtr arg = interpreter.popStack();
+            jcCollection* collection = arg->asCollection();
+
+            JC_ASSERT_OR_THROW_VM(collection != nullptr, "head expects a collection.");
+            JC_ASSERT_OR_THROW_VM(collection->isEmpty() == false, "head of an empty collection.");
+
+            return collection->head();
+        }
+    },
+    {
+        kLibTail,
+        [](VirtualMachine &interpreter, LibState state) -> jcVariablePtr {
+            jcVariablePtr arg = interpreter.popStack();
+            jcCollection* collection = arg->asCollection();
+
+            JC_ASSERT_OR_THROW_VM(collection != nullptr, "tail expects a collection.");
+            JC_ASSERT_OR_THROW_VM(collection->isEmpty() == false, "tail of an empty collection.");
+
+            return jcVariable::CreateFromCollection(std::shared_ptr<jcCollection>(collection->tail()));
+        }
+    },
+    {
+        kLibRange,
+        [](VirtualMachine &interpreter, LibState state) -> jcVariablePtr {
+            jcVariablePtr from = interpreter.popStack();
+            jcVariablePtr to = interpreter.popStack();
+
+            JC_ASSERT_OR_THROW_VM(from->getType() == jcVariable::TypeInt && to->getType() == jcVariable::TypeInt, "range expects two ints.");
+
+            std::vector<int> ints;
+            for (int i = from->asInt(); i < to->asInt(); i++) {
+                ints.push_back(i);
+            }
+            return jcVariable::Create(std::make_shared<jcList>(PersistentVector(ints.data(), ints.size())));
+        }
+    },
+    {
+        kLibSum,
+        [](VirtualMachine &interpreter, LibState state) -> jcVariablePtr {
+            jcVariablePtr arg = interpreter.popStack();
+            jcCollection* collection = collectionArgument(arg, kLibSum);
+
+            return jcVariable::Create(reduceInts(*collection, kLibSum, 0, kernels::sum, [](int a, int b) {
+                return (int)((unsigned)a + (unsigned)b);
+            }));
+        }
+    },
+    {
+        kLibProduct,
+        [](VirtualMachine &interpreter, LibState state) -> jcVariablePtr {
+            jcVariablePtr arg = interpreter.popStack();
+            jcCollection* collection = collectionArgument(arg, kLibProduct);
+
+            return jcVariable::Create(reduceInts(*collection, kLibProduct, 1, kernels::product, [](int a, int b) {
+                return (int)((unsigned)a * (unsigned)b);
+            }));
+        }
+    },
+    {
+        kLibMinimum,
+        [](VirtualMachine &interpreter, LibState state) -> jcVariablePtr {
+            jcVariablePtr arg = interpreter.popStack();
+            jcCollection* collection = collectionArgument(arg, kLibMinimum);
+            JC_ASSERT_OR_THROW_VM(collection->isEmpty() == false, "minimum of an empty collection.");
+
+            jcVariablePtr first = collection->head();
+            JC_ASSERT_OR_THROW_VM(first->getType() == jcVariable::TypeInt, "minimum expects a collection of ints.");
+
+            return jcVariable::Create(reduceInts(*collection, kLibMinimum, first->asInt(), kernels::minimum, [](int a, int b) {
+                return std::min(a, b);
+            }));
+        }
+    },
+    {
+        kLibMaximum,
+        [](VirtualMachine &interpreter, LibState state) -> jcVariablePtr {
+            jcVariablePtr arg = interpreter.popStack();
+            jcCollection* collection = collectionArgument(arg, kLibMaximum);
+            JC_ASSERT_OR_THROW_VM(collection->isEmpty() == false, "maximum of an empty collection.");
+
+            jcVariablePtr first = collection->head();
+            JC_ASSERT_OR_THROW_VM(first->getType() == jcVariable::TypeInt, "maximum expects a collection of ints.");
+
+            return jcVariable::Create(reduceInts(*collection, kLibMaximum, first->asInt(), kernels::maximum, [](int a, int b) {
+                return std::max(a, b);
+            }));
+        }
+    },
+    {
+        kLibCount,
+        [](VirtualMachine &interpreter, LibState state) -> jcVariablePtr {
+            jcVariablePtr value = interpreter.popStack();
+            jcVariablePtr arg = interpreter.popStack();
+            jcCollection* collection = collectionArgument(arg, kLibCount);
+
+            bool isInt = value->getType() == jcVariable::TypeInt;
+            size_t matches = 0;
+            collection->forEachRun([&matches, &value, isInt](const int *ints, size_t count) {
+                matches += isInt ? kernels::count(ints, count, value->asInt()) : 0;
+                return true;
+            }, [&matches, &value](jcVariablePtr &item) {
+                matches += value->equal(*item);
+                return true;
+            });
+            return jcVariable::Create((int)matches);
+        }
+    },
+    {
+        kLibIndexOf,
+        [](VirtualMachine &interpreter, LibState state) -> jcVariablePtr {
+            jcVariablePtr value = interpreter.popStack();
+            jcVariablePtr arg = interpreter.popStack();
+            jcCollection* collection = collectionArgument(arg, kLibIndexOf);
+
+            size_t index = indexOf(*collection, value);
+            return jcVariable::Create(index < collection->size() ? (int)index : -1);
+        }
+    },
+    {
+        kLibElem,
+        [](VirtualMachine &interpreter, LibState state) -> jcVariablePtr {
+            jcVariablePtr value = interpreter.popStack();
+            jcVariablePtr arg = interpreter.popStack();
+            jcCollection* collection = collectionArgument(arg, kLibElem);
+
+            return jcVariable::Create(indexOf(*collection, value) < collection->size());
+        }
+    },
+    {
+        kLibFilter,
+        [](VirtualMachine &interpreter, LibState state) -> jcVariablePtr {
+            jcVariablePtr function = interpreter.popStack();
+            jcVariablePtr arg = interpreter.popStack();
+            jcCollection* collection = collectionArgument(arg, kLibFilter);
+
+            ListBuilder result;
+            auto callFunction = [&interpreter, &function, &result](jcVariablePtr &item) {
+                if (interpreter.apply(function, &item, 1)->asInt()) {
+                    result.append(item);
+                }
+                return true;
+            };
+
+            IntComparison comparison;
+            if (!interpreter.matchIntComparison(function, comparison)) {
+                collection->forEach([&callFunction](jcVariablePtr &item) {
+                    callFunction(item);
+                });
+                return result.build();
+            }
+
+            // anything but an int still goes through the function
+            collection->forEachRun([&result, &comparison](const int *ints, size_t count) {
+                int *out = result.reserveInts(count);
+                if (out != nullptr) {
+                    result.commitInts(count, kernels::filter(ints, count, comparison, out));
+                    return true;
+                }
+                for (size_t idx = 0; idx < count; idx++) {
+                    if (comparison.test(ints[idx])) {
+                        result.append(jcVariable::Create(ints[idx]));
+                    }
+                }
+                return true;
+            }, [&result, &comparison, &callFunction](jcVariablePtr &item) {
+                if (item->getType() != jcVariable::TypeInt) {
+                    return callFunction(item);
+                }
+                if (comparison.test(item->asInt())) {
+                    result.append(item);
+                }
+                return true;
+            });
+            return result.build();
+        }
+    },
+    {
+        kLibMap,
+        [](VirtualMachine &interpreter, LibState state) -> jcVariablePtr {
+            jcVariablePtr function = interpreter.popStack();
+            jcVariablePtr arg = interpreter.popStack();
+            jcCollection* collection = collectionArgument(arg, kLibMap);
+
+            ListBuilder result;
+            collection->forEach([&interpreter, &function, &result](jcVariablePtr &item) {
+                result.append(interpreter.apply(function, &item, 1));
+            });
+            return result.build();
+        }
+    },
+    {
+        kLibFoldl,
+        [](VirtualMachine &interpreter, LibState state) -> jcVariablePtr {
+            jcVariablePtr function = interpreter.popStack();
+            jcVariablePtr accumulator = interpreter.popStack();
+            jcVariablePtr arg = interpreter.popStack();
+            jcCollection* collection = collectionArgument(arg, kLibFoldl);
+
+            collection->forEach([&interpreter, &function, &accumulator](jcVariablePtr &item) {
+                jcVariablePtr args[] = {accumulator, item};
+                accumulator = interpreter.apply(function, args, 2);
+            });
+            return accumulator;
+        }
+    },
+    {
+        kLibFoldr,
+        [](VirtualMachine &interpreter, LibState state) -> jcVariablePtr {
+            jcVariablePtr function = interpreter.popStack();
+            jcVariablePtr accumulator = interpreter.popStack();
+            jcVariablePtr arg = interpreter.popStack();
+            jcCollection* collection = collectionArgument(arg, kLibFoldr);
+
+            // collections are walked from the front, so the elements are gathered first
+            std::vector<jcVariablePtr> items = elements(*collection);
+            for (auto item = items.rbegin(); item != items.rend(); item++) {
+                jcVariablePtr args[] = {*item, accumulator};
+                accumulator = interpreter.apply(function, args, 2);
+            }
+            return accumulator;
+        }
+    },
+    {
+        kLibZipWith,
+        [](VirtualMachine &interpreter, LibState state) -> jcVariablePtr {
+            jcVariablePtr function = interpreter.popStack();
+            jcVariablePtr leftArg = interpreter.popStack();
+            jcVariablePtr rightArg = interpreter.popStack();
+            jcCollection* left = collectionArgument(leftArg, kLibZipWith);
+            jcCollection* right = collectionArgument(rightArg, kLibZipWith);
+
+            std::vector<jcVariablePtr> leftItems = elements(*left);
+            std::vector<jcVariablePtr> rightItems = elements(*right);
+
+            ListBuilder result;
+            for (size_t idx = 0; idx < std::min(leftItems.size(), rightItems.size()); idx++) {
+                jcVariablePtr args[] = {leftItems[idx], rightItems[idx]};
+                result.append(interpreter.apply(function, args, 2));
+            }
+            return result.build();
+        }
+    },
+    {
+        kLibConcatMap,
+        [](VirtualMachine &interpreter, LibState state) -> jcVariablePtr {
+            jcVariablePtr function = interpreter.popStack();
+            jcVariablePtr arg = interpreter.popStack();
+            jcCollection* collection = collectionArgument(arg, kLibConcatMap);
+
+            ListBuilder result;
+            collection->forEach([&interpreter, &function, &result](jcVariablePtr &item) {
+                jcVariablePtr items = interpreter.apply(function, &item, 1);
+                result.append(*collectionArgument(items, kLibConcatMap));
+            });
+            return result.build();
+        }
+    },
+    {
+        kLibSortBy,
+        [](VirtualMachine &interpreter, LibState state) -> jcVariablePtr {
+            jcVariablePtr function = interpreter.popStack();
+            jcVariablePtr arg = interpreter.popStack();
+            jcCollection* collection = collectionArgument(arg, kLibSortBy);
+
+            std::vector<jcVariablePtr> items = elements(*collection);
+            mergeSort(items, [&interpreter, &function](const jcVariablePtr &left, const jcVariablePtr &right) {
+                jcVariablePtr args[] = {left, right};
+                return interpreter.apply(function, args, 2)->asInt() != 0;
+            });
+
+            ListBuilder result;
+            for (const jcVariablePtr &item : items) {
+                result.append(item);
+            }
+            return result.build();
+        }
+    },
+    {
+        kLibSort,
+        [](VirtualMachine &interpreter, LibState state) -> jcVariablePtr {
+            jcVariablePtr arg = interpreter.popStack();
+            jcCollection* collection = collectionArgument(arg, kLibSort);
+
+            std::vector<int> ints = intElements(*collection, kLibSort);
+            kernels::sort(ints.data(), ints.size());
+            return jcVariable::Create(std::make_shared<jcList>(PersistentVector(ints.data(), ints.size())));
+        }
+    },
+    {
+        kLibBinarySearch,
+        [](VirtualMachine &interpreter, LibState state) -> jcVariablePtr {
+            jcVariablePtr value = interpreter.popStack();
+            jcVariablePtr arg = interpreter.popStack();
+            jcCollection* collection = collectionArgument(arg, kLibBinarySearch);
+            JC_ASSERT_OR_THROW_VM(value->getType() == jcVariable::TypeInt, "binarySearch expects an int.");
+
+            // each probe is a lookup in the list's tree, so only log(n) elements are boxed
+            auto intAt = [collection](size_t index) {
+                jcVariablePtr item = collection->at((int)index);
+                JC_ASSERT_OR_THROW_VM(item->getType() == jcVariable::TypeInt, "binarySearch expects a collection of ints.");
+                return item->asInt();
+            };
+
+            size_t low = 0;
+            size_t high = collection->size();
+            while (low < high) {
+                size_t middle = low + (high - low) / 2;
+                if (intAt(middle) < value->asInt()) {
+                    low = middle + 1;
+                } else {
+                    high = middle;
+                }
+            }
+            bool found = low < collection->size() && intAt(low) == value->asInt();
+            return jcVariable::Create(found ? (int)low : -1);
+        }
     }
 };
 
@@ -96,7 +730,7 @@ std::map<std::string, jcVariablePtr>* builtin::info(const std::string &functionN
     return nullptr;
 }
 
-jcVariablePtr builtin::execute(const std::string &functionName, Interpreter &interpreter)
+jcVariablePtr builtin::execute(const std::string &functionName, VirtualMachine &interpreter)
 {
     if (mFunctions.count(functionName)) {
         return mFunctions[functionName](interpreter, state());
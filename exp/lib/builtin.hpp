@@ -2,7 +2,7 @@
 
 #include "jc.h"
 #include "jcVariable.hpp"
-#include "Interpreter.hpp"
+#include "VirtualMachine.hpp"
 
 #include <string>
 #include <functional>
@@ -35,10 +35,115 @@ const std::string kLibReturnType = "LibReturnType";
     - arg 1: a list
     - returns the length of the list
 
+ function: head
+    - arg 1: a non-empty list
+    - returns the first element
+
+ function: tail
+    - arg 1: a non-empty list
+    - returns the list without its first element, sharing the rest of the given list
+
+ function: range
+    - arg 1: the first int
+    - arg 2: the int to stop before
+    - returns the list of the ints in between, stored packed
+
+ function: sum, product
+    - arg 1: a collection of ints
+    - returns the sum or product of the elements, 0 and 1 when empty
+
+ function: minimum, maximum
+    - arg 1: a non-empty collection of ints
+    - returns the smallest or largest element
+
+ function: count
+    - arg 1: a value
+    - arg 2: a collection
+    - returns how many elements are equal to the value
+
+ function: indexOf
+    - arg 1: a value
+    - arg 2: a collection
+    - returns the index of the first element equal to the value, -1 if there is none
+
+ function: elem
+    - arg 1: a value
+    - arg 2: a collection
+    - returns if an element is equal to the value
+
+ function: filter
+    - arg 1: a function of one parameter
+    - arg 2: a collection
+    - returns the list of the elements the function returns true for. Functions comparing their parameter
+      with an int, e.g. {(x) = x < pivot}, are not called for int elements, packed ints are compared with SIMD instructions
+
+ function: map
+    - arg 1: a function of one parameter
+    - arg 2: a collection
+    - returns the list of the function's results for each element
+
+ function: foldl
+    - arg 1: a function of two parameters
+    - arg 2: the initial value
+    - arg 3: a collection
+    - returns f(...f(f(initial, x0), x1)..., xn)
+
+ function: foldr
+    - arg 1: a function of two parameters
+    - arg 2: the initial value
+    - arg 3: a collection
+    - returns f(x0, f(x1, ...f(xn, initial)...))
+
+ function: zipWith
+    - arg 1: a function of two parameters
+    - arg 2: a collection
+    - arg 3: a collection
+    - returns the list of the function's results for the elements at the same index, as long as the shorter collection
+
+ function: concatMap
+    - arg 1: a function of one parameter returning a collection
+    - arg 2: a collection
+    - returns the list of the elements of the function's results for each element
+
+ function: sortBy
+    - arg 1: a function of two parameters returning if the first goes before the second
+    - arg 2: a collection
+    - returns the list of the elements in order, elements the function does not order keep their order
+
+ The function arguments of these are called through VirtualMachine::apply.
+
+ function: sort
+    - arg 1: a collection of ints
+    - returns the list of the ints in ascending order, stored packed
+
+ function: binarySearch
+    - arg 1: an int
+    - arg 2: a collection of ints in ascending order
+    - returns the index of the first element equal to the int, -1 if there is none
+
  */
 const std::string kLibPrint = "print";
 const std::string kLibLen = "len";
 const std::string kLibIsEmpty = "isEmpty";
+const std::string kLibHead = "head";
+const std::string kLibTail = "tail";
+const std::string kLibRange = "range";
+const std::string kLibSum = "sum";
+const std::string kLibProduct = "product";
+const std::string kLibMinimum = "minimum";
+const std::string kLibMaximum = "maximum";
+const std::string kLibCount = "count";
+const std::string kLibIndexOf = "indexOf";
+const std::string kLibElem = "elem";
+const std::string kLibFilter = "filter";
+const std::string kLibMap = "map";
+const std::string kLibFoldl = "foldl";
+const std::string kLibFoldr = "foldr";
+const std::string kLibZipWith = "zipWith";
+const std::string kLibConcatMap = "concatMap";
+const std::string kLibSortBy = "sortBy";
+const std::string kLibSort = "sort";
+const std::string kLibBinarySearch = "binarySearch";
 
 struct LibState {
     std::ostream &mStdout;
@@ -47,7 +152,7 @@ struct LibState {
     LibState();
 };
 
-using LibraryFunction = std::function<jcVariablePtr(Interpreter&, const LibState&)>;
+using LibraryFunction = std::function<jcVariablePtr(VirtualMachine&, const LibState&)>;
 
 class builtin {
     builtin();
@@ -63,7 +168,7 @@ public:
      Runs the given function with the supplied arguments
      Runtime error will be thrown if function does not exist
      */
-    jcVariablePtr execute(const std::string &functionName, Interpreter &interpreter);
+    jcVariablePtr execute(const std::string &functionName, VirtualMachine &interpreter);
 
     const LibState& state() const;
 
@@ -0,0 +1,458 @@
+//  kernels.cpp
+
+#include "kernels.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define JC_KERNELS_X86 1
+#include <immintrin.h>
+#endif
+
+namespace lib
+{
+namespace kernels
+{
+
+// below this std::sort beats the four passes over the ints
+static constexpr size_t kMinRadixSortSize = 256;
+
+// the scalar loops finish what the vector loops leave over
+static int sumScalar(const int *ints, size_t count)
+{
+    unsigned total = 0;
+    for (size_t idx = 0; idx < count; idx++) {
+        total += (unsigned)ints[idx];
+    }
+    return (int)total;
+}
+
+static int productScalar(const int *ints, size_t count)
+{
+    unsigned total = 1;
+    for (size_t idx = 0; idx < count; idx++) {
+        total *= (unsigned)ints[idx];
+    }
+    return (int)total;
+}
+
+static size_t countScalar(const int *ints, size_t count, int value)
+{
+    return std::count(ints, ints + count, value);
+}
+
+static size_t indexOfScalar(const int *ints, size_t count, int value)
+{
+    return std::find(ints, ints + count, value) - ints;
+}
+
+static size_t filterScalar(const int *ints, size_t count, const IntComparison &comparison, int *out)
+{
+    // every int is written, only the ones passing move the end forward
+    size_t kept = 0;
+    for (size_t idx = 0; idx < count; idx++) {
+        out[kept] = ints[idx];
+        kept += comparison.test(ints[idx]);
+    }
+    return kept;
+}
+
+#if JC_KERNELS_X86
+
+static bool hasAVX2()
+{
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+}
+
+// AVX2, 8 lanes
+
+__attribute__((target("avx2")))
+static int sumAVX2(const int *ints, size_t count)
+{
+    __m256i total = _mm256_setzero_si256();
+    size_t idx = 0;
+    for (; idx + 8 <= count; idx += 8) {
+        total = _mm256_add_epi32(total, _mm256_loadu_si256((const __m256i*)(ints + idx)));
+    }
+    int lanes[8];
+    _mm256_storeu_si256((__m256i*)lanes, total);
+    return (int)((unsigned)sumScalar(lanes, 8) + (unsigned)sumScalar(ints + idx, count - idx));
+}
+
+__attribute__((target("avx2")))
+static int productAVX2(const int *ints, size_t count)
+{
+    __m256i total = _mm256_set1_epi32(1);
+    size_t idx = 0;
+    for (; idx + 8 <= count; idx += 8) {
+        total = _mm256_mullo_epi32(total, _mm256_loadu_si256((const __m256i*)(ints + idx)));
+    }
+    int lanes[8];
+    _mm256_storeu_si256((__m256i*)lanes, total);
+    return (int)((unsigned)productScalar(lanes, 8) * (unsigned)productScalar(ints + idx, count - idx));
+}
+
+__attribute__((target("avx2")))
+static int minimumAVX2(const int *ints, size_t count)
+{
+    if (count < 8) {
+        return *std::min_element(ints, ints + count);
+    }
+    __m256i result = _mm256_loadu_si256((const __m256i*)ints);
+    size_t idx = 8;
+    for (; idx + 8 <= count; idx += 8) {
+        result = _mm256_min_epi32(result, _mm256_loadu_si256((const __m256i*)(ints + idx)));
+    }
+    int lanes[8];
+    _mm256_storeu_si256((__m256i*)lanes, result);
+    int rest = *std::min_element(lanes, lanes + 8);
+    return idx < count ? std::min(rest, *std::min_element(ints + idx, ints + count)) : rest;
+}
+
+__attribute__((target("avx2")))
+static int maximumAVX2(const int *ints, size_t count)
+{
+    if (count < 8) {
+        return *std::max_element(ints, ints + count);
+    }
+    __m256i result = _mm256_loadu_si256((const __m256i*)ints);
+    size_t idx = 8;
+    for (; idx + 8 <= count; idx += 8) {
+        result = _mm256_max_epi32(result, _mm256_loadu_si256((const __m256i*)(ints + idx)));
+    }
+    int lanes[8];
+    _mm256_storeu_si256((__m256i*)lanes, result);
+    int rest = *std::max_element(lanes, lanes + 8);
+    return idx < count ? std::max(rest, *std::max_element(ints + idx, ints + count)) : rest;
+}
+
+__attribute__((target("avx2")))
+static size_t countAVX2(const int *ints, size_t count, int value)
+{
+    // a match is -1 in its lane, so subtracting the compare counts it
+    __m256i needle = _mm256_set1_epi32(value);
+    __m256i matches = _mm256_setzero_si256();
+    size_t idx = 0;
+    for (; idx + 8 <= count; idx += 8) {
+        matches = _mm256_sub_epi32(matches, _mm256_cmpeq_epi32(needle, _mm256_loadu_si256((const __m256i*)(ints + idx))));
+    }
+    int lanes[8];
+    _mm256_storeu_si256((__m256i*)lanes, matches);
+    size_t result = 0;
+    for (int lane : lanes) {
+        result += (unsigned)lane;
+    }
+    return result + countScalar(ints + idx, count - idx, value);
+}
+
+__attribute__((target("avx2")))
+static size_t indexOfAVX2(const int *ints, size_t count, int value)
+{
+    __m256i needle = _mm256_set1_epi32(value);
+    size_t idx = 0;
+    for (; idx + 8 <= count; idx += 8) {
+        __m256i equal = _mm256_cmpeq_epi32(needle, _mm256_loadu_si256((const __m256i*)(ints + idx)));
+        int mask = _mm256_movemask_ps(_mm256_castsi256_ps(equal));
+        if (mask != 0) {
+            return idx + __builtin_ctz(mask);
+        }
+    }
+    return idx + indexOfScalar(ints + idx, count - idx, value);
+}
+
+/**
+ Lanes of the mask in the order they are kept, e.g. 0b0101 keeps lanes 0 and 2
+ */
+struct CompressTable {
+    uint8_t order[256][8];
+
+    CompressTable()
+    {
+        for (int mask = 0; mask < 256; mask++) {
+            int kept = 0;
+            for (int lane = 0; lane < 8; lane++) {
+                if (mask & (1 << lane)) {
+                    order[mask][kept++] = lane;
+                }
+            }
+            while (kept < 8) {
+                order[mask][kept++] = 0;
+            }
+        }
+    }
+};
+
+static const CompressTable kCompress;
+
+// there are only greater than and equal compares, the other comparisons swap the operands or negate the mask
+__attribute__((target("avx2")))
+static int maskAVX2(__m256i items, __m256i value, IntComparison::Op op)
+{
+    __m256i matches;
+    switch (op) {
+        case IntComparison::LessThan:
+        case IntComparison::GreaterThanEqual:
+            matches = _mm256_cmpgt_epi32(value, items);
+            break;
+        case IntComparison::GreaterThan:
+        case IntComparison::LessThanEqual:
+            matches = _mm256_cmpgt_epi32(items, value);
+            break;
+        case IntComparison::Equals:
+            matches = _mm256_cmpeq_epi32(items, value);
+            break;
+    }
+    int mask = _mm256_movemask_ps(_mm256_castsi256_ps(matches));
+    return op == IntComparison::GreaterThanEqual || op == IntComparison::LessThanEqual ? mask ^ 0xff : mask;
+}
+
+__attribute__((target("avx2")))
+static size_t filterAVX2(const int *ints, size_t count, const IntComparison &comparison, int *out)
+{
+    __m256i value = _mm256_set1_epi32(comparison.value);
+    size_t kept = 0;
+    size_t idx = 0;
+    for (; idx + 8 <= count; idx += 8) {
+        // the kept lanes are moved to the front and all 8 stored, kept <= idx so the store stays within out
+        __m256i items = _mm256_loadu_si256((const __m256i*)(ints + idx));
+        int mask = maskAVX2(items, value, comparison.op);
+        __m256i order = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)kCompress.order[mask]));
+        _mm256_storeu_si256((__m256i*)(out + kept), _mm256_permutevar8x32_epi32(items, order));
+        kept += __builtin_popcount(mask);
+    }
+    return kept + filterScalar(ints + idx, count - idx, comparison, out + kept);
+}
+
+// SSE2, 4 lanes, min and max are done with a compare as SSE2 has no 32 bit min
+
+static int sumSSE2(const int *ints, size_t count)
+{
+    __m128i total = _mm_setzero_si128();
+    size_t idx = 0;
+    for (; idx + 4 <= count; idx += 4) {
+        total = _mm_add_epi32(total, _mm_loadu_si128((const __m128i*)(ints + idx)));
+    }
+    int lanes[4];
+    _mm_storeu_si128((__m128i*)lanes, total);
+    return (int)((unsigned)sumScalar(lanes, 4) + (unsigned)sumScalar(ints + idx, count - idx));
+}
+
+static __m128i selectSSE2(__m128i mask, __m128i a, __m128i b)
+{
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+static int minimumSSE2(const int *ints, size_t count)
+{
+    if (count < 4) {
+        return *std::min_element(ints, ints + count);
+    }
+    __m128i result = _mm_loadu_si128((const __m128i*)ints);
+    size_t idx = 4;
+    for (; idx + 4 <= count; idx += 4) {
+        __m128i items = _mm_loadu_si128((const __m128i*)(ints + idx));
+        result = selectSSE2(_mm_cmplt_epi32(items, result), items, result);
+    }
+    int lanes[4];
+    _mm_storeu_si128((__m128i*)lanes, result);
+    int rest = *std::min_element(lanes, lanes + 4);
+    return idx < count ? std::min(rest, *std::min_element(ints + idx, ints + count)) : rest;
+}
+
+static int maximumSSE2(const int *ints, size_t count)
+{
+    if (count < 4) {
+        return *std::max_element(ints, ints + count);
+    }
+    __m128i result = _mm_loadu_si128((const __m128i*)ints);
+    size_t idx = 4;
+    for (; idx + 4 <= count; idx += 4) {
+        __m128i items = _mm_loadu_si128((const __m128i*)(ints + idx));
+        result = selectSSE2(_mm_cmpgt_epi32(items, result), items, result);
+    }
+    int lanes[4];
+    _mm_storeu_si128((__m128i*)lanes, result);
+    int rest = *std::max_element(lanes, lanes + 4);
+    return idx < count ? std::max(rest, *std::max_element(ints + idx, ints + count)) : rest;
+}
+
+static size_t countSSE2(const int *ints, size_t count, int value)
+{
+    __m128i needle = _mm_set1_epi32(value);
+    __m128i matches = _mm_setzero_si128();
+    size_t idx = 0;
+    for (; idx + 4 <= count; idx += 4) {
+        matches = _mm_sub_epi32(matches, _mm_cmpeq_epi32(needle, _mm_loadu_si128((const __m128i*)(ints + idx))));
+    }
+    int lanes[4];
+    _mm_storeu_si128((__m128i*)lanes, matches);
+    size_t result = 0;
+    for (int lane : lanes) {
+        result += (unsigned)lane;
+    }
+    return result + countScalar(ints + idx, count - idx, value);
+}
+
+static size_t indexOfSSE2(const int *ints, size_t count, int value)
+{
+    __m128i needle = _mm_set1_epi32(value);
+    size_t idx = 0;
+    for (; idx + 4 <= count; idx += 4) {
+        __m128i equal = _mm_cmpeq_epi32(needle, _mm_loadu_si128((const __m128i*)(ints + idx)));
+        int mask = _mm_movemask_ps(_mm_castsi128_ps(equal));
+        if (mask != 0) {
+            return idx + __builtin_ctz(mask);
+        }
+    }
+    return idx + indexOfScalar(ints + idx, count - idx, value);
+}
+
+static int maskSSE2(__m128i items, __m128i value, IntComparison::Op op)
+{
+    __m128i matches;
+    switch (op) {
+        case IntComparison::LessThan:
+        case IntComparison::GreaterThanEqual:
+            matches = _mm_cmpgt_epi32(value, items);
+            break;
+        case IntComparison::GreaterThan:
+        case IntComparison::LessThanEqual:
+            matches = _mm_cmpgt_epi32(items, value);
+            break;
+        case IntComparison::Equals:
+            matches = _mm_cmpeq_epi32(items, value);
+            break;
+    }
+    int mask = _mm_movemask_ps(_mm_castsi128_ps(matches));
+    return op == IntComparison::GreaterThanEqual || op == IntComparison::LessThanEqual ? mask ^ 0xf : mask;
+}
+
+static size_t filterSSE2(const int *ints, size_t count, const IntComparison &comparison, int *out)
+{
+    // SSE2 has no variable shuffle, the kept lanes are copied one by one
+    __m128i value = _mm_set1_epi32(comparison.value);
+    size_t kept = 0;
+    size_t idx = 0;
+    for (; idx + 4 <= count; idx += 4) {
+        int mask = maskSSE2(_mm_loadu_si128((const __m128i*)(ints + idx)), value, comparison.op);
+        while (mask != 0) {
+            out[kept++] = ints[idx + __builtin_ctz(mask)];
+            mask &= mask - 1;
+        }
+    }
+    return kept + filterScalar(ints + idx, count - idx, comparison, out + kept);
+}
+
+#endif
+
+int sum(const int *ints, size_t count)
+{
+#if JC_KERNELS_X86
+    return hasAVX2() ? sumAVX2(ints, count) : sumSSE2(ints, count);
+#else
+    return sumScalar(ints, count);
+#endif
+}
+
+int product(const int *ints, size_t count)
+{
+#if JC_KERNELS_X86
+    // SSE2 has no 32 bit multiply
+    return hasAVX2() ? productAVX2(ints, count) : productScalar(ints, count);
+#else
+    return productScalar(ints, count);
+#endif
+}
+
+int minimum(const int *ints, size_t count)
+{
+#if JC_KERNELS_X86
+    return hasAVX2() ? minimumAVX2(ints, count) : minimumSSE2(ints, count);
+#else
+    return *std::min_element(ints, ints + count);
+#endif
+}
+
+int maximum(const int *ints, size_t count)
+{
+#if JC_KERNELS_X86
+    return hasAVX2() ? maximumAVX2(ints, count) : maximumSSE2(ints, count);
+#else
+    return *std::max_element(ints, ints + count);
+#endif
+}
+
+size_t count(const int *ints, size_t count, int value)
+{
+#if JC_KERNELS_X86
+    return hasAVX2() ? countAVX2(ints, count, value) : countSSE2(ints, count, value);
+#else
+    return countScalar(ints, count, value);
+#endif
+}
+
+size_t indexOf(const int *ints, size_t count, int value)
+{
+#if JC_KERNELS_X86
+    return hasAVX2() ? indexOfAVX2(ints, count, value) : indexOfSSE2(ints, count, value);
+#else
+    return indexOfScalar(ints, count, value);
+#endif
+}
+
+size_t filter(const int *ints, size_t count, const IntComparison &comparison, int *out)
+{
+#if JC_KERNELS_X86
+    return hasAVX2() ? filterAVX2(ints, count, comparison, out) : filterSSE2(ints, count, comparison, out);
+#else
+    return filterScalar(ints, count, comparison, out);
+#endif
+}
+
+void sort(int *ints, size_t count)
+{
+    if (count < kMinRadixSortSize) {
+        std::sort(ints, ints + count);
+        return;
+    }
+
+    // least significant byte first, the sign bit is flipped so negative ints come first
+    std::vector<uint32_t> keys(count);
+    for (size_t idx = 0; idx < count; idx++) {
+        keys[idx] = (uint32_t)ints[idx] ^ 0x80000000u;
+    }
+
+    std::vector<uint32_t> buffer(count);
+    for (int shift = 0; shift < 32; shift += 8) {
+        size_t offsets[256] = {};
+        for (uint32_t key : keys) {
+            offsets[(key >> shift) & 0xff]++;
+        }
+
+        // a pass where every key has the same byte would only copy them
+        if (offsets[(keys[0] >> shift) & 0xff] == count) {
+            continue;
+        }
+
+        size_t total = 0;
+        for (size_t &offset : offsets) {
+            size_t bucket = offset;
+            offset = total;
+            total += bucket;
+        }
+        for (uint32_t key : keys) {
+            buffer[offsets[(key >> shift) & 0xff]++] = key;
+        }
+        keys.swap(buffer);
+    }
+
+    for (size_t idx = 0; idx < count; idx++) {
+        ints[idx] = (int)(keys[idx] ^ 0x80000000u);
+    }
+}
+
+}
+}
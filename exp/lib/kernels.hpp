@@ -0,0 +1,52 @@
+//  kernels.hpp
+
+#pragma once
+
+#include "VirtualMachine.hpp"
+
+#include <cstddef>
+
+namespace lib
+{
+
+/**
+ Loops over packed ints used by the collection builtins.
+ On x86 they use AVX2 when the CPU has it and SSE2 otherwise, other targets run the scalar loop.
+ Sums and products wrap around like int arithmetic in the VM.
+ */
+namespace kernels
+{
+
+int sum(const int *ints, size_t count);
+
+int product(const int *ints, size_t count);
+
+/**
+ count > 0
+ */
+int minimum(const int *ints, size_t count);
+int maximum(const int *ints, size_t count);
+
+/**
+ Number of ints equal to value
+ */
+size_t count(const int *ints, size_t count, int value);
+
+/**
+ Index of the first int equal to value, count if there is none
+ */
+size_t indexOf(const int *ints, size_t count, int value);
+
+/**
+ Copies the ints passing the comparison to out, which has room for count ints, and returns how many there are
+ */
+size_t filter(const int *ints, size_t count, const IntComparison &comparison, int *out);
+
+/**
+ Sorts the ints in place, a radix sort unless there are only a few
+ */
+void sort(int *ints, size_t count);
+
+}
+
+}
@@ -0,0 +1,13 @@
+//  prelude.cpp
+
+// Builds that do not generate the prelude image link this instead
+
+#include "prelude.hpp"
+
+namespace lib
+{
+
+const unsigned char *const kPreludeImage = nullptr;
+const size_t kPreludeImageSize = 0;
+
+}
@@ -0,0 +1,17 @@
+//  prelude.hpp
+
+#pragma once
+
+#include <cstddef>
+
+namespace lib
+{
+
+/**
+ The standard library as a .jcb image, compiled from lib/std.jc at build time (see tools/embed_prelude.cpp).
+ kPreludeImageSize is 0 in builds that do not embed it, the library is then compiled from JC_STD_LIBRARY_PATH.
+ */
+extern const unsigned char *const kPreludeImage;
+extern const size_t kPreludeImageSize;
+
+}
@@ -3,6 +3,8 @@
 #include "Lexer.hpp"
 #include "Parser.hpp"
 #include "Runtime.hpp"
+#include "ImageFile.hpp"
+#include "jcReclaimer.hpp"
 #include "jc.h"
 
 #include <fstream>
@@ -10,6 +12,7 @@
 #include <sstream>
 
 #include <cstdio>
+#include <cstdlib>
 #include <readline/history.h>
 #include <readline/readline.h>
 
@@ -25,11 +28,11 @@ std::string getErrorMessage(const jcException &exception)
     }
 }
 
-void run_shell(std::ostream& stream)
+void run_shell(std::ostream& stream, const RuntimeOptions &options)
 {
     stream << "JITCalculator v" << JC_VERSION_STRING << "\n";
 
-    Runtime runtime;
+    Runtime runtime(options);
     while (true) {
         const char* rawIn = readline(">>> ");
 
@@ -76,7 +79,30 @@ void run_shell(std::ostream& stream)
     }
 }
 
-void run_file(std::string filename)
+static bool hasExtension(const std::string &filename, const std::string &extension)
+{
+    return filename.size() >= extension.size() &&
+           filename.compare(filename.size() - extension.size(), extension.size(), extension) == 0;
+}
+
+/**
+ $JC_CACHE_DIR, otherwise jc in the user's cache directory
+ */
+static std::string defaultCacheDirectory()
+{
+    if (const char *directory = getenv("JC_CACHE_DIR")) {
+        return directory;
+    }
+    if (const char *directory = getenv("XDG_CACHE_HOME")) {
+        return std::string(directory) + "/jc";
+    }
+    if (const char *home = getenv("HOME")) {
+        return std::string(home) + "/.cache/jc";
+    }
+    return "";
+}
+
+void compile_file(std::string filename, const RuntimeOptions &options)
 {
     std::ifstream inputStream;
     inputStream.open(filename.c_str(), std::ifstream::in | std::ifstream::binary);
@@ -84,20 +110,91 @@ void run_file(std::string filename)
         std::cerr << "Could not open file " << filename;
         return;
     }
+
+    std::string output = (hasExtension(filename, ".jc") ? filename.substr(0, filename.size() - 3) : filename) + ".jcb";
     try {
-        Runtime::evaluate(inputStream);
+        std::stringstream source;
+        source << inputStream.rdbuf();
+
+        std::stringstream sourceStream(source.str());
+        bc::Image image = Runtime::compile(sourceStream, options);
+        if (bc::ImageFile::write(image, Runtime::sourceHash(source.str(), options), output) == false) {
+            std::cerr << "Could not write file " << output << std::endl;
+        }
     } catch (jcException exception) {
         std::cerr << getErrorMessage(exception) << std::endl;
     }
+}
+
+void run_file(std::string filename, const RuntimeOptions &options, bool printStatistics)
+{
+    RuntimeStatistics statistics;
+    if (hasExtension(filename, ".jcb")) {
+        bc::Image image;
+        if (bc::ImageFile::load(filename, image) == false) {
+            std::cerr << "Could not load compiled file " << filename << std::endl;
+            return;
+        }
+        try {
+            statistics = Runtime::evaluate(image);
+        } catch (jcException exception) {
+            std::cerr << getErrorMessage(exception) << std::endl;
+            return;
+        }
+    } else {
+        try {
+            statistics = Runtime::evaluateFile(filename, options);
+        } catch (jcException exception) {
+            std::cerr << getErrorMessage(exception) << std::endl;
+            return;
+        }
+    }
 
-    inputStream.close();
+    if (printStatistics) {
+        std::cerr << "dispatched " << statistics.dispatchCount << " instructions in " << statistics.seconds << "s" << std::endl;
+    }
 }
 
 int main(int argc, const char* argv[])
 {
-    if (argc >= 2) {
-        run_file(std::string(argv[1]));
+    RuntimeOptions options;
+    bool printStatistics = false;
+    bool compile = false;
+    options.cacheDirectory = defaultCacheDirectory();
+    std::vector<std::string> files;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = std::string(argv[i]);
+        if (arg == "--lazy") {
+            options.lazyEvaluation = true;
+        } else if (arg == "--engine=register") {
+            options.engine = RuntimeOptions::Engine::Register;
+        } else if (arg == "--engine=stack") {
+            options.engine = RuntimeOptions::Engine::Stack;
+        } else if (arg == "--stats") {
+            printStatistics = true;
+        } else if (arg == "--compile") {
+            compile = true;
+        } else if (arg == "--no-cache") {
+            options.cacheDirectory = "";
+        } else if (arg == "--stream") {
+            options.streaming = true;
+        } else if (arg == "--free-in-background") {
+            jcReclaimer::setBackground(true);
+        } else if (arg.compare(0, 10, "--threads=") == 0) {
+            options.compileThreads = (unsigned)std::stoul(arg.substr(10));
+        } else {
+            files.push_back(arg);
+        }
+    }
+
+    if (compile) {
+        for (auto file : files) {
+            compile_file(file, options);
+        }
+    } else if (files.size()) {
+        run_file(files[0], options, printStatistics);
     } else {
-        run_shell(std::cout);
+        run_shell(std::cout, options);
     }
 }
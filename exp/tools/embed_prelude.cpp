@@ -0,0 +1,54 @@
+//  embed_prelude.cpp
+
+// Build step: compiles the standard library and writes it as a C++ source defining lib::kPreludeImage
+//  usage: embed_prelude <std.jc> <output.cpp>
+
+#include "Runtime.hpp"
+#include "ImageFile.hpp"
+#include "jc.h"
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+int main(int argc, const char* argv[])
+{
+    if (argc != 3) {
+        std::cerr << "usage: embed_prelude <std.jc> <output.cpp>" << std::endl;
+        return 1;
+    }
+
+    std::ifstream inputStream(argv[1], std::ifstream::in | std::ifstream::binary);
+    if (inputStream.is_open() == false) {
+        std::cerr << "Could not open file " << argv[1] << std::endl;
+        return 1;
+    }
+
+    std::string data;
+    try {
+        bc::Image image = Runtime::compileLibrary(inputStream);
+        data = bc::ImageFile::serialize(image, 0);
+    } catch (jcException exception) {
+        std::cerr << "Could not compile " << argv[1] << ": " << exception.getMessage() << std::endl;
+        return 1;
+    }
+
+    std::stringstream output;
+    output << "// Generated by embed_prelude from " << argv[1] << ", do not edit\n\n";
+    output << "#include \"prelude.hpp\"\n\n";
+    output << "namespace lib\n{\n\n";
+    output << "alignas(8) static const unsigned char kPreludeData[] = {";
+    for (size_t i = 0; i < data.size(); i++) {
+        output << (i % 16 == 0 ? "\n    " : " ");
+        output << "0x" << std::hex << std::setw(2) << std::setfill('0') << (int)(unsigned char)data[i] << ",";
+    }
+    output << std::dec << "\n};\n\n";
+    output << "const unsigned char *const kPreludeImage = kPreludeData;\n";
+    output << "const size_t kPreludeImageSize = sizeof(kPreludeData);\n\n";
+    output << "}\n";
+
+    std::ofstream outputStream(argv[2], std::ofstream::out | std::ofstream::trunc);
+    outputStream << output.str();
+    return outputStream.good() ? 0 : 1;
+}
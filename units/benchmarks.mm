@@ -0,0 +1,279 @@
+//  benchmarks.mm
+
+#import <XCTest/XCTest.h>
+
+#include <string>
+#include <iostream>
+#include <sstream>
+
+#include "Runtime.hpp"
+#include "Lexer.hpp"
+#include "jcList.hpp"
+
+@interface benchmarks : XCTestCase
+
+@end
+
+@implementation benchmarks
+
+static std::string getBenchmarkProgram()
+{
+    return "let fib(n) | n < 2 = n | else = fib(n - 1) + fib(n - 2)\
+    let count(xs, n) | isEmpty(xs) = n | else = count(tail(xs), n + 1)\
+    let upTo(n, xs) | n == 0 = xs | else = upTo(n - 1, n :: xs)\
+    fib(20) + count(map({(x) = x * 2}, upTo(2000, [])), 0)\
+    ";
+}
+
+static RuntimeStatistics runBenchmark(RuntimeOptions::Engine engine)
+{
+    RuntimeOptions options;
+    options.engine = engine;
+
+    std::stringstream stream;
+    stream << getBenchmarkProgram();
+    return Runtime::evaluate(stream, options);
+}
+
+- (void)testStackEngine
+{
+    __block RuntimeStatistics statistics;
+    [self measureBlock:^{
+        statistics = runBenchmark(RuntimeOptions::Engine::Stack);
+    }];
+    std::cout << "stack engine: " << statistics.dispatchCount << " dispatches" << std::endl;
+}
+
+- (void)testRegisterEngine
+{
+    __block RuntimeStatistics statistics;
+    [self measureBlock:^{
+        statistics = runBenchmark(RuntimeOptions::Engine::Register);
+    }];
+    std::cout << "register engine: " << statistics.dispatchCount << " dispatches" << std::endl;
+}
+
+- (void)testRegisterEngineDispatchesLess
+{
+    RuntimeStatistics stack = runBenchmark(RuntimeOptions::Engine::Stack);
+    RuntimeStatistics registers = runBenchmark(RuntimeOptions::Engine::Register);
+    XCTAssert(registers.dispatchCount < stack.dispatchCount);
+}
+
+- (void)testListIndexing
+{
+    // indexing was a walk from the head, which made this loop quadratic
+    std::string program = "let sumTo(xs, i, acc) | i == len(xs) = acc | else = sumTo(xs, i + 1, acc + xs[i])\
+    let upTo(n, xs) | n == 0 = xs | else = upTo(n - 1, n :: xs)\
+    sumTo(upTo(20000, []), 0, 0)";
+
+    [self measureBlock:^{
+        std::stringstream stream(program);
+        Runtime::evaluate(stream);
+    }];
+}
+
+- (void)testListWalk
+{
+    std::string program = "let count(xs, n) | isEmpty(xs) = n | else = count(tail(xs), n + 1)\
+    let upTo(n, xs) | n == 0 = xs | else = upTo(n - 1, n :: xs)\
+    count(map({(x) = x * 2}, upTo(20000, [])), 0)";
+
+    [self measureBlock:^{
+        std::stringstream stream(program);
+        Runtime::evaluate(stream);
+    }];
+}
+
+static jcListPtr buildLongList(int count)
+{
+    jcListPtr list = std::make_shared<jcList>();
+    for (int i = count - 1; i >= 0; i--) {
+        list = std::shared_ptr<jcList>(list->cons(jcVariable::Create(i)));
+    }
+    return list;
+}
+
+- (void)testBuildLongList
+{
+    [self measureBlock:^{
+        buildLongList(1000000);
+    }];
+}
+
+- (void)testTraverseLongList
+{
+    jcListPtr list = buildLongList(1000000);
+
+    [self measureBlock:^{
+        long sum = 0;
+        list->forEach([&sum](jcVariablePtr &item) {
+            sum += item->asInt();
+        });
+        XCTAssert(sum == 999999L * 1000000L / 2);
+    }];
+}
+
+- (void)testQuickSort
+{
+    // every level of qs joins its halves with ++
+    std::string program = "let qs(xs) | isEmpty(xs) = [] | else = qs(filter({(x) = x < head(xs)}, tail(xs))) ++ [head(xs)] ++ qs(filter({(x) = x >= head(xs)}, tail(xs)))\
+    let random(n, seed, xs) | n == 0 = xs | else = random(n - 1, (seed * 75 + 74) - ((seed * 75 + 74) / 65537) * 65537, seed :: xs)\
+    len(qs(random(20000, 42, [])))";
+
+    [self measureBlock:^{
+        std::stringstream stream(program);
+        Runtime::evaluate(stream);
+    }];
+}
+
+- (void)testSumRecursive
+{
+    std::string program = "let total(xs, acc) | isEmpty(xs) = acc | else = total(tail(xs), acc + head(xs))\
+    total(range(0, 1000000), 0)";
+
+    [self measureBlock:^{
+        std::stringstream stream(program);
+        Runtime::evaluate(stream);
+    }];
+}
+
+- (void)testSumBuiltin
+{
+    std::string program = "sum(range(0, 1000000))";
+
+    [self measureBlock:^{
+        std::stringstream stream(program);
+        Runtime::evaluate(stream);
+    }];
+}
+
+- (void)testFilterComparison
+{
+    std::string program = "let below(xs, p) = filter({(x) = x < p}, xs)\
+    len(below(range(0, 1000000), 500000))";
+
+    [self measureBlock:^{
+        std::stringstream stream(program);
+        Runtime::evaluate(stream);
+    }];
+}
+
+- (void)testMapFold
+{
+    std::string program = "let add(a, b) = a + b\
+    foldl(add, 0, map({(x) = x + 1}, range(0, 300000)))";
+
+    [self measureBlock:^{
+        std::stringstream stream(program);
+        Runtime::evaluate(stream);
+    }];
+}
+
+/**
+ Sorts count ints in a scrambled order with sort, which may be qs from testQuickSort
+ */
+static std::string getSortProgram(const std::string &sort, int count)
+{
+    return "let qs(xs) | isEmpty(xs) = [] | else = qs(filter({(x) = x < head(xs)}, tail(xs))) ++ [head(xs)] ++ qs(filter({(x) = x >= head(xs)}, tail(xs)))\
+    len(" + sort + "(map({(x) = x * 131 - (x * 131 / 65537) * 65537}, range(0, " + std::to_string(count) + "))))";
+}
+
+- (void)measureSort:(const std::string &)sort count:(int)count
+{
+    std::string program = getSortProgram(sort, count);
+
+    [self measureBlock:^{
+        std::stringstream stream(program);
+        Runtime::evaluate(stream);
+    }];
+}
+
+- (void)testSort1e3
+{
+    [self measureSort:"sort" count:1000];
+}
+
+- (void)testSort1e4
+{
+    [self measureSort:"sort" count:10000];
+}
+
+- (void)testSort1e5
+{
+    [self measureSort:"sort" count:100000];
+}
+
+- (void)testSort1e6
+{
+    [self measureSort:"sort" count:1000000];
+}
+
+- (void)testSort1e7
+{
+    [self measureSort:"sort" count:10000000];
+}
+
+- (void)testSortBy1e5
+{
+    [self measureSort:"sortBy({(a, b) = a < b}, " count:100000];
+}
+
+- (void)testSortWithQs1e5
+{
+    [self measureSort:"qs" count:100000];
+}
+
+- (void)testStringAppend
+{
+    std::string program = "let build(n, acc) | n == 0 = acc | else = build(n - 1, acc ++ \"ab\")\
+    len(build(100000, \"\"))";
+
+    [self measureBlock:^{
+        std::stringstream stream(program);
+        Runtime::evaluate(stream);
+    }];
+}
+
+- (void)testStringTail
+{
+    std::string program = "let count(s, n) | isEmpty(s) = n | else = count(tail(s), n + 1)\
+    let build(n, acc) | n == 0 = acc | else = build(n - 1, acc ++ \"ab\")\
+    count(build(20000, \"\"), 0)";
+
+    [self measureBlock:^{
+        std::stringstream stream(program);
+        Runtime::evaluate(stream);
+    }];
+}
+
+- (void)testLexer
+{
+    std::string source;
+    for (int i = 0; i < 100000; i++) {
+        std::string name = "function" + std::to_string(i);
+        source += "let " + name + "(alpha, beta) | alpha >= beta = alpha :: [beta]   # note\n";
+        source += "    | else = " + name + "(beta, alpha) ++ \"text\"\n";
+    }
+
+    [self measureBlock:^{
+        Lexer lex(source.data(), source.size());
+        while (lex.getNextToken().getType() != TokenType::EndOfStream);
+    }];
+}
+
+- (void)testCompileLargeScript
+{
+    std::string source;
+    for (int i = 0; i < 20000; i++) {
+        std::string name = "f" + std::to_string(i);
+        source += "let " + name + "(a, b, c) | a > b = [a, b, c] ++ map({(x) = x * a + c}, [1, 2, 3]) | a == 0 = b[1:] | else = " + name + "(a - 1, b, c :: [a])\n";
+    }
+
+    [self measureBlock:^{
+        std::stringstream stream(source);
+        Runtime::compile(stream);
+    }];
+}
+
+@end
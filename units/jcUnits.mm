@@ -15,6 +15,8 @@
 #include "jcVariable.hpp"
 #include "jcString.hpp"
 #include "jcList.hpp"
+#include "PersistentVector.hpp"
+#include "jcReclaimer.hpp"
 
 #include "utils.h"
 
@@ -61,6 +63,50 @@
     XCTAssert(myConcat->equal(*jcVariable::Create(theString + theString)));
 }
 
+- (void)testJcStringRope
+{
+    // long enough that the pieces end up in rope nodes
+    std::shared_ptr<jcCollection> string = jcString::Create("", jcString::StringContextValue);
+    std::string expected;
+    for (int i = 0; i < 10000; i++) {
+        std::string piece = std::to_string(i) + (i % 100 == 0 ? std::string(300, 'x') : ",");
+        string = std::shared_ptr<jcCollection>(string->concat(jcString(piece, jcString::StringContextValue)));
+        expected += piece;
+    }
+
+    XCTAssert(string->size() == expected.size());
+    XCTAssert(string->at(0)->asChar() == '0' && string->at((int)expected.size() - 1)->asChar() == expected.back());
+
+    std::unique_ptr<jcCollection> middle = std::unique_ptr<jcCollection>(string->slice(1000, 2000));
+    XCTAssert(static_cast<jcString*>(middle.get())->asStdString() == expected.substr(1000, 1000));
+    XCTAssert(static_cast<jcString*>(string.get())->equal(jcString(expected, jcString::StringContextValue)));
+
+    // a shallow rope is indexed without flattening it
+    jcString left = jcString(std::string(300, 'a'), jcString::StringContextValue);
+    std::unique_ptr<jcCollection> joined = std::unique_ptr<jcCollection>(left.concat(jcString(std::string(300, 'b'), jcString::StringContextValue)));
+    XCTAssert(joined->at(299)->asChar() == 'a' && joined->at(300)->asChar() == 'b');
+}
+
+- (void)testJcStringSlice
+{
+    std::string theString = "Hello, World!";
+    jcString string = jcString(theString, jcString::StringContextValue);
+
+    std::unique_ptr<jcCollection> world = std::unique_ptr<jcCollection>(string.slice(7, 13));
+    std::unique_ptr<jcCollection> orl = std::unique_ptr<jcCollection>(world->slice(1, 4));
+    XCTAssert(orl->size() == 3 && orl->at(0)->asChar() == 'o' && orl->at(2)->asChar() == 'l');
+    XCTAssert(static_cast<jcString*>(orl.get())->equal(jcString("orl", jcString::StringContextValue)));
+    XCTAssert(static_cast<jcString*>(world.get())->asStdString() == "World!");
+
+    // each tail is a view one character further into the same buffer
+    std::shared_ptr<jcCollection> rest = std::make_shared<jcString>(theString, jcString::StringContextValue);
+    for (char c : theString) {
+        XCTAssert(rest->head()->asChar() == c);
+        rest = std::shared_ptr<jcCollection>(rest->tail());
+    }
+    XCTAssert(rest->isEmpty());
+}
+
 - (void)testJcList
 {
     std::vector<int> listVals = {1, 2, 3, 4};
@@ -132,5 +178,167 @@
     }
 }
 
+- (void)testPersistentVector
+{
+    std::vector<jcVariablePtr> items;
+    for (int i = 0; i < 5000; i++) {
+        items.push_back(jcVariable::Create(i));
+    }
+
+    PersistentVector vector(items.data(), items.size());
+    XCTAssert(vector.size() == 5000 && vector.height() == 2);
+    XCTAssert(vector.at(0)->asInt() == 0 && vector.at(4999)->asInt() == 4999);
+
+    // cuts through leaves on both sides
+    PersistentVector middle = vector.slice(33, 4001);
+    XCTAssert(middle.size() == 3968 && middle.at(0)->asInt() == 33 && middle.at(3967)->asInt() == 4000);
+
+    // many small pieces still make a shallow tree
+    PersistentVector joined;
+    for (int i = 0; i < 2000; i++) {
+        joined = joined.concat(vector.slice(i, i + 3));
+    }
+    XCTAssert(joined.size() == 6000 && joined.height() <= 3);
+    for (int i = 0; i < 2000; i++) {
+        XCTAssert(joined.at(i * 3 + 2)->asInt() == i + 2);
+    }
+
+    int expected = 100;
+    vector.forEach(100, 200, [self, &expected](jcVariablePtr &item) {
+        XCTAssert(item->asInt() == expected++);
+    });
+    XCTAssert(expected == 200);
+}
+
+- (void)testPackedPersistentVector
+{
+    std::vector<int> ints;
+    for (int i = 0; i < 1000; i++) {
+        ints.push_back(i);
+    }
+    PersistentVector packed(ints.data(), ints.size());
+    XCTAssert(packed.at(0)->asInt() == 0 && packed.at(999)->asInt() == 999);
+
+    // a leaf taking an item that is not an int is boxed, the rest stay packed
+    std::vector<jcVariablePtr> items = { jcVariable::Create('a'), jcVariable::Create(1000) };
+    PersistentVector mixed = packed.slice(10, 1000).concat(PersistentVector(items.data(), items.size()));
+    XCTAssert(mixed.size() == 992 && mixed.at(0)->asInt() == 10 && mixed.at(990)->asChar() == 'a' && mixed.at(991)->asInt() == 1000);
+
+    int expected = 10;
+    mixed.forEach(0, 990, [self, &expected](jcVariablePtr &item) {
+        XCTAssert(item->asInt() == expected++);
+    });
+    XCTAssert(expected == 1000);
+}
+
+- (void)testLongJcList
+{
+    // long enough that most of the items are in the vector behind the front chunks
+    std::vector<int> values;
+    for (int i = 0; i < 5000; i++) {
+        values.push_back(i);
+    }
+    jcListPtr list = TestUtils::buildList(values);
+
+    XCTAssert(list->at(0)->asInt() == 0 && list->at(2500)->asInt() == 2500 && list->at(4999)->asInt() == 4999);
+
+    std::unique_ptr<jcCollection> tail = std::unique_ptr<jcCollection>(list->slice(1, 5000));
+    std::unique_ptr<jcCollection> middle = std::unique_ptr<jcCollection>(tail->slice(100, 600));
+    XCTAssert(middle->size() == 500 && middle->at(0)->asInt() == 101);
+
+    std::unique_ptr<jcCollection> joined = std::unique_ptr<jcCollection>(middle->concat(*list));
+    XCTAssert(joined->size() == 5500 && joined->at(499)->asInt() == 600 && joined->at(500)->asInt() == 0);
+
+    int idx = 0;
+    joined->forEach([self, &idx](jcVariablePtr &item) {
+        XCTAssert(item->asInt() == (idx < 500 ? idx + 101 : idx - 500));
+        idx++;
+    });
+}
+
+- (void)testJcListTail
+{
+    std::vector<int> values;
+    for (int i = 0; i < 100; i++) {
+        values.push_back(i);
+    }
+    jcListPtr list = TestUtils::buildList(values);
+    std::shared_ptr<jcList> consed = std::shared_ptr<jcList>(list->cons(jcVariable::Create(-1)));
+
+    // walks off the consed cell and then along the vector
+    std::shared_ptr<jcCollection> rest = consed;
+    for (int i = -1; i < 100; i++) {
+        XCTAssert(rest->head()->asInt() == i && rest->size() == (size_t)(100 - i));
+        rest = std::shared_ptr<jcCollection>(rest->tail());
+    }
+    XCTAssert(rest->isEmpty());
+}
+
+- (void)testJcListConsShares
+{
+    jcListPtr list = TestUtils::buildList(std::vector<int>{ 1, 2 });
+
+    // the first cons takes the free slot of the chunk, the second one must not overwrite it
+    std::shared_ptr<jcList> first = std::shared_ptr<jcList>(list->cons(jcVariable::Create(10)));
+    std::shared_ptr<jcList> second = std::shared_ptr<jcList>(list->cons(jcVariable::Create(20)));
+    XCTAssert(first->equal(*TestUtils::buildList(std::vector<int>{ 10, 1, 2 })));
+    XCTAssert(second->equal(*TestUtils::buildList(std::vector<int>{ 20, 1, 2 })));
+    XCTAssert(list->size() == 2 && list->head()->asInt() == 1);
+}
+
+static jcVariablePtr buildNestedList(int depth)
+{
+    jcVariablePtr value = jcVariable::CreateFromCollection(std::make_shared<jcList>());
+    for (int i = 0; i < depth; i++) {
+        value = jcVariable::CreateFromCollection(std::shared_ptr<jcList>(std::make_shared<jcList>()->cons(value)));
+    }
+    return value;
+}
+
+- (void)testFreeDeeplyNestedList
+{
+    // deep enough that freeing it one destructor inside the other overflows the stack
+    jcVariablePtr nested = buildNestedList(1000000);
+    nested = nullptr;
+
+    jcReclaimer::setBackground(true);
+    nested = buildNestedList(1000000);
+    std::weak_ptr<jcVariable> watch = nested->asListRaw()->head();
+    nested = nullptr;
+    jcReclaimer::flush();
+    jcReclaimer::setBackground(false);
+    XCTAssert(watch.expired());
+}
+
+- (void)testJcListConcatShares
+{
+    std::vector<int> values;
+    for (int i = 0; i < 1000; i++) {
+        values.push_back(i);
+    }
+    jcListPtr list = TestUtils::buildList(values);
+    jcListPtr pivot = TestUtils::buildList(std::vector<int>{ -1 });
+
+    // the short list goes onto the front, the long one is not rebuilt
+    std::unique_ptr<jcCollection> front = std::unique_ptr<jcCollection>(pivot->concat(*list));
+    XCTAssert(front->size() == 1001 && front->at(0)->asInt() == -1 && front->at(1000)->asInt() == 999);
+
+    std::unique_ptr<jcCollection> back = std::unique_ptr<jcCollection>(list->concat(*pivot));
+    XCTAssert(back->size() == 1001 && back->at(999)->asInt() == 999 && back->at(1000)->asInt() == -1);
+
+    // repeated ++ stays linear to walk
+    std::shared_ptr<jcCollection> joined = std::make_shared<jcList>();
+    for (int i = 0; i < 100; i++) {
+        joined = std::shared_ptr<jcCollection>(joined->concat(i % 2 ? *pivot : *list));
+    }
+    XCTAssert(joined->size() == 50 * 1001);
+
+    int count = 0;
+    joined->forEach([&count](jcVariablePtr &item) {
+        count++;
+    });
+    XCTAssert(count == 50 * 1001);
+}
+
 
 @end
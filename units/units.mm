@@ -9,8 +9,18 @@
 #include <memory>
 
 #include "Runtime.hpp"
+#include "Lexer.hpp"
+#include "Parser.hpp"
+#include "Strictness.hpp"
+#include "Verifier.hpp"
+#include "Image.hpp"
+#include "ImageFile.hpp"
+#include "Interpreter.hpp"
+#include "RegisterInterpreter.hpp"
 #include "jcVariable.hpp"
 #include "jcUtils.hpp"
+#include "Arena.hpp"
+#include "ast.hpp"
 #include "jcArray.hpp"
 #include "jcList.hpp"
 
@@ -128,6 +138,140 @@ static BOOL testStream(std::istream &stream, Runtime &rt, jcVariablePtr expected
     XCTAssert(testStream(stream, rt, expected));
 }
 
+- (void)testListTail {
+    Runtime rt;
+
+    std::vector<AnswerExpression> session = {
+        AnswerExpression(TestUtils::buildListVariable(std::vector<int>{2, 3}), "tail(0 :: [1, 2, 3][1:])"),
+        AnswerExpression(jcVariable::Create(std::string("bc")), "tail(\"abc\")"),
+        AnswerExpression(jcVariable::Create(3), "let last(xs) | len(xs) == 1 = head(xs) | else = last(tail(xs))\n last([1, 2, 3])"),
+        // a definition takes precedence over the builtin
+        AnswerExpression(jcVariable::Create(0), "let head(xs) = 0\n head([1])"),
+    };
+
+    for (AnswerExpression object : session) {
+        std::stringstream stream;
+        stream << object.expression;
+        XCTAssert(testStream(stream, rt, object.answer));
+    }
+
+    std::stringstream failing;
+    failing << "tail([])";
+    std::vector<jcVariablePtr> output;
+    XCTAssertThrows(rt.evaluateREPL(failing, output));
+}
+
+- (void)testRange {
+    Runtime rt;
+
+    std::vector<AnswerExpression> session = {
+        AnswerExpression(TestUtils::buildListVariable(std::vector<int>{3, 4, 5}), "range(3, 6)"),
+        AnswerExpression(jcVariable::Create(77777), "range(0, 100000)[77777]"),
+        AnswerExpression(TestUtils::buildListVariable(std::vector<int>{1, 2, 3, 5}), "1 :: range(2, 4) ++ [5]"),
+        AnswerExpression(jcVariable::Create(1), "isEmpty(range(5, 5))"),
+    };
+
+    for (AnswerExpression object : session) {
+        std::stringstream stream;
+        stream << object.expression;
+        XCTAssert(testStream(stream, rt, object.answer));
+    }
+}
+
+- (void)testCollectionReductions {
+    Runtime rt;
+
+    std::vector<AnswerExpression> session = {
+        AnswerExpression(jcVariable::Create(4950), "sum(range(0, 100))"),
+        AnswerExpression(jcVariable::Create(6), "sum(1 :: 2 :: [3])"),
+        AnswerExpression(jcVariable::Create(0), "sum([])"),
+        AnswerExpression(jcVariable::Create(24), "product([1, 2, 3, 4])"),
+        AnswerExpression(jcVariable::Create(-3), "minimum(5 :: range(0 - 3, 40))"),
+        AnswerExpression(jcVariable::Create(39), "maximum(range(0 - 3, 40) ++ [2])"),
+        AnswerExpression(jcVariable::Create(3), "count(7, [7, 1, 7] ++ range(0, 100))"),
+        AnswerExpression(jcVariable::Create(77777), "indexOf(77777, range(0, 100000))"),
+        AnswerExpression(jcVariable::Create(-1), "indexOf(5, [1, 2])"),
+        AnswerExpression(jcVariable::Create(2), "indexOf(\"hello\"[3], \"hello\")"),
+        AnswerExpression(jcVariable::Create(1), "elem(3, 1 :: [2, 3])"),
+        AnswerExpression(jcVariable::Create(0), "elem(\"z\"[0], \"hello\")"),
+    };
+
+    for (AnswerExpression object : session) {
+        std::stringstream stream;
+        stream << object.expression;
+        XCTAssert(testStream(stream, rt, object.answer));
+    }
+}
+
+- (void)testFilterComparison {
+    Runtime rt;
+
+    std::vector<AnswerExpression> session = {
+        AnswerExpression(jcVariable::Create(0), "let below(xs, p) = filter({(x) = x < p}, xs)"),
+        AnswerExpression(jcVariable::Create(0), "let above(xs) = filter({(x) = x > head(xs)}, xs)"),
+        AnswerExpression(TestUtils::buildListVariable(std::vector<int>{0, 1, 2, 3, 4}), "below(7 :: range(0, 10), 5)"),
+        AnswerExpression(TestUtils::buildListVariable(std::vector<int>{1, 3}), "filter({(x) = 3 >= x}, [5, 1, 3, 4])"),
+        AnswerExpression(TestUtils::buildListVariable(std::vector<int>{5}), "above([3, 1, 5])"),
+        AnswerExpression(jcVariable::Create(999), "len(filter({(x) = x > 99000}, range(0, 100000)))"),
+        // not a comparison, the function is called
+        AnswerExpression(TestUtils::buildListVariable(std::vector<int>{3, 4}), "filter({(x) = x * 2 > 5}, [1, 2, 3, 4])"),
+        // a string spelled like the parameter is compared as a string
+        AnswerExpression(TestUtils::buildListVariable(std::vector<int>{}), "filter({(x) = \"x\" == 3}, [1, 3, 5])"),
+    };
+
+    for (AnswerExpression object : session) {
+        std::stringstream stream;
+        stream << object.expression;
+        XCTAssert(testStream(stream, rt, object.answer));
+    }
+}
+
+- (void)testHigherOrderBuiltins {
+    Runtime rt;
+
+    std::vector<AnswerExpression> session = {
+        AnswerExpression(jcVariable::Create(0), "let add(a, b) = a + b"),
+        AnswerExpression(TestUtils::buildListVariable(std::vector<int>{0, 2, 4}), "map({(x) = x * 2}, range(0, 3))"),
+        AnswerExpression(jcVariable::Create(5050), "foldl(add, 0, range(0, 101))"),
+        AnswerExpression(TestUtils::buildListVariable(std::vector<int>{3, 2, 1}), "foldl({(acc, x) = x :: acc}, [], [1, 2, 3])"),
+        AnswerExpression(jcVariable::Create(2), "foldr({(x, acc) = x - acc}, 0, [1, 2, 3])"),
+        AnswerExpression(TestUtils::buildListVariable(std::vector<int>{11, 13, 15}), "zipWith(add, [1, 2, 3], range(10, 100))"),
+        AnswerExpression(TestUtils::buildListVariable(std::vector<int>{0, 0, 1, 0, 1, 2}), "concatMap({(x) = range(0, x)}, [1, 2, 3])"),
+        // the function calls a builtin that calls back into the interpreter
+        AnswerExpression(TestUtils::buildListVariable(std::vector<int>{3, 6, 9}), "map({(x) = foldl(add, 0, map({(y) = y * x}, [1, 2]))}, [1, 2, 3])"),
+    };
+
+    for (AnswerExpression object : session) {
+        std::stringstream stream;
+        stream << object.expression;
+        XCTAssert(testStream(stream, rt, object.answer));
+    }
+}
+
+- (void)testSortBuiltins {
+    Runtime rt;
+
+    std::vector<AnswerExpression> session = {
+        AnswerExpression(TestUtils::buildListVariable(std::vector<int>{-3, 0, 2, 2, 5}), "sort([5, -3, 2, 2, 0])"),
+        AnswerExpression(TestUtils::buildListVariable(std::vector<int>{}), "sort([])"),
+        // long enough for the radix sort
+        AnswerExpression(TestUtils::buildListVariable(std::vector<int>{-1000, -999, -998}), "sort(map({(x) = 0 - x}, range(-999, 1001)))[0:3]"),
+        AnswerExpression(TestUtils::buildListVariable(std::vector<int>{3, 2, 1}), "sortBy({(a, b) = a > b}, [1, 3, 2])"),
+        // elements the function does not order keep their order
+        AnswerExpression(TestUtils::buildListVariable(std::vector<int>{12, 11, 21, 22}), "sortBy({(a, b) = a / 10 < b / 10}, [21, 12, 11, 22])"),
+        AnswerExpression(jcVariable::Create(2), "binarySearch(7, [1, 3, 7, 7, 9])"),
+        AnswerExpression(jcVariable::Create(-1), "binarySearch(8, [1, 3, 7, 7, 9])"),
+        AnswerExpression(jcVariable::Create(-1), "binarySearch(0, [])"),
+        AnswerExpression(jcVariable::Create(77777), "binarySearch(77777, range(0, 100000))"),
+    };
+
+    for (AnswerExpression object : session) {
+        std::stringstream stream;
+        stream << object.expression;
+        XCTAssert(testStream(stream, rt, object.answer));
+    }
+}
+
 - (void)testListlen {
     Runtime rt;
 
@@ -191,6 +335,22 @@ static BOOL testStream(std::istream &stream, Runtime &rt, jcVariablePtr expected
     XCTAssert(testStream(stream, rt, expected));
 }
 
+- (void)testNestedClosureCapture
+{
+    Runtime rt;
+
+    std::string program = "let nest(x, y, unused) = {(a) = {(b) = a + b + x + y}}\
+                          nest(1, 2, 100)(3)(4)\
+    ";
+
+    jcVariablePtr expected = jcVariable::Create(10);
+
+    std::stringstream stream;
+    stream << program;
+
+    XCTAssert(testStream(stream, rt, expected));
+}
+
 - (void)testPassFunction
 {
     Runtime rt;
@@ -325,6 +485,351 @@ static BOOL testStream(std::istream &stream, Runtime &rt, jcVariablePtr expected
     XCTAssert(testStream(stream, rt, expected));
 }
 
+- (void)testLazyArguments
+{
+    RuntimeOptions options;
+    options.lazyEvaluation = true;
+    Runtime rt(options);
+
+    std::string program = "let pick(c, a, b) | c = a | else = b\
+    pick(1, 5, 1 / 0) \
+    ";
+
+    jcVariablePtr expected = jcVariable::Create(5);
+
+    std::stringstream stream;
+    stream << program;
+
+    XCTAssert(testStream(stream, rt, expected));
+}
+
+- (void)testLazyForwardedArguments
+{
+    RuntimeOptions options;
+    options.lazyEvaluation = true;
+    Runtime rt(options);
+
+    // parameters passed on to a lazy parameter or captured by a closure stay delayed
+    std::vector<AnswerExpression> session = {
+        AnswerExpression(jcVariable::Create(0), "let pick(c, a, b) | c = a | else = b"),
+        AnswerExpression(jcVariable::Create(0), "let wrap2(c, a, b) = pick(c, a, b)"),
+        AnswerExpression(jcVariable::Create(0), "let wrap3(c, a, b) = pick(c, a + 0, b + 0)"),
+        AnswerExpression(jcVariable::Create(0), "let later(c, a, b) = {(x) = pick(c, a, b) + x}"),
+        AnswerExpression(jcVariable::Create(5), "wrap2(1, 5, 1 / 0)"),
+        AnswerExpression(jcVariable::Create(5), "wrap3(1, 5, 1 / 0)"),
+        AnswerExpression(jcVariable::Create(15), "later(1, 5, 1 / 0)(10)"),
+        AnswerExpression(jcVariable::Create(7), "wrap2(0, 1 / 0, 7)"),
+    };
+
+    for (AnswerExpression object : session) {
+        std::stringstream stream;
+        stream << object.expression;
+        XCTAssert(testStream(stream, rt, object.answer));
+    }
+}
+
+- (void)testStrictnessAnalysis
+{
+    std::stringstream stream;
+    stream << "let f(a, b, c) | a > 0 = b | else = b + c \
+    let g(x, y) = x ? g(x - 1, y) : y \
+    let h(p, q) = {() = p} \
+    let w(x, y, z) = f(x, y, z) \
+    ";
+
+    Lexer lex(stream);
+    Parser parser(lex);
+    std::vector<FunctionDecl*> functions;
+    for (auto node : parser.parse()) {
+        functions.push_back(static_cast<FunctionDecl*>(node));
+    }
+
+    bc::StrictnessTable table;
+    bc::StrictnessAnalyzer::analyze(functions, table);
+
+    XCTAssert(table["f"] == std::vector<bool>({true, true, false}));
+    XCTAssert(table["g"] == std::vector<bool>({true, true}));
+    XCTAssert(table["h"] == std::vector<bool>({false, false}));
+    XCTAssert(table["w"] == std::vector<bool>({true, true, false}));
+}
+
+- (void)testVerifier
+{
+    auto label = [](const std::string &name) {
+        return jcVariable::Create(name);
+    };
+
+    std::vector<bc::Instruction> valid = {
+        bc::Instruction(bc::Push, jcVariable::Create(1)),
+        bc::Instruction(bc::Push, label("f")),
+        bc::Instruction(bc::Call, nullptr, 1),
+        bc::Instruction(bc::Exit),
+        bc::Instruction(bc::Label, label("f")),
+        bc::Instruction(bc::Pop, label("x")),
+        bc::Instruction(bc::Push, label("x")),
+        bc::Instruction(bc::Ret)
+    };
+
+    std::vector<bc::Instruction> missingLabel = {
+        bc::Instruction(bc::Push, jcVariable::Create(1)),
+        bc::Instruction(bc::Jmp, label("nowhere")),
+        bc::Instruction(bc::Exit)
+    };
+
+    std::vector<bc::Instruction> unbalanced = {
+        bc::Instruction(bc::Push, jcVariable::Create(1)),
+        bc::Instruction(bc::Exit),
+        bc::Instruction(bc::Label, label("f")),
+        bc::Instruction(bc::Push, jcVariable::Create(1)),
+        bc::Instruction(bc::Push, jcVariable::Create(2)),
+        bc::Instruction(bc::Ret)
+    };
+
+    std::vector<bc::Instruction> underflow = {
+        bc::Instruction(bc::Add),
+        bc::Instruction(bc::Exit)
+    };
+
+    XCTAssert(bc::Verifier::verify(valid));
+    XCTAssert(bc::Verifier::verify(missingLabel) == false);
+    XCTAssert(bc::Verifier::verify(unbalanced) == false);
+    XCTAssert(bc::Verifier::verify(underflow) == false);
+
+    Interpreter verified;
+    verified.setInstructions(valid);
+    XCTAssert(verified.isVerified());
+    XCTAssert(verified.interpret()->asInt() == 1);
+
+    // unverified images still run on the checked path
+    Interpreter checked;
+    checked.setInstructions(underflow);
+    XCTAssert(checked.isVerified() == false);
+    XCTAssertThrows(checked.interpret());
+}
+
+- (void)testCallArgumentCount
+{
+    Runtime rt;
+
+    // calls are not checked against the callee's parameters, extra arguments stay for the function it returns
+    std::vector<AnswerExpression> session = {
+        AnswerExpression(jcVariable::Create(0), "let add(a, b) = a + b"),
+        AnswerExpression(jcVariable::Create(3), "add(1, 2, 3)"),
+        AnswerExpression(jcVariable::Create(0), "let addClosure(x, y) = { () = {() = x + y } }"),
+        AnswerExpression(jcVariable::Create(0), "let myAdd(x,y) = addClosure(x,y)()()"),
+        AnswerExpression(jcVariable::Create(0), "let myAddtwo = myAdd"),
+        AnswerExpression(jcVariable::Create(0), "let fireFunc = myAddtwo(4,4)"),
+        AnswerExpression(jcVariable::Create(8), "fireFunc()()"),
+    };
+
+    for (AnswerExpression object : session) {
+        std::stringstream stream;
+        stream << object.expression;
+        XCTAssert(testStream(stream, rt, object.answer));
+    }
+
+    // too few arguments leave the verified path instead of popping past the stack
+    std::stringstream missing("let f(a, b) = a - b\nlet g(x) = 100 + f(x)\ng(1)");
+    XCTAssertThrows(Runtime::evaluate(missing));
+}
+
+- (void)testImageConstantPool
+{
+    auto label = [](const char *name) { return jcVariable::Create(std::string(name)); };
+
+    std::vector<bc::Instruction> instructions = {
+        bc::Instruction(bc::Push, jcVariable::Create(1)),
+        bc::Instruction(bc::JmpTrue, label("end")),
+        bc::Instruction(bc::Push, jcVariable::Create(1)),
+        bc::Instruction(bc::Label, label("end")),
+        bc::Instruction(bc::Jmp, label("missing")),
+    };
+
+    bc::Image image = bc::Image::assemble(instructions);
+    const bc::Word *words = image.words();
+
+    XCTAssert(image.size() == instructions.size());
+
+    // both pushes of 1 share one constant
+    XCTAssert(words[0].operand == words[2].operand);
+    XCTAssert(image.constants()[words[0].operand]->asInt() == 1);
+
+    // jumps land on the word after their label
+    XCTAssert(words[1].operand == 4);
+    XCTAssert(words[4].flags & bc::Word::Unresolved);
+}
+
+- (void)testImageFileRoundTrip
+{
+    std::string program = "let greet(name) = \"hi \" ++ name\
+    let count(xs) | isEmpty(xs) = 0 | else = 1 + count(tail(xs))\
+    count(greet(\"jc\")) + len([])\
+    ";
+
+    std::stringstream stream;
+    stream << program;
+    bc::Image image = Runtime::compile(stream);
+
+    std::string path = std::string([NSTemporaryDirectory() UTF8String]) + "/roundtrip.jcb";
+    XCTAssert(bc::ImageFile::write(image, 42, path));
+
+    bc::Image loaded;
+    uint64_t hash = 0;
+    XCTAssert(bc::ImageFile::load(path, loaded, &hash));
+    XCTAssert(hash == 42);
+    XCTAssert(loaded.size() == image.size());
+    XCTAssert(loaded.labels() == image.labels());
+    XCTAssert(loaded.lineOf(0) == image.lineOf(0));
+
+    Interpreter interpreter;
+    interpreter.setImage(loaded);
+    XCTAssert(interpreter.isVerified());
+    XCTAssert(interpreter.interpret()->asInt() == 5);
+
+    // files from another format version are rejected
+    std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+    file.seekp(4);
+    uint32_t version = bc::ImageFile::kVersion + 1;
+    file.write(reinterpret_cast<const char*>(&version), sizeof(version));
+    file.close();
+    XCTAssert(bc::ImageFile::load(path, loaded) == false);
+}
+
+- (void)testCompileLibrary
+{
+    std::ifstream library(JC_STD_LIBRARY_PATH);
+    bc::Image image = Runtime::compileLibrary(library);
+    XCTAssert(image.labels().count("min") > 0);
+
+    // generated labels cannot clash with those of code compiled later
+    for (auto label : image.labels()) {
+        XCTAssert(label.first[0] != '.' && label.first.find("c.") != 0);
+    }
+
+    std::string data = bc::ImageFile::serialize(image, 0);
+    bc::Image embedded;
+    XCTAssert(bc::ImageFile::read(data.data(), data.size(), embedded));
+    XCTAssert(embedded.labels() == image.labels());
+}
+
+- (void)testQuickenedIndexDeoptimizes
+{
+    Runtime rt;
+
+    // idx is quickened to a list index on the first call, the string forces it back to the generic op
+    std::string program = "let idx(c, i) = c[i]\
+    idx([7, 8], 1) + len([idx(\"ab\", 1)]) + idx([1, 2], 0) \
+    ";
+
+    jcVariablePtr expected = jcVariable::Create(10);
+
+    std::stringstream stream;
+    stream << program;
+
+    XCTAssert(testStream(stream, rt, expected));
+}
+
+- (void)testIncrementalREPL
+{
+    Runtime rt;
+
+    std::vector<AnswerExpression> session = {
+        AnswerExpression(jcVariable::Create(0), "let adder(x) = {(y) = x + y}"),
+        AnswerExpression(jcVariable::Create(0), "let add1(y) = adder(1)(y)"),
+        // the expression's closure is rolled back, the one in adder is kept
+        AnswerExpression(jcVariable::Create(6), "{(z) = z * 2}(2) + add1(1)"),
+        AnswerExpression(jcVariable::Create(3), "add1(2)"),
+        // add1 picks up the redefinition
+        AnswerExpression(jcVariable::Create(7), "let adder(x) = {(y) = x * y}\n adder(7)(1)"),
+        AnswerExpression(jcVariable::Create(3), "add1(3)"),
+    };
+
+    for (AnswerExpression object : session) {
+        std::stringstream stream;
+        stream << object.expression;
+        XCTAssert(testStream(stream, rt, object.answer));
+    }
+
+    // a failing expression leaves the session usable
+    std::stringstream failing;
+    failing << "undefinedFunction(1)";
+    std::vector<jcVariablePtr> output;
+    XCTAssertThrows(rt.evaluateREPL(failing, output));
+
+    std::stringstream stream;
+    stream << "add1(41)";
+    XCTAssert(testStream(stream, rt, jcVariable::Create(41)));
+}
+
+- (void)testStreaming
+{
+    RuntimeOptions options;
+    options.streaming = true;
+
+    // a is linked before b is read, the call is resolved when it runs
+    std::stringstream stream;
+    stream << "[1, 2] ++ [3]\nlet a(x) = b(x)\nlet b(x) = x + 1\na(41)";
+    XCTAssert(Runtime::evaluate(stream, options).dispatchCount > 0);
+
+    options.lazyEvaluation = true;
+    std::stringstream lazy;
+    lazy << "let pick(c, a, b)\n | c = a\n | else = b\npick(1, 5, 1 / 0)";
+    XCTAssertNoThrow(Runtime::evaluate(lazy, options));
+
+    std::stringstream failing;
+    failing << "undefinedFunction(1)";
+    XCTAssertThrows(Runtime::evaluate(failing, options));
+}
+
+- (void)testRegisterEngine
+{
+    std::string program = "let pick(x, y) | x > y = x | else = y\
+    let adder(x) = {(y) = {(z) = x + y + z}}\
+    let sum(xs) | len(xs) == 0 = 0 | else = xs[0] + sum(xs[1:])\
+    adder(1)(2)(3) + pick(4, -5) + sum([1, 2, 3] ++ [4]) + (1 > 2 ? 100 : 200)\
+    ";
+
+    std::stringstream stream;
+    stream << program;
+
+    Lexer lex(stream);
+    Parser parser(lex);
+
+    rbc::Module module;
+    rbc::Generator generator(module);
+    generator.generate(parser.parse());
+
+    RegisterInterpreter interpreter(module);
+    XCTAssert(interpreter.interpret()->asInt() == 220);
+    XCTAssert(interpreter.dispatchCount() > 0);
+
+    // called from library code with the arguments in parameter order
+    XCTAssert(interpreter.interpret(jcVariable::Create("pick"), {jcVariable::Create(1), jcVariable::Create(2)})->asInt() == 2);
+}
+
+- (void)testEvaluationOrderAcrossEngines
+{
+    std::string program = "let add(a, b) = a + b\n\
+    add(print(1), print(2)) + [print(10), print(20)][print(0)] + len([1, 2, 3, 4][print(1):print(3)])";
+
+    // print writes to std::cout, both engines must print in the same order
+    auto printed = [&program](RuntimeOptions::Engine engine) {
+        RuntimeOptions options;
+        options.engine = engine;
+
+        std::stringstream output;
+        std::streambuf *stdoutBuffer = std::cout.rdbuf(output.rdbuf());
+        std::stringstream stream(program);
+        Runtime::evaluate(stream, options);
+        std::cout.rdbuf(stdoutBuffer);
+        return output.str();
+    };
+
+    std::string stack = printed(RuntimeOptions::Engine::Stack);
+    XCTAssert(stack == "2\n1\n0\n10\n20\n3\n1\n");
+    XCTAssert(printed(RuntimeOptions::Engine::Register) == stack);
+}
+
 - (void)testComment
 {
     Runtime rt;
@@ -343,4 +848,98 @@ static BOOL testStream(std::istream &stream, Runtime &rt, jcVariablePtr expected
     XCTAssert(testStream(stream, rt, expected));
 }
 
+- (void)testArenaAST
+{
+    std::stringstream stream;
+    stream << "let f(a, b) | a > b = [a, b] | else = f(b, a)\n f(1, 2)\n \"str\"";
+
+    Lexer lex(stream);
+    Parser parser(lex);
+    std::vector<Node*> nodes = parser.parse();
+    XCTAssert(nodes.size() == 3);
+
+    FunctionBody *body = static_cast<FunctionDecl*>(nodes[0])->getFunctionBody();
+    XCTAssert(body->getParameters().size() == 2 && body->getParameters()[1] == "b");
+    XCTAssert(body->getGuards().size() == 1);
+    XCTAssert(static_cast<FunctionCallExpression*>(nodes[1])->getArguments().size() == 2);
+    XCTAssert(static_cast<StringExpression*>(nodes[2])->getValue() == "str");
+    XCTAssert(parser.arena().size() > 0);
+
+    // large arrays get their own block
+    Arena arena;
+    std::string large(100000, 'x');
+    XCTAssert(arena.copy(large) == large);
+    XCTAssert(arena.copy(std::vector<int>{1, 2, 3})[2] == 3);
+}
+
+- (void)testLexer
+{
+    // the identifier is long enough to be scanned in blocks
+    std::string program = "let letter(elsewhere) = elsewhere >= 1\n# comment\n  averyveryverylongidentifiername123 :: [] ++ \"a\nb\" = = 42";
+    Lexer lex(program.data(), program.size());
+
+    XCTAssert(lex.peekToken(2).getType() == TokenType::LParen);
+    XCTAssert(lex.peekToken().getType() == TokenType::LetKw);
+
+    std::vector<TokenType> expected = {
+        TokenType::LetKw, TokenType::Id, TokenType::LParen, TokenType::Id, TokenType::RParen, TokenType::Assign,
+        TokenType::Id, TokenType::Greater_Than_Equal, TokenType::Num, TokenType::Id, TokenType::Cons,
+        TokenType::LeftBracket, TokenType::RightBracket, TokenType::Concat, TokenType::String, TokenType::Equals,
+        TokenType::Num, TokenType::EndOfStream
+    };
+
+    std::vector<int64_t> lines;
+    for (TokenType type : expected) {
+        Token token = lex.getNextToken();
+        XCTAssert(token.getType() == type);
+        lines.push_back(token.getLineNumber());
+    }
+
+    XCTAssert(lines[0] == 0 && lines[9] == 2 && lines[14] == 3);
+    XCTAssert(lex.getLineNumber() == 3);
+}
+
+- (void)testLexerSplit
+{
+    // let inside a string, a comment or a longer name does not start a chunk
+    std::string program = "let a(x) = \"let\n\" # let\nlet outlet(x) = 1\nlet b(x) = x\nb(1)";
+    Lexer lex(program.data(), program.size());
+    std::vector<Lexer::Chunk> chunks = lex.split(1);
+
+    XCTAssert(chunks.size() == 3);
+    XCTAssert(std::string(chunks[1].data, chunks[1].size) == "let outlet(x) = 1\n");
+    XCTAssert(chunks[1].line == 2 && chunks[2].line == 3);
+
+    Lexer chunk(chunks[2].data, chunks[2].size, chunks[2].line);
+    XCTAssert(chunk.getNextToken().getType() == TokenType::LetKw);
+    XCTAssert(chunk.getLineNumber() == 3);
+}
+
+- (void)testParallelCompile
+{
+    std::string program;
+    for (int i = 0; i < 2000; i++) {
+        std::string name = "f" + std::to_string(i);
+        program += "let " + name + "(x)\n | x > 1 = {(y) = x + y}(1)\n | else = x\n" + name + "(2)\n";
+    }
+
+    // chunks are numbered by position, so the thread count does not show in the image
+    std::string images[2];
+    unsigned threads[2] = { 1, 4 };
+    for (int i = 0; i < 2; i++) {
+        RuntimeOptions options;
+        options.compileThreads = threads[i];
+        std::stringstream stream;
+        stream << program;
+        images[i] = bc::ImageFile::serialize(Runtime::compile(stream, options), 0);
+    }
+    XCTAssert(images[0] == images[1]);
+
+    RuntimeOptions options;
+    options.lazyEvaluation = true;
+    std::stringstream stream;
+    stream << program;
+    XCTAssert(Runtime::evaluate(stream, options).dispatchCount > 0);
+}
+
 @end